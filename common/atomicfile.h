@@ -0,0 +1,77 @@
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+
+/**
+ * Writes all of data to a file descriptor.
+ */
+inline bool writeAll(const int fd, const char * data, const std::size_t size)
+{
+    std::size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t n = ::write(fd, data + done, size - done);
+        if (n < 0)
+        {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+
+
+/**
+ * Makes a rename in the directory of path durable.
+ */
+inline void syncDirectory(const std::string & path)
+{
+    const std::string::size_type slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+
+    const int dir = ::open(directory.c_str(), O_RDONLY);
+    if (dir >= 0)
+    {
+        ::fsync(dir);
+        ::close(dir);
+    }
+}
+
+
+
+/**
+ * Atomically replaces the file at path with contents: writes them to a temporary file, fsyncs
+ * it and renames it over path. After a crash, path holds either its old or its new contents.
+ * @return false if the file could not be written. path is left untouched then.
+ */
+inline bool replaceFile(const std::string & path, const std::string & contents)
+{
+    const std::string temporary = path + ".tmp";
+    const int out = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+    {
+        return false;
+    }
+
+    const bool ok = writeAll(out, contents.data(), contents.size()) && ::fsync(out) == 0;
+    ::close(out);
+    if ( !ok || ::rename(temporary.c_str(), path.c_str()) != 0 )
+    {
+        ::unlink(temporary.c_str());
+        return false;
+    }
+
+    syncDirectory(path);
+    return true;
+}
+
+
+
+#endif // ATOMICFILE_H
@@ -0,0 +1,590 @@
+#ifndef BINARYMODEL_H
+#define BINARYMODEL_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "integralevaluators.h"
+#include "atomicfile.h"
+
+
+
+template<typename WeakHypothesisType>
+class StrongHypothesis;
+
+template<typename FeatureType, typename HaarEvaluatorType>
+class ThresholdedWeakClassifier;
+
+template<typename EvaluatorType>
+struct BinaryModelEvaluator;
+
+
+
+/**
+ * A rectangle of a wavelet in a binary model, in the coordinates of the unscaled detector window.
+ */
+struct BinaryRect
+{
+    boost::int16_t x;
+    boost::int16_t y;
+    boost::int16_t width;
+    boost::int16_t height;
+};
+
+
+
+/**
+ * A weak classifier of a binary model: its rectangles are rects [firstRect, firstRect + dimensions).
+ * Wavelet pools keep alpha 0, polarity 1 and theta 0.
+ */
+struct BinaryModelEntry
+{
+    float alpha;
+    float polarity;
+    float theta;
+    boost::uint32_t firstRect;
+    boost::uint32_t dimensions;
+};
+
+
+
+/**
+ * A wavelet whose rectangles and weights are in a mapped binary model. It provides dimensions(),
+ * rects_begin() and weights_begin() as haarcommon's HaarWavelet does, so the evaluators of
+ * integralevaluators.h read it where it is.
+ */
+class BinaryWavelet
+{
+public:
+    BinaryWavelet(const BinaryRect * rects_, const float * weights_, const std::size_t size_) : rects(rects_),
+                                                                                                weights(weights_),
+                                                                                                size(size_) {}
+
+    std::size_t dimensions() const
+    {
+        return size;
+    }
+
+    const BinaryRect * rects_begin() const
+    {
+        return rects;
+    }
+
+    const float * weights_begin() const
+    {
+        return weights;
+    }
+
+    /**
+     * Writes the wavelet as HaarWavelet::write() does: the amount of rectangles, then the
+     * position, size and weight of each one.
+     */
+    bool write(std::ostream & out) const
+    {
+        out << size;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            out << ' ' << rects[i].x
+                << ' ' << rects[i].y
+                << ' ' << rects[i].width
+                << ' ' << rects[i].height
+                << ' ' << weights[i];
+        }
+        return true;
+    }
+
+private:
+    const BinaryRect * const rects;
+    const float * const weights;
+    const std::size_t size;
+};
+
+
+
+/**
+ * A strong hypothesis or a wavelet pool in a versioned, little-endian, binary file, made to be
+ * memory-mapped and read in place instead of parsed.
+ *
+ * The file starts with a 64 byte Header, followed by three sections, each aligned to 64 bytes:
+ * the BinaryModelEntry of each weak classifier, the BinaryRect of all wavelets and the weights
+ * of those rectangles. The header and each section have their own CRC-32.
+ *
+ * Only wavelets that are a list of weighted rectangles (HaarWavelet) can be kept in this format.
+ * A binary strong hypothesis is read through BinaryWavelet views, such as MappedStrongHypothesis
+ * does; a binary pool is loaded into HaarWavelets by loadBinaryHaarClassifiers().
+ *
+ * Thresholds only mean something to the evaluator they were trained with, so the header of a
+ * strong hypothesis records it (see BinaryModelEvaluator), and it is only mapped for that one.
+ * Version 1 files did not record it, and are not read.
+ */
+class BinaryModel
+{
+public:
+
+    enum Kind {
+        strongHypothesisKind = 1,
+        waveletPoolKind = 2
+    };
+
+    enum Evaluator {
+        noEvaluator = 0, //wavelet pools
+        varianceNormalizedEvaluator = 1,
+        intensityNormalizedEvaluator = 2
+    };
+
+    BinaryModel() : file(),
+                    region(),
+                    header(0),
+                    entries(0),
+                    rects(0),
+                    weights(0) {}
+
+
+
+    /**
+     * Maps the binary model at path and checks its header and checksums.
+     * @return false if path is not a binary model of this version, or it is corrupt.
+     */
+    bool map(const std::string & path)
+    {
+        clear();
+
+        try
+        {
+            file.reset( new boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only) );
+            region.reset( new boost::interprocess::mapped_region(*file, boost::interprocess::read_only) );
+        }
+        catch (const boost::interprocess::interprocess_exception &)
+        {
+            clear();
+            return false;
+        }
+
+        const char * const base = (const char *)region->get_address();
+        const std::size_t size = region->get_size();
+        const Header * const h = (const Header *)base;
+        if ( size < sizeof(Header)
+             || !std::equal(magic(), magic() + MAGIC_LENGTH, h->magic)
+             || h->version != VERSION
+             || h->byteOrder != BYTE_ORDER_MARK
+             || h->headerCrc != headerChecksum(*h)
+             || !section(size, h->entriesOffset, (std::size_t)h->entries * sizeof(BinaryModelEntry))
+             || !section(size, h->rectsOffset, (std::size_t)h->rectangles * sizeof(BinaryRect))
+             || !section(size, h->weightsOffset, (std::size_t)h->rectangles * sizeof(float))
+             || h->entriesCrc != checksum(base + h->entriesOffset, (std::size_t)h->entries * sizeof(BinaryModelEntry))
+             || h->rectsCrc != checksum(base + h->rectsOffset, (std::size_t)h->rectangles * sizeof(BinaryRect))
+             || h->weightsCrc != checksum(base + h->weightsOffset, (std::size_t)h->rectangles * sizeof(float)) )
+        {
+            clear();
+            return false;
+        }
+
+        header = h;
+        entries = (const BinaryModelEntry *)(base + h->entriesOffset);
+        rects = (const BinaryRect *)(base + h->rectsOffset);
+        weights = (const float *)(base + h->weightsOffset);
+
+        //Entries must not point past the rectangles
+        for (boost::uint32_t k = 0; k < h->entries; ++k)
+        {
+            if ( entries[k].firstRect > h->rectangles || entries[k].dimensions > h->rectangles - entries[k].firstRect )
+            {
+                clear();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+
+    void clear()
+    {
+        header = 0;
+        entries = 0;
+        rects = 0;
+        weights = 0;
+        region.reset();
+        file.reset();
+    }
+
+
+
+    /**
+     * @return true if the file at path starts as a binary model does, whatever its version.
+     */
+    static bool isBinary(const std::string & path)
+    {
+        char start[MAGIC_LENGTH];
+        std::ifstream in(path.c_str(), std::ios::binary);
+        return in.read(start, MAGIC_LENGTH) && std::equal(magic(), magic() + MAGIC_LENGTH, start);
+    }
+
+
+
+    Kind kind() const
+    {
+        return (Kind)header->kind;
+    }
+
+    Evaluator evaluator() const
+    {
+        return (Evaluator)header->evaluator;
+    }
+
+    std::size_t size() const
+    {
+        return header ? header->entries : 0;
+    }
+
+    const BinaryModelEntry & entry(const std::size_t k) const
+    {
+        return entries[k];
+    }
+
+    BinaryWavelet wavelet(const std::size_t k) const
+    {
+        return BinaryWavelet(rects + entries[k].firstRect, weights + entries[k].firstRect, entries[k].dimensions);
+    }
+
+
+
+    /**
+     * Writes a strong hypothesis of ThresholdedWeakClassifier of HaarWavelet to path, atomically,
+     * for the evaluator of WeakHypothesisType.
+     */
+    template<typename WeakHypothesisType>
+    static bool write(const std::string & path, const StrongHypothesis<WeakHypothesisType> & strongHypothesis)
+    {
+        Builder builder;
+        for (std::size_t k = 0; k < strongHypothesis.size(); ++k)
+        {
+            const WeakHypothesisType & weakHypothesis = strongHypothesis.weakHypothesis(k);
+            builder.add(strongHypothesis.alpha(k), weakHypothesis.getPolarity(), weakHypothesis.getThreshold(), weakHypothesis.getFeature());
+        }
+        return builder.write(path, strongHypothesisKind, BinaryModelEvaluator<typename WeakHypothesisType::evaluator_type>::value);
+    }
+
+
+
+    /**
+     * Writes the wavelets of a pool of ThresholdedWeakClassifier of HaarWavelet to path, atomically.
+     */
+    template<typename WeakHypothesisType>
+    static bool write(const std::string & path, const std::vector<WeakHypothesisType> & pool)
+    {
+        Builder builder;
+        for (typename std::vector<WeakHypothesisType>::const_iterator it = pool.begin(); it != pool.end(); ++it)
+        {
+            builder.add(0, 1, 0, it->getFeature());
+        }
+        return builder.write(path, waveletPoolKind, noEvaluator);
+    }
+
+private:
+
+    static const char * magic()
+    {
+        return "ABPMDL";
+    }
+
+    static const std::size_t MAGIC_LENGTH = 6;
+    static const boost::uint32_t VERSION = 2;
+
+    /** Reads as this number only on the little-endian hosts the format is written and read on */
+    static const boost::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    /** Sections start at multiples of this many bytes */
+    static const std::size_t ALIGNMENT = 64;
+
+    struct Header
+    {
+        char magic[8];
+        boost::uint32_t version;
+        boost::uint32_t byteOrder;
+        boost::uint32_t kind;
+        boost::uint32_t entries;
+        boost::uint32_t rectangles;
+        boost::uint32_t entriesOffset;
+        boost::uint32_t rectsOffset;
+        boost::uint32_t weightsOffset;
+        boost::uint32_t entriesCrc;
+        boost::uint32_t rectsCrc;
+        boost::uint32_t weightsCrc;
+        boost::uint32_t headerCrc; //of the bytes above and of evaluator
+        boost::uint32_t evaluator;
+        char reserved[4];
+    };
+
+    static const std::size_t HEADER_CHECKED_BYTES = 8 + 11 * sizeof(boost::uint32_t);
+
+
+
+    /**
+     * Collects the sections of a binary model before writing it.
+     */
+    struct Builder
+    {
+        std::vector<BinaryModelEntry> entries;
+        std::vector<BinaryRect> rects;
+        std::vector<float> weights;
+
+        template<typename FeatureType>
+        void add(const float alpha, const float polarity, const float theta, const FeatureType & feature)
+        {
+            const BinaryModelEntry entry = { alpha, polarity, theta, (boost::uint32_t)rects.size(), (boost::uint32_t)feature.dimensions() };
+            entries.push_back(entry);
+
+            std::vector<cv::Rect>::const_iterator rect = feature.rects_begin();
+            std::vector<float>::const_iterator weight = feature.weights_begin();
+            for (std::size_t i = 0; i < feature.dimensions(); ++i, ++rect, ++weight)
+            {
+                const BinaryRect r = { (boost::int16_t)rect->x, (boost::int16_t)rect->y, (boost::int16_t)rect->width, (boost::int16_t)rect->height };
+                rects.push_back(r);
+                weights.push_back(*weight);
+            }
+        }
+
+        bool write(const std::string & path, const Kind kind, const Evaluator evaluator) const
+        {
+            const boost::uint32_t one = 1;
+            if ( *(const char *)&one != 1 ) //the format is little-endian
+            {
+                return false;
+            }
+
+            Header header;
+            std::fill((char *)&header, (char *)&header + sizeof(header), 0);
+            std::copy(magic(), magic() + MAGIC_LENGTH, header.magic);
+            header.version = VERSION;
+            header.byteOrder = BYTE_ORDER_MARK;
+            header.kind = kind;
+            header.evaluator = evaluator;
+            header.entries = entries.size();
+            header.rectangles = rects.size();
+            header.entriesOffset = align(sizeof(Header));
+            header.rectsOffset = align(header.entriesOffset + entries.size() * sizeof(BinaryModelEntry));
+            header.weightsOffset = align(header.rectsOffset + rects.size() * sizeof(BinaryRect));
+
+            std::string contents(header.weightsOffset + weights.size() * sizeof(float), '\0');
+            copy(contents, header.entriesOffset, entries);
+            copy(contents, header.rectsOffset, rects);
+            copy(contents, header.weightsOffset, weights);
+
+            header.entriesCrc = checksum(contents.data() + header.entriesOffset, entries.size() * sizeof(BinaryModelEntry));
+            header.rectsCrc = checksum(contents.data() + header.rectsOffset, rects.size() * sizeof(BinaryRect));
+            header.weightsCrc = checksum(contents.data() + header.weightsOffset, weights.size() * sizeof(float));
+            header.headerCrc = headerChecksum(header);
+            std::copy((const char *)&header, (const char *)&header + sizeof(header), &contents[0]);
+
+            return replaceFile(path, contents);
+        }
+
+        template<typename T>
+        static void copy(std::string & contents, const std::size_t offset, const std::vector<T> & section)
+        {
+            if ( !section.empty() )
+            {
+                std::copy((const char *)&section[0], (const char *)&section[0] + section.size() * sizeof(T), &contents[offset]);
+            }
+        }
+
+        static boost::uint32_t align(const std::size_t offset)
+        {
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+    };
+
+
+
+    static boost::uint32_t checksum(const char * data, const std::size_t size)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, size);
+        return crc.checksum();
+    }
+
+    static boost::uint32_t headerChecksum(const Header & h)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes((const char *)&h, HEADER_CHECKED_BYTES);
+        crc.process_bytes((const char *)&h.evaluator, sizeof(h.evaluator));
+        return crc.checksum();
+    }
+
+    /**
+     * Whether a section of size bytes at offset is aligned and within a file of file_size bytes.
+     */
+    static bool section(const std::size_t file_size, const std::size_t offset, const std::size_t size)
+    {
+        return offset % ALIGNMENT == 0 && offset >= sizeof(Header) && offset <= file_size && size <= file_size - offset;
+    }
+
+    boost::scoped_ptr<boost::interprocess::file_mapping> file;
+    boost::scoped_ptr<boost::interprocess::mapped_region> region;
+
+    const Header * header;
+    const BinaryModelEntry * entries;
+    const BinaryRect * rects;
+    const float * weights;
+};
+
+
+
+/**
+ * Loads the wavelets of a binary wavelet pool to a vector of ThresholdedWeakClassifier, as
+ * loadHaarClassifiers() does for text pools. Each wavelet is built straight from the rectangles
+ * and weights it views in the mapped pool, as haarcommon's wavelets are built from a list of
+ * weighted rectangles.
+ * @return false if path is not a binary wavelet pool, or it is corrupt.
+ */
+template<typename FeatureType, typename EvaluatorType>
+bool loadBinaryHaarClassifiers(const std::string & path, std::vector< ThresholdedWeakClassifier<FeatureType, EvaluatorType> > & classifiers)
+{
+    BinaryModel model;
+    if ( !model.map(path) || model.kind() != BinaryModel::waveletPoolKind )
+    {
+        return false;
+    }
+
+    classifiers.reserve(classifiers.size() + model.size());
+    std::vector<cv::Rect> rects;
+    std::vector<float> weights;
+    for (std::size_t k = 0; k < model.size(); ++k)
+    {
+        const BinaryWavelet wavelet = model.wavelet(k);
+
+        rects.clear();
+        for (std::size_t i = 0; i < wavelet.dimensions(); ++i)
+        {
+            const BinaryRect & r = wavelet.rects_begin()[i];
+            rects.push_back( cv::Rect(r.x, r.y, r.width, r.height) );
+        }
+        weights.assign(wavelet.weights_begin(), wavelet.weights_begin() + wavelet.dimensions());
+
+        FeatureType feature(rects, weights);
+        classifiers.push_back( ThresholdedWeakClassifier<FeatureType, EvaluatorType>(feature) );
+    }
+
+    return true;
+}
+
+
+
+/**
+ * The Bayes weak classifiers read their wavelets in other ways than as one list of weighted
+ * rectangles, which is all a binary pool keeps, so they only load text pools.
+ * @return false.
+ */
+template<typename HaarClassifierType>
+bool loadBinaryHaarClassifiers(const std::string &, std::vector<HaarClassifierType> &)
+{
+    return false;
+}
+
+
+
+/**
+ * The evaluator of integralevaluators.h a binary strong hypothesis is written for and mapped
+ * with. The intensity normalized one reads band wavelets (MyHaarWavelet) as well, since those are
+ * kept as weighted rectangles too.
+ */
+template<typename IntegralsType>
+struct BinaryModelEvaluator< IntegralVarianceNormalizedEvaluator<IntegralsType> >
+{
+    static const BinaryModel::Evaluator value = BinaryModel::varianceNormalizedEvaluator;
+};
+
+template<typename IntegralsType>
+struct BinaryModelEvaluator< IntegralIntensityNormalizedEvaluator<IntegralsType> >
+{
+    static const BinaryModel::Evaluator value = BinaryModel::intensityNormalizedEvaluator;
+};
+
+
+
+/**
+ * A strong hypothesis evaluated in place from a mapped binary model: nothing is parsed or
+ * copied when it is loaded. Each wavelet is evaluated by EvaluatorType, one of the evaluators
+ * of integralevaluators.h, which should match the evaluator the strong hypothesis was trained with.
+ */
+template<typename EvaluatorType>
+class MappedStrongHypothesis
+{
+public:
+    MappedStrongHypothesis() : threshold(0),
+                               model(),
+                               evaluator() {}
+
+    /**
+     * @return false if path is not a binary strong hypothesis, or was written for another evaluator.
+     */
+    bool map(const std::string & path)
+    {
+        return model.map(path)
+               && model.kind() == BinaryModel::strongHypothesisKind
+               && model.evaluator() == BinaryModelEvaluator<EvaluatorType>::value;
+    }
+
+    void setThreshold(const float t)
+    {
+        threshold = t;
+    }
+
+    std::size_t size() const
+    {
+        return model.size();
+    }
+
+    Classification classify(const Example & example, const float scale = 1.0f) const
+    {
+        return classificationValue(example, scale) >= threshold ? yes : no;
+    }
+
+    Classification classify(const Example & example, const float scale, float & value) const
+    {
+        value = classificationValue(example, scale);
+        return value >= threshold ? yes : no;
+    }
+
+    /**
+     * Same as StrongHypothesis::classificationValue() of the model it was converted from, over
+     * the same evaluator. The normalization of the window is computed once for every wavelet.
+     */
+    float classificationValue(const Example & example, const float scale = 1.0f) const
+    {
+        const cv::Mat integralSum = example.getIntegralSum();
+        const double normalization = EvaluatorType::normalization(integralSum, example.getIntegralSquare());
+        float result = 0.0f;
+
+        for (std::size_t k = 0; k < model.size(); ++k)
+        {
+            const BinaryModelEntry & entry = model.entry(k);
+            const feature_value_type value = evaluator(model.wavelet(k), integralSum, scale, normalization);
+            result += entry.alpha * (value * entry.polarity <= entry.theta * entry.polarity ? yes : no);
+        }
+
+        return result;
+    }
+
+private:
+    float threshold;
+    BinaryModel model;
+    EvaluatorType evaluator;
+};
+
+
+
+#endif // BINARYMODEL_H
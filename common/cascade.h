@@ -0,0 +1,182 @@
+#ifndef CASCADE_H
+#define CASCADE_H
+
+#include <vector>
+#include <limits>
+#include <istream>
+#include <ostream>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "stronghypothesis.h"
+
+
+
+/**
+ * An attentional cascade (Viola and Jones 2004): a sequence of strong hypothesis, each with
+ * its own threshold, that classifies an example as positive only if every stage does. Most
+ * negative windows are rejected by the first, small, stages, so they never pay for the
+ * weak hypothesis of the later ones.
+ *
+ * Classifies examples as StrongHypothesis does, so it may be used wherever one is.
+ */
+template<typename WeakHypothesisType>
+class Cascade
+{
+public:
+    typedef StrongHypothesis<WeakHypothesisType> stage_type;
+
+    Cascade() : stages() {}
+
+
+
+    void insert(const boost::shared_ptr<stage_type> & stage)
+    {
+        stages.push_back(stage);
+    }
+
+    std::size_t size() const
+    {
+        return stages.size();
+    }
+
+    const stage_type & stage(const std::size_t i) const
+    {
+        return *stages[i];
+    }
+
+
+
+    Classification classify(const Example & example, const float scale = 1.0f) const
+    {
+        return depth(example, scale) == stages.size() ? yes : no;
+    }
+
+    /**
+     * Classifies the example and sets value to its classification value, evaluating each stage once.
+     */
+    Classification classify(const Example & example, const float scale, float & value) const
+    {
+        value = -std::numeric_limits<float>::max();
+        for (std::size_t i = 0; i < stages.size(); ++i)
+        {
+            value = stages[i]->classificationValue(example, scale);
+            if ( value < stages[i]->getThreshold() )
+            {
+                value = -std::numeric_limits<float>::max();
+                return no;
+            }
+        }
+        return yes;
+    }
+
+    /**
+     * The classification value of the last stage if every stage accepts the example, or the
+     * lowest float if one rejects it, as StrongHypothesis does for windows rejected early.
+     */
+    float classificationValue(const Example & example, const float scale = 1.0f) const
+    {
+        float value;
+        classify(example, scale, value);
+        return value;
+    }
+
+    /**
+     * How many stages, from the first, accept the example: the stage that rejects it, or
+     * size() if none does.
+     */
+    std::size_t depth(const Example & example, const float scale = 1.0f) const
+    {
+        std::size_t i = 0;
+        while ( i < stages.size() && stages[i]->classify(example, scale) == yes )
+        {
+            ++i;
+        }
+        return i;
+    }
+
+
+
+    /**
+     * Writes the amount of stages and then, for each stage, a line with its threshold and its
+     * amount of weak hypothesis followed by a line for each of them, as StrongHypothesis::write() does.
+     * Numbers are written precisely enough to be read back unchanged, since stage thresholds
+     * sit right at the score of a validation positive.
+     */
+    bool write(std::ostream & out) const
+    {
+        const std::streamsize precision = out.precision(std::numeric_limits<float>::digits10 + 3);
+
+        out << stages.size() << std::endl;
+        for (std::size_t i = 0; i < stages.size(); ++i)
+        {
+            out << stages[i]->getThreshold() << ' ' << stages[i]->size() << std::endl;
+            for (std::size_t k = 0; k < stages[i]->size(); ++k)
+            {
+                out << stages[i]->alpha(k) << ' ';
+                if ( !stages[i]->weakHypothesis(k).write(out) )
+                {
+                    out.precision(precision);
+                    return false;
+                }
+                out << std::endl;
+            }
+        }
+
+        out.precision(precision);
+        return out.good();
+    }
+
+
+
+    /**
+     * Reads a cascade written by write(), replacing the stages of this one. If reading fails,
+     * this cascade is left unchanged.
+     */
+    bool read(std::istream & in)
+    {
+        std::size_t count;
+        if ( !(in >> count) )
+        {
+            return false;
+        }
+
+        std::vector< boost::shared_ptr<stage_type> > read_stages;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            float threshold;
+            std::size_t entries;
+            if ( !(in >> threshold >> entries) )
+            {
+                return false;
+            }
+
+            boost::shared_ptr<stage_type> stage(new stage_type());
+            stage->setThreshold(threshold);
+            for (std::size_t k = 0; k < entries; ++k)
+            {
+                weight_type a;
+                WeakHypothesisType weak_hypothesis;
+                if ( !(in >> a) || !weak_hypothesis.read(in) )
+                {
+                    return false;
+                }
+                stage->insert(a, weak_hypothesis);
+            }
+
+            read_stages.push_back(stage);
+        }
+
+        stages.swap(read_stages);
+        return true;
+    }
+
+private:
+    std::vector< boost::shared_ptr<stage_type> > stages;
+};
+
+
+
+#endif // CASCADE_H
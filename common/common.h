@@ -36,4 +36,19 @@ enum Classification {
 
 
 
+/**
+ * Tells whether a weak hypothesis type can classify a window given a normalization of that
+ * window computed beforehand, through a static normalization(example) method and a
+ * classify(example, scale, normalization) overload. A strong hypothesis then computes the
+ * normalization once per window instead of once per weak hypothesis.
+ * Types not declared otherwise normalize each window on their own.
+ */
+template<typename WeakHypothesisType>
+struct SharesWindowNormalization
+{
+    static const bool value = false;
+};
+
+
+
 #endif /* COMMON_H_ */
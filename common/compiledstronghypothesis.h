@@ -0,0 +1,269 @@
+#ifndef COMPILEDSTRONGHYPOTHESIS_H
+#define COMPILEDSTRONGHYPOTHESIS_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "stronghypothesis.h"
+#include "weakhypothesis.h"
+#include "integralevaluators.h"
+
+
+
+/**
+ * Tells whether a strong hypothesis of WeakHypothesisType can be compiled to flat arrays (see
+ * CompiledStrongHypothesis): its weak hypothesis must be ThresholdedWeakClassifier over one of
+ * the evaluators of integralevaluators.h, whose arithmetic the compiled form repeats. haarcommon's
+ * evaluators are not in this tree, so the classifiers that use them are not compiled.
+ *
+ * detect, detect_pavani and the Viola-Jones, Pavani and band test tools read their models as the
+ * *IntegralClassifier models, and so scan compiled, unless given --haarcommon. The Bayes weak
+ * classifiers do not compile at all, so the test tools of those models (normhist, adhikari and
+ * rasolzadeh) always scan through the strong hypothesis.
+ */
+template<typename WeakHypothesisType>
+struct WeakHypothesisCompiles
+{
+    static const bool value = false;
+};
+
+template<typename FeatureType, typename IntegralsType>
+struct WeakHypothesisCompiles< ThresholdedWeakClassifier<FeatureType, IntegralVarianceNormalizedEvaluator<IntegralsType> > >
+{
+    static const bool value = true;
+};
+
+template<typename FeatureType, typename IntegralsType>
+struct WeakHypothesisCompiles< ThresholdedWeakClassifier<FeatureType, IntegralIntensityNormalizedEvaluator<IntegralsType> > >
+{
+    static const bool value = true;
+};
+
+
+
+/**
+ * A read-only form of a strong hypothesis made for scanning: the alpha, threshold and polarity of
+ * every weak hypothesis, and the rectangles and weights of every wavelet, each in a flat array.
+ * Before the windows of a scale are evaluated, layout() turns every rectangle into the offsets of
+ * its four corners in integral images of a given row stride. A window is then a tight loop over
+ * those arrays that reads the integral sum at its top left corner plus each offset.
+ *
+ * Values and classifications are exactly those of the strong hypothesis, rejection trace
+ * included, as long as the window's integrals have the stride the layout was made for. Windows
+ * that are regions of the same integral images share that stride.
+ *
+ * If the weak hypothesis do not compile (see WeakHypothesisCompiles), the same interface
+ * evaluates the strong hypothesis as is, so scanners can use it for any of them. Either way,
+ * the strong hypothesis must outlive the compiled one, and changes to it are not seen.
+ */
+template<typename WeakHypothesisType, bool compiles = WeakHypothesisCompiles<WeakHypothesisType>::value>
+class CompiledStrongHypothesis
+{
+public:
+    typedef typename WeakHypothesisType::integrals_type::sum_type sum_type;
+    typedef typename WeakHypothesisType::evaluator_type evaluator_type;
+
+    /**
+     * The corners of every rectangle at one scale, as offsets from the top left corner of a window
+     * in integral images whose rows are step elements apart: top left, top right, bottom left
+     * and bottom right of the first rectangle, then of the next one, and so on.
+     */
+    struct Layout
+    {
+        float scale;
+        std::size_t step;
+        std::vector<int> corners;
+
+        Layout() : scale(0),
+                   step(0),
+                   corners() {}
+    };
+
+
+
+    CompiledStrongHypothesis(const StrongHypothesis<WeakHypothesisType> & strongHypothesis) : threshold(strongHypothesis.getThreshold()),
+                                                                                              rejectionTrace(strongHypothesis.getRejectionTrace()),
+                                                                                              votes(),
+                                                                                              thresholds(),
+                                                                                              polarities(),
+                                                                                              ends(),
+                                                                                              rects(),
+                                                                                              weights()
+    {
+        for (std::size_t k = 0; k < strongHypothesis.size(); ++k)
+        {
+            const WeakHypothesisType & weakHypothesis = strongHypothesis.weakHypothesis(k);
+            votes.push_back(strongHypothesis.alpha(k) * no);
+            votes.push_back(strongHypothesis.alpha(k) * yes);
+            thresholds.push_back(weakHypothesis.getThreshold() * weakHypothesis.getPolarity());
+            polarities.push_back(weakHypothesis.getPolarity());
+
+            std::vector<cv::Rect>::const_iterator rect = weakHypothesis.getFeature().rects_begin();
+            std::vector<float>::const_iterator weight = weakHypothesis.getFeature().weights_begin();
+            for (std::size_t i = 0; i < weakHypothesis.getFeature().dimensions(); ++i, ++rect, ++weight)
+            {
+                rects.push_back(*rect);
+                weights.push_back(*weight);
+            }
+            ends.push_back(rects.size());
+        }
+    }
+
+
+
+    float getThreshold() const
+    {
+        return threshold;
+    }
+
+    std::size_t size() const
+    {
+        return ends.size();
+    }
+
+
+
+    /**
+     * Lays the rectangles out for windows of a scale in integral images of a row stride, in elements.
+     */
+    void layout(const float scale, const std::size_t step, Layout & layout) const
+    {
+        layout.scale = scale;
+        layout.step = step;
+        layout.corners.resize(4 * rects.size());
+
+        std::vector<int>::iterator corner = layout.corners.begin();
+        for (std::vector<cv::Rect>::const_iterator rect = rects.begin(); rect != rects.end(); ++rect)
+        {
+            //Scaled as IntegralEvaluatorBase::weightedSum() does
+            const int x = (int)(rect->x * scale);
+            const int y = (int)(rect->y * scale);
+            const int width = (int)(rect->width * scale);
+            const int height = (int)(rect->height * scale);
+
+            *corner++ = y * step + x;
+            *corner++ = y * step + x + width;
+            *corner++ = (y + height) * step + x;
+            *corner++ = (y + height) * step + x + width;
+        }
+    }
+
+
+
+    Classification classify(const Example & example, const Layout & layout) const
+    {
+        unsigned int evaluated;
+        return classificationValue(example, layout, evaluated) >= threshold ? yes : no;
+    }
+
+
+
+    /**
+     * Same as StrongHypothesis::classificationValue(example, layout.scale, evaluated).
+     */
+    float classificationValue(const Example & example, const Layout & layout, unsigned int & evaluated) const
+    {
+        const cv::Mat integralSum = example.getIntegralSum();
+        const sum_type * const window = integralSum.ptr<sum_type>(0);
+        const double normalization = evaluator_type::normalization(integralSum, example.getIntegralSquare());
+        const double area = (double)layout.scale * layout.scale;
+        const std::size_t traced = std::min(rejectionTrace.size(), ends.size());
+
+        const int * corner = layout.corners.empty() ? 0 : &layout.corners[0];
+        std::size_t r = 0;
+        float result = .0f;
+        for (std::size_t k = 0; k < ends.size(); ++k)
+        {
+            //Summed in the same order and types as the evaluators, for the same feature values
+            double sum = 0;
+            for (; r < ends[k]; ++r, corner += 4)
+            {
+                sum += weights[r] * (double)(sum_type)(window[corner[3]] - window[corner[2]] - window[corner[1]] + window[corner[0]]);
+            }
+            const feature_value_type value = sum / area / normalization;
+
+            //The vote is looked up rather than branched on: which way a window goes is as good as random
+            result += votes[2 * k + (value * polarities[k] <= thresholds[k])];
+
+            if ( k < traced && result < rejectionTrace[k] )
+            {
+                evaluated = k + 1;
+                return -std::numeric_limits<float>::max();
+            }
+        }
+
+        evaluated = ends.size();
+        return result;
+    }
+
+private:
+    const float threshold;
+    const std::vector<float> rejectionTrace;
+
+    std::vector<weight_type> votes;         //alpha times no, then alpha times yes, of each weak hypothesis
+    std::vector<float> thresholds;          //theta times polarity
+    std::vector<float> polarities;
+    std::vector<std::size_t> ends;          //one past the last rectangle of each weak hypothesis
+
+    std::vector<cv::Rect> rects;            //in the coordinates of the unscaled detector window
+    std::vector<float> weights;
+};
+
+
+
+/**
+ * Weak hypothesis that do not compile are evaluated by the strong hypothesis itself, at the
+ * scale of the layout.
+ */
+template<typename WeakHypothesisType>
+class CompiledStrongHypothesis<WeakHypothesisType, false>
+{
+public:
+    struct Layout
+    {
+        float scale;
+
+        Layout() : scale(0) {}
+    };
+
+
+
+    CompiledStrongHypothesis(const StrongHypothesis<WeakHypothesisType> & strongHypothesis_) : strongHypothesis(strongHypothesis_) {}
+
+    float getThreshold() const
+    {
+        return strongHypothesis.getThreshold();
+    }
+
+    std::size_t size() const
+    {
+        return strongHypothesis.size();
+    }
+
+    void layout(const float scale, const std::size_t, Layout & layout) const
+    {
+        layout.scale = scale;
+    }
+
+    Classification classify(const Example & example, const Layout & layout) const
+    {
+        return strongHypothesis.classify(example, layout.scale);
+    }
+
+    float classificationValue(const Example & example, const Layout & layout, unsigned int & evaluated) const
+    {
+        return strongHypothesis.classificationValue(example, layout.scale, evaluated);
+    }
+
+private:
+    const StrongHypothesis<WeakHypothesisType> & strongHypothesis;
+};
+
+
+
+#endif // COMPILEDSTRONGHYPOTHESIS_H
@@ -0,0 +1,183 @@
+#ifndef INTEGRALEVALUATORS_H
+#define INTEGRALEVALUATORS_H
+
+#include <cmath>
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "integralimage.h"
+
+
+
+/**
+ * Haar wavelet evaluators that read integral images of any representation (see integralimage.h).
+ *
+ * Rectangle sums are taken in the integral's own element type, which is exact for integers,
+ * and only then converted to double. The value of a feature is therefore the same for every
+ * representation that holds the integrals exactly, so DoubleIntegrals and Int32Integrals
+ * select the same features and thresholds.
+ *
+ * The wavelet must provide dimensions(), rects_begin() and weights_begin(), as haarcommon's
+ * HaarWavelet does. Its rectangles are in the coordinates of the unscaled detector window.
+ *
+ * Each evaluator also splits its work in two: normalization() reads the statistics of the
+ * window it divides by, and the four argument operator() only sums the wavelet's rectangles.
+ * All weak classifiers of a strong one see the same window, so it computes the normalization
+ * once for all of them (see SharesWindowNormalization).
+ */
+template<typename IntegralsType>
+struct IntegralEvaluatorBase
+{
+    typedef typename IntegralsType::sum_type sum_type;
+    typedef typename IntegralsType::square_type square_type;
+
+    /**
+     * Sum of the pixels in a rectangle, from the integral image.
+     */
+    template<typename T>
+    static T rectangleSum(const cv::Mat & integral, const int x, const int y, const int width, const int height)
+    {
+        const T * const top    = integral.ptr<T>(y);
+        const T * const bottom = integral.ptr<T>(y + height);
+        return bottom[x + width] - bottom[x] - top[x + width] + top[x];
+    }
+
+    /**
+     * Weighted sum of the wavelet's rectangles, divided by the area scaling factor.
+     */
+    template<typename FeatureType>
+    static double weightedSum(const FeatureType & feature, const cv::Mat & integralSum, const float scale)
+    {
+        return weightedSum(feature.rects_begin(), feature.weights_begin(), feature.dimensions(), integralSum, scale);
+    }
+
+    template<typename RectIterator, typename WeightIterator>
+    static double weightedSum(RectIterator rect, WeightIterator weight, const std::size_t dimensions, const cv::Mat & integralSum, const float scale)
+    {
+        double sum = 0;
+        for (std::size_t i = 0; i < dimensions; ++i, ++rect, ++weight)
+        {
+            sum += *weight * (double)rectangleSum<sum_type>(integralSum,
+                                                            (int)(rect->x * scale),
+                                                            (int)(rect->y * scale),
+                                                            (int)(rect->width * scale),
+                                                            (int)(rect->height * scale));
+        }
+
+        return sum / ((double)scale * scale);
+    }
+
+    /**
+     * Amount of pixels in the window an integral image covers.
+     */
+    static double windowArea(const cv::Mat & integralSum)
+    {
+        return (double)(integralSum.rows - 1) * (integralSum.cols - 1);
+    }
+
+    /**
+     * Mean pixel intensity of the window.
+     */
+    static double windowMean(const cv::Mat & integralSum)
+    {
+        return rectangleSum<sum_type>(integralSum, 0, 0, integralSum.cols - 1, integralSum.rows - 1) / windowArea(integralSum);
+    }
+};
+
+
+
+/**
+ * Divides the feature value by the standard deviation of the window pixels, as Viola and Jones do.
+ */
+template<typename IntegralsType>
+struct IntegralVarianceNormalizedEvaluator : public IntegralEvaluatorBase<IntegralsType>
+{
+    typedef IntegralEvaluatorBase<IntegralsType> Base;
+
+    template<typename FeatureType>
+    float operator()(const FeatureType & feature, const cv::Mat & integralSum, const cv::Mat & integralSquare, const float scale) const
+    {
+        return (*this)(feature, integralSum, scale, normalization(integralSum, integralSquare));
+    }
+
+    /**
+     * The value of the feature in a window whose normalization() is already known.
+     */
+    template<typename FeatureType>
+    float operator()(const FeatureType & feature, const cv::Mat & integralSum, const float scale, const double normalization) const
+    {
+        return Base::weightedSum(feature, integralSum, scale) / normalization;
+    }
+
+    /**
+     * The standard deviation of the window pixels, or 1 if they are all the same.
+     */
+    static double normalization(const cv::Mat & integralSum, const cv::Mat & integralSquare)
+    {
+        const double mean = Base::windowMean(integralSum);
+        const double variance = Base::template rectangleSum<typename Base::square_type>(integralSquare, 0, 0, integralSquare.cols - 1, integralSquare.rows - 1)
+                                / Base::windowArea(integralSum) - mean * mean;
+        return variance > 0 ? std::sqrt(variance) : 1.0;
+    }
+};
+
+
+
+/**
+ * Divides the feature value by the mean intensity of the window pixels, as Pavani et al. do.
+ */
+template<typename IntegralsType>
+struct IntegralIntensityNormalizedEvaluator : public IntegralEvaluatorBase<IntegralsType>
+{
+    typedef IntegralEvaluatorBase<IntegralsType> Base;
+
+    template<typename FeatureType>
+    float operator()(const FeatureType & feature, const cv::Mat & integralSum, const cv::Mat & integralSquare, const float scale) const
+    {
+        return (*this)(feature, integralSum, scale, normalization(integralSum, integralSquare));
+    }
+
+    template<typename FeatureType>
+    float operator()(const FeatureType & feature, const cv::Mat & integralSum, const float scale, const double normalization) const
+    {
+        return Base::weightedSum(feature, integralSum, scale) / normalization;
+    }
+
+    /**
+     * The mean intensity of the window pixels, or 1 if they are all black.
+     */
+    static double normalization(const cv::Mat & integralSum, const cv::Mat &)
+    {
+        const double mean = Base::windowMean(integralSum);
+        return mean > 0 ? mean : 1.0;
+    }
+};
+
+
+
+template<typename IntegralsType>
+struct EvaluatorIntegrals< IntegralVarianceNormalizedEvaluator<IntegralsType> >
+{
+    typedef IntegralsType type;
+};
+
+template<typename IntegralsType>
+struct EvaluatorIntegrals< IntegralIntensityNormalizedEvaluator<IntegralsType> >
+{
+    typedef IntegralsType type;
+};
+
+/**
+ * Divides by the mean, so only the integral sum is read. The Pavani and band programs train and
+ * detect with it, so their samples and scanned images keep no integral square. haarcommon's
+ * intensity normalized evaluator is declared so in weakhypothesis.h.
+ */
+template<typename IntegralsType>
+struct EvaluatorNeedsIntegralSquare< IntegralIntensityNormalizedEvaluator<IntegralsType> >
+{
+    static const bool value = false;
+};
+
+
+
+#endif // INTEGRALEVALUATORS_H
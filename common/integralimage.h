@@ -0,0 +1,93 @@
+#ifndef INTEGRALIMAGE_H
+#define INTEGRALIMAGE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+
+/**
+ * Computes the integral sum of an 8-bit image with elements of type SumType and, if asked
+ * to, its integral square. Otherwise the integral square is left empty.
+ */
+template<typename SumType>
+void computeIntegrals(const cv::Mat & image, cv::Mat & integralSum, cv::Mat & integralSquare, const bool withIntegralSquare)
+{
+    if (withIntegralSquare)
+    {
+        cv::integral(image, integralSum, integralSquare, cv::DataType<SumType>::type);
+    }
+    else
+    {
+        cv::integral(image, integralSum, cv::DataType<SumType>::type);
+        integralSquare.release();
+    }
+}
+
+
+
+/**
+ * Integral image representations. Each one defines the element types of the integral sum
+ * and of the integral square, and how to compute them from an 8-bit image.
+ */
+
+/**
+ * Both integrals as doubles. This is what haarcommon's evaluators expect.
+ */
+struct DoubleIntegrals
+{
+    typedef double sum_type;
+    typedef double square_type;
+
+    static void compute(const cv::Mat & image, cv::Mat & integralSum, cv::Mat & integralSquare, const bool withIntegralSquare = true)
+    {
+        computeIntegrals<sum_type>(image, integralSum, integralSquare, withIntegralSquare);
+    }
+};
+
+
+
+/**
+ * The integral sum as 32 bit integers, which is exact for 8-bit images of up to 2^31 / 255
+ * pixels (about 2900 x 2900). The integral square stays a double: a float loses precision
+ * past 2^24, which a 20 x 20 window of 8-bit pixels already exceeds, and OpenCV has no
+ * 64 bit integer matrices.
+ */
+struct Int32Integrals
+{
+    typedef int sum_type;
+    typedef double square_type;
+
+    static void compute(const cv::Mat & image, cv::Mat & integralSum, cv::Mat & integralSquare, const bool withIntegralSquare = true)
+    {
+        computeIntegrals<sum_type>(image, integralSum, integralSquare, withIntegralSquare);
+    }
+};
+
+
+
+/**
+ * Tells whether an evaluator reads the integral square, that is, whether it normalizes
+ * by the variance of the window. Evaluators not declared otherwise are assumed to.
+ */
+template<typename EvaluatorType>
+struct EvaluatorNeedsIntegralSquare
+{
+    static const bool value = true;
+};
+
+
+
+/**
+ * Tells which integral representation an evaluator reads. Evaluators not declared
+ * otherwise, such as haarcommon's, read DoubleIntegrals.
+ */
+template<typename EvaluatorType>
+struct EvaluatorIntegrals
+{
+    typedef DoubleIntegrals type;
+};
+
+
+
+#endif // INTEGRALIMAGE_H
@@ -13,10 +13,18 @@ private:
     cv::Mat integralSum;
     cv::Mat integralSquare;
 
-    void updateIntegrals(const cv::Mat & image)
+    void updateIntegrals(const cv::Mat & image, const bool withIntegralSquare)
     {
-        cv::integral(image, integralSum, integralSquare, cv::DataType<double>::type);
-        if (!integralSum.data || !integralSquare.data)
+        if (withIntegralSquare)
+        {
+            cv::integral(image, integralSum, integralSquare, cv::DataType<double>::type);
+        }
+        else
+        {
+            cv::integral(image, integralSum, cv::DataType<double>::type);
+        }
+
+        if (!integralSum.data || (withIntegralSquare && !integralSquare.data))
         {
             throw 137;
         }
@@ -26,16 +34,25 @@ public:
     Example() : integralSum   (21, 21, cv::DataType<double>::type),
                 integralSquare(21, 21, cv::DataType<double>::type) {}
 
-    Example(const cv::Mat & e) : integralSum   (21, 21, cv::DataType<double>::type),
-                                 integralSquare(21, 21, cv::DataType<double>::type)
+    /**
+     * Computes the integral images of an image. The integral square is only needed by
+     * variance normalized evaluators; without it, getIntegralSquare() returns an empty cv::Mat.
+     */
+    Example(const cv::Mat & e, const bool withIntegralSquare = true) : integralSum   (21, 21, cv::DataType<double>::type),
+                                                                       integralSquare(withIntegralSquare ? cv::Mat(21, 21, cv::DataType<double>::type) : cv::Mat())
     {
-        updateIntegrals(e);
+        updateIntegrals(e, withIntegralSquare);
     }
 
+    /**
+     * Wraps existing integral images. They may be cv::Mat headers over memory the Example
+     * does not own (see SampleStore), in which case that memory must outlive it.
+     * The integral square may be empty.
+     */
     Example(const cv::Mat & integralSum_, const cv::Mat & integralSquare_) : integralSum(integralSum_),
                                                                              integralSquare(integralSquare_)
     {
-        if (!integralSum.data || !integralSquare.data || integralSum.size != integralSquare.size)
+        if (!integralSum.data || (integralSquare.data && integralSum.size != integralSquare.size))
         {
             throw 141;
         }
@@ -50,6 +67,11 @@ public:
     {
         return integralSquare;
     }
+
+    bool hasIntegralSquare() const
+    {
+        return integralSquare.data != 0;
+    }
 };
 
 
@@ -65,8 +87,15 @@ public:
     LabeledExample() : Example(),
                        label(no) {}
 
-    LabeledExample (const cv::Mat & e, const Classification c) : Example(e),
-                                                                 label(c) {}
+    LabeledExample (const cv::Mat & e,
+                    const Classification c,
+                    const bool withIntegralSquare = true) : Example(e, withIntegralSquare),
+                                                            label(c) {}
+
+    LabeledExample (const cv::Mat & integralSum_,
+                    const cv::Mat & integralSquare_,
+                    const Classification c) : Example(integralSum_, integralSquare_),
+                                              label(c) {}
 
     Classification getLabel() const
     {
@@ -0,0 +1,244 @@
+#include "modeljournal.h"
+
+#include <deque>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "atomicfile.h"
+
+
+
+namespace
+{
+
+/**
+ * The payload of the first record of a journal, followed by the amount of entries in the model
+ * file. Entries are recorded as their alpha followed by their weak hypothesis, so they never
+ * start like this.
+ */
+const std::string basePrefix = "base ";
+
+
+
+std::string record(const std::string & payload)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(payload.data(), payload.size());
+
+    char checksum[10];
+    std::sprintf(checksum, "%08x ", (unsigned int)crc.checksum());
+
+    return checksum + payload + '\n';
+}
+
+}
+
+
+
+/**
+ * The journal file and the background thread that writes whatever records are pending to it,
+ * fsyncs them all at once and waits for more.
+ */
+class ModelJournal::Writer
+{
+public:
+    Writer(const std::string & journalPath) : fd(::open(journalPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)),
+                                              pending(),
+                                              appended(0),
+                                              written(0),
+                                              failed(false),
+                                              stopping(false),
+                                              mutex(),
+                                              queued(),
+                                              synced(),
+                                              thread()
+    {
+        if (fd < 0)
+        {
+            throw 219;
+        }
+        thread = boost::thread(&Writer::run, this);
+    }
+
+    ~Writer()
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            stopping = true;
+        }
+        queued.notify_one();
+        thread.join();
+
+        ::close(fd);
+    }
+
+    void append(const std::string & line)
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            pending.push_back(line);
+            ++appended;
+        }
+        queued.notify_one();
+    }
+
+    bool flush()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        while (written < appended && !failed)
+        {
+            synced.wait(lock);
+        }
+        return !failed;
+    }
+
+private:
+    void run()
+    {
+        std::deque<std::string> batch;
+        boost::mutex::scoped_lock lock(mutex);
+        while (true)
+        {
+            while ( pending.empty() && !stopping )
+            {
+                queued.wait(lock);
+            }
+            if ( pending.empty() )
+            {
+                return;
+            }
+
+            batch.swap(pending);
+            const unsigned long count = batch.size();
+            lock.unlock();
+
+            bool ok = true;
+            for (std::deque<std::string>::const_iterator it = batch.begin(); ok && it != batch.end(); ++it)
+            {
+                ok = writeAll(fd, it->data(), it->size());
+            }
+            ok = ok && ::fdatasync(fd) == 0;
+            batch.clear();
+
+            lock.lock();
+            written += count;
+            failed = failed || !ok;
+            synced.notify_all();
+        }
+    }
+
+    const int fd;
+
+    /** Records waiting for the writer */
+    std::deque<std::string> pending;
+    unsigned long appended;
+    unsigned long written;
+    bool failed;
+    bool stopping;
+
+    boost::mutex mutex;
+    boost::condition_variable queued;
+    boost::condition_variable synced;
+    boost::thread thread;
+};
+
+
+
+ModelJournal::ModelJournal(const std::string & path_, const std::string & model, const std::size_t base) : path(path_),
+                                                                                                          writer()
+{
+    if ( !replaceFile(path, model) )
+    {
+        throw 219;
+    }
+
+    writer.reset( new Writer(journalPath(path)) );
+
+    std::ostringstream payload;
+    payload << basePrefix << base;
+    writer->append( record(payload.str()) );
+}
+
+ModelJournal::~ModelJournal() {}
+
+
+
+void ModelJournal::append(const std::string & payload)
+{
+    writer->append( record(payload) );
+}
+
+bool ModelJournal::flush()
+{
+    return writer->flush();
+}
+
+bool ModelJournal::compact(const std::string & model)
+{
+    if ( !flush() || !replaceFile(path, model) )
+    {
+        return false;
+    }
+
+    ::unlink(journalPath(path).c_str());
+    return true;
+}
+
+
+
+bool ModelJournal::read(const std::string & path, std::size_t & base, std::vector<std::string> & payloads)
+{
+    base = 0;
+    payloads.clear();
+
+    std::ifstream in(journalPath(path).c_str(), std::ios::binary);
+    if ( !in.is_open() )
+    {
+        return false;
+    }
+
+    std::string line;
+    bool first = true;
+    while ( std::getline(in, line) && !in.eof() ) //a record not ended by a line break is torn
+    {
+        unsigned int checksum;
+        if ( line.size() < 9 || line[8] != ' ' || std::sscanf(line.c_str(), "%8x", &checksum) != 1 )
+        {
+            break;
+        }
+
+        boost::crc_32_type crc;
+        crc.process_bytes(line.data() + 9, line.size() - 9);
+        if (crc.checksum() != checksum)
+        {
+            break;
+        }
+
+        const std::string payload = line.substr(9);
+        if ( first && payload.compare(0, basePrefix.size(), basePrefix) == 0 )
+        {
+            std::istringstream(payload.substr(basePrefix.size())) >> base;
+        }
+        else
+        {
+            payloads.push_back(payload);
+        }
+        first = false;
+    }
+
+    return true;
+}
+
+std::string ModelJournal::journalPath(const std::string & path)
+{
+    return path + ".journal";
+}
@@ -0,0 +1,99 @@
+#ifndef MODELJOURNAL_H
+#define MODELJOURNAL_H
+
+#include <vector>
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+
+
+
+/**
+ * An append-only journal of the entries of a model being trained, kept next to the model
+ * file (see journalPath()), so that adding an entry writes only that entry.
+ *
+ * Each record is a line: the CRC-32 of its payload, in 8 hexadecimal digits, a space and the
+ * payload. Records are written and fsync'ed by a background thread, so append() never waits
+ * on the disk; records appended while the thread is writing are written together. A crash
+ * can only leave a torn last record behind, which read() detects and ignores.
+ *
+ * A record is therefore durable only once flush() returns after it was appended: a crash
+ * loses the records appended since the last batch was synced, even though append() returned
+ * for them. Training tolerates that: a resumed training takes the lost entries from its
+ * checkpoint when it holds them, and boosts their rounds again otherwise (see
+ * TrainingCheckpoint::follows()).
+ *
+ * The first record tells how many entries the model file held when the journal was started,
+ * so that the records can be told apart from the entries already in that file.
+ *
+ * When training ends, compact() atomically replaces the model file with the whole model and
+ * removes the journal.
+ *
+ * The writer lives in modeljournal.cpp, which is built as the modeljournal library.
+ */
+class ModelJournal
+{
+public:
+
+    /**
+     * Atomically replaces the model file at path with model, which holds base entries (see
+     * replaceFile()), and only then starts a new journal for it. A journal left there before
+     * is replaced, so whatever it recorded must be in model.
+     * Throws 219 if the model or the journal can not be written.
+     */
+    ModelJournal(const std::string & path, const std::string & model, const std::size_t base);
+
+    /**
+     * Writes the records still pending, then closes the journal. The journal file is kept.
+     */
+    ~ModelJournal();
+
+
+
+    /**
+     * Queues a record to be written. Returns immediately, before the record is on disk (see
+     * flush()). The payload must not contain line breaks.
+     */
+    void append(const std::string & payload);
+
+    /**
+     * Waits until every record appended so far is on disk.
+     * @return false if a record could not be written.
+     */
+    bool flush();
+
+    /**
+     * Atomically replaces the model file with model (see replaceFile()). Only then is the
+     * journal removed, so there is no moment when neither of them hold every record.
+     * @return false if the journal or the model could not be written. The journal is kept then.
+     */
+    bool compact(const std::string & model);
+
+
+
+    /**
+     * Reads the journal of the model at path: the amount of entries its model file held when
+     * the journal was started, and the payloads of the records that followed, up to the first
+     * torn or corrupt one. Journals that do not tell that amount were started on empty files.
+     * @return false if there is no journal.
+     */
+    static bool read(const std::string & path, std::size_t & base, std::vector<std::string> & payloads);
+
+    /**
+     * Where the journal of the model at path is kept.
+     */
+    static std::string journalPath(const std::string & path);
+
+private:
+    ModelJournal(const ModelJournal &);
+    ModelJournal & operator=(const ModelJournal &);
+
+    class Writer;
+
+    const std::string path;
+    boost::scoped_ptr<Writer> writer;
+};
+
+
+
+#endif // MODELJOURNAL_H
@@ -0,0 +1,221 @@
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <vector>
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "integralimage.h"
+
+
+
+/**
+ * Packs the integral images of a set of samples into a single cache aligned buffer.
+ *
+ * Each sample takes a fixed stride in the buffer: its integral sum followed by its integral
+ * square, padded to a whole number of cache lines. The integrals are converted to the
+ * representation the weak hypothesis read (see integralimage.h). The samples are exposed
+ * as LabeledExamples whose cv::Mat headers point into the buffer without owning it, so
+ * weak hypothesis evaluate them as usual while walking memory sequentially.
+ *
+ * The views are invalidated when the store is assigned again, cleared or destroyed.
+ */
+class SampleStore
+{
+public:
+    SampleStore() : rows(0),
+                    cols(0),
+                    stride(0),
+                    squareOffset(0),
+                    buffer(),
+                    examples() {}
+
+
+
+    /**
+     * Copies the integral images of the samples into the store, replacing its contents.
+     * All samples must have integral images of the same size. Integral sums are converted
+     * to IntegralsType::sum_type and integral squares to IntegralsType::square_type; the
+     * conversion is exact as long as the integrals of 8-bit images fit those types.
+     * Integral squares are neither stored nor required if withIntegralSquare is false.
+     * Throws 142 if the sizes differ.
+     *
+     * While the samples are kept, their integral images take memory twice. See the other
+     * assign() for samples that are only needed in the store.
+     */
+    template<typename IntegralsType>
+    void assign(const std::vector<const LabeledExample *> & samples, const bool withIntegralSquare = true)
+    {
+        clear();
+        if ( samples.empty() )
+        {
+            return;
+        }
+
+        allocate<IntegralsType>(samples[0]->getIntegralSum().rows, samples[0]->getIntegralSum().cols, samples.size(), withIntegralSquare);
+        for (std::vector<const LabeledExample *>::size_type i = 0; i < samples.size(); ++i)
+        {
+            append<IntegralsType>(samples[i]->getIntegralSum(), samples[i]->getIntegralSquare(), samples[i]->getLabel(), withIntegralSquare);
+        }
+    }
+
+    /**
+     * Computes the integral images of 8-bit images of the same size straight into the store,
+     * replacing its contents: image i is labeled labels[i], and its integrals are those
+     * a LabeledExample of it would have, converted as the other assign() does. Only the
+     * integrals of one image are held apart from the store at a time, so samples loaded as
+     * images rather than as LabeledExamples are never held twice.
+     * Throws 142 if the sizes differ or there are not as many labels as images.
+     */
+    template<typename IntegralsType>
+    void assign(const std::vector<cv::Mat> & images, const std::vector<Classification> & labels, const bool withIntegralSquare = true)
+    {
+        clear();
+        if ( images.size() != labels.size() )
+        {
+            throw 142;
+        }
+        if ( images.empty() )
+        {
+            return;
+        }
+
+        allocate<IntegralsType>(images[0].rows + 1, images[0].cols + 1, images.size(), withIntegralSquare);
+
+        cv::Mat integralSum;
+        cv::Mat integralSquare;
+        for (std::vector<cv::Mat>::size_type i = 0; i < images.size(); ++i)
+        {
+            //As Example computes them
+            if (withIntegralSquare)
+            {
+                cv::integral(images[i], integralSum, integralSquare, cv::DataType<double>::type);
+            }
+            else
+            {
+                cv::integral(images[i], integralSum, cv::DataType<double>::type);
+            }
+
+            append<IntegralsType>(integralSum, integralSquare, labels[i], withIntegralSquare);
+        }
+    }
+
+    void clear()
+    {
+        examples.clear();
+        buffer.clear();
+        rows = 0;
+        cols = 0;
+        stride = 0;
+        squareOffset = 0;
+    }
+
+
+
+    /**
+     * Points samples to the examples in this store, in the same order they were assigned.
+     */
+    void pointers(std::vector<const LabeledExample *> & samples) const
+    {
+        samples.resize(examples.size());
+        for (std::vector<LabeledExample>::size_type i = 0; i < examples.size(); ++i)
+        {
+            samples[i] = &examples[i];
+        }
+    }
+
+    const LabeledExample & operator[](const std::size_t i) const
+    {
+        return examples[i];
+    }
+
+    std::size_t size() const
+    {
+        return examples.size();
+    }
+
+    bool empty() const
+    {
+        return examples.empty();
+    }
+
+private:
+
+    /**
+     * Makes room for count samples whose integral images have the given size.
+     */
+    template<typename IntegralsType>
+    void allocate(const int rows_, const int cols_, const std::size_t count, const bool withIntegralSquare)
+    {
+        typedef typename IntegralsType::sum_type sum_type;
+        typedef typename IntegralsType::square_type square_type;
+
+        rows = rows_;
+        cols = cols_;
+
+        //The integral square starts right after the integral sum, aligned to its own element type
+        const std::size_t sum_bytes = (std::size_t)rows * cols * sizeof(sum_type);
+        squareOffset = (sum_bytes + sizeof(square_type) - 1) / sizeof(square_type) * sizeof(square_type);
+        const std::size_t sample_bytes = withIntegralSquare ? squareOffset + (std::size_t)rows * cols * sizeof(square_type)
+                                                            : sum_bytes;
+        stride = (sample_bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        buffer.resize( stride * count );
+
+        examples.reserve(count);
+    }
+
+    /**
+     * Converts the integral images of the next sample into the buffer.
+     */
+    template<typename IntegralsType>
+    void append(const cv::Mat & integralSum, const cv::Mat & integralSquare, const Classification label, const bool withIntegralSquare)
+    {
+        typedef typename IntegralsType::sum_type sum_type;
+        typedef typename IntegralsType::square_type square_type;
+
+        if ( integralSum.rows != rows || integralSum.cols != cols
+             || (withIntegralSquare && (integralSquare.rows != rows || integralSquare.cols != cols)) )
+        {
+            clear();
+            throw 142;
+        }
+
+        unsigned char * const sample = &buffer[0] + examples.size() * stride;
+        cv::Mat sum(rows, cols, cv::DataType<sum_type>::type, sample);
+        integralSum.convertTo(sum, cv::DataType<sum_type>::type);
+
+        cv::Mat square;
+        if (withIntegralSquare)
+        {
+            square = cv::Mat(rows, cols, cv::DataType<square_type>::type, sample + squareOffset);
+            integralSquare.convertTo(square, cv::DataType<square_type>::type);
+        }
+
+        examples.push_back( LabeledExample(sum, square, label) );
+    }
+
+    /** Strides are rounded up to a whole number of cache lines */
+    static const std::size_t CACHE_LINE = 64;
+
+    /** The size of the integral images */
+    int rows;
+    int cols;
+
+    /** Bytes from the beginning of a sample to the next one */
+    std::size_t stride;
+
+    /** Bytes from the beginning of a sample to its integral square */
+    std::size_t squareOffset;
+
+    std::vector<unsigned char, tbb::cache_aligned_allocator<unsigned char> > buffer;
+
+    /** Views of the samples in buffer */
+    std::vector<LabeledExample> examples;
+};
+
+
+
+#endif // SAMPLESTORE_H
@@ -2,11 +2,17 @@
 #define STRONGHYPOTHESIS_H_
 
 #include <vector>
+#include <algorithm>
 #include <string>
+#include <sstream>
 #include <fstream>
+#include <limits>
+#include <boost/scoped_ptr.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 
 #include "common.h"
 #include "labeledexample.h"
+#include "modeljournal.h"
 
 /**
  * Instances of this class hold the weights and weak classifiers that make the strong classifier.
@@ -35,30 +41,32 @@ private:
     float threshold;
     std::vector<entry> hypothesis;
 
-    const bool writeToStreamOnInsert;
-    const std::string path;
+    /**
+     * The soft cascade rejection trace: a window is rejected as soon as the sum of the first
+     * k + 1 weighted votes is below rejectionTrace[k]. Empty if every vote is always summed.
+     */
+    std::vector<float> rejectionTrace;
+
+    /** Records the entries inserted during training. Null if not training. */
+    boost::scoped_ptr<ModelJournal> journal;
 
 public:
     StrongHypothesis() : threshold(0),
                          hypothesis(0),
-                         writeToStreamOnInsert(false) {}
+                         rejectionTrace(),
+                         journal() {}
 
     /**
-     * This constructor should only be used during trainning. It sets the instance
-     * of this class to write to a file located at the path_ argument the new entries
-     * (alpha and WeakHypothesisType instances) that are insert()'ed in the instance.
+     * This constructor should only be used during trainning. It truncates the file located at
+     * the path_ argument and records each new entry that is insert()'ed in the instance (see
+     * record()).
      */
     StrongHypothesis(std::string path_) : threshold(0),
                                           hypothesis(0),
-                                          writeToStreamOnInsert(true),
-                                          path(path_)
+                                          rejectionTrace(),
+                                          journal()
     {
-        std::ofstream out( path.c_str(), std::ios::trunc );
-        if ( !out.is_open() )
-        {
-            throw 219;
-        }
-        out.close();
+        record(path_);
     }
 
     ~StrongHypothesis()
@@ -73,21 +81,172 @@ public:
         threshold = t;
     }
 
+    float getThreshold() const
+    {
+        return threshold;
+    }
+
+
+
+    /**
+     * Sets the soft cascade rejection trace (see calibrateRejectionTrace). Positions past the
+     * end of the trace never reject, and an empty trace turns early rejection off.
+     */
+    void setRejectionTrace(const std::vector<float> & trace)
+    {
+        rejectionTrace = trace;
+    }
+
+    const std::vector<float> & getRejectionTrace() const
+    {
+        return rejectionTrace;
+    }
+
+
+
+    /**
+     * The trace is kept apart from the strong hypothesis file, since it depends on the
+     * validation set and target detection rate it was calibrated for. It is written as the
+     * amount of positions followed by one rejection value per line.
+     */
+    bool writeRejectionTrace(std::ostream & out) const
+    {
+        const std::streamsize precision = out.precision(std::numeric_limits<float>::digits10 + 3);
+        out << rejectionTrace.size() << std::endl;
+        for (std::vector<float>::const_iterator it = rejectionTrace.begin(); it != rejectionTrace.end(); ++it)
+        {
+            out << *it << std::endl;
+        }
+        out.precision(precision);
+        return out.good();
+    }
+
+    bool readRejectionTrace(std::istream & in)
+    {
+        std::size_t count;
+        if ( !(in >> count) )
+        {
+            return false;
+        }
+
+        std::vector<float> trace(count);
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            if ( !(in >> trace[k]) )
+            {
+                return false;
+            }
+        }
+
+        rejectionTrace.swap(trace);
+        return true;
+    }
+
 
 
     void insert(weight_type alpha, WeakHypothesisType weak_hypothesis) {
         hypothesis.push_back( entry(alpha, weak_hypothesis) );
 
-        if (writeToStreamOnInsert)
+        if (journal)
+        {
+            journal->append( entryLine(alpha, weak_hypothesis) );
+        }
+    }
+
+
+
+    /**
+     * An entry as write() writes it, without the line break, and as the journal records it.
+     */
+    static std::string entryLine(const weight_type alpha, const WeakHypothesisType & weak_hypothesis)
+    {
+        std::ostringstream out;
+        out << alpha << ' ';
+        weak_hypothesis.write(out);
+        return out.str();
+    }
+
+
+
+    /**
+     * Starts recording the strong hypothesis to the file at path, for training: atomically
+     * replaces that file with the strong hypothesis as it is, and only then starts a new journal
+     * there (see ModelJournal), to which each entry (alpha and WeakHypothesisType instance)
+     * insert()'ed from now on is appended. Call compact() after training to write the whole
+     * strong hypothesis to that file.
+     * Throws 219 if the file or its journal can not be written.
+     */
+    void record(const std::string & path)
+    {
+        journal.reset();
+
+        std::ostringstream out;
+        write(out);
+        journal.reset( new ModelJournal(path, out.str(), hypothesis.size()) );
+    }
+
+
+
+    /**
+     * Ends training: atomically replaces the file given to record() with the whole strong
+     * hypothesis and removes the journal. Entries inserted afterwards are not recorded.
+     * @return false if the file could not be written. Its journal is kept then.
+     */
+    bool compact()
+    {
+        if (!journal)
+        {
+            return true;
+        }
+
+        std::ostringstream out;
+        write(out);
+        if ( !journal->compact(out.str()) )
         {
-            std::ofstream out( path.c_str(), std::ios::trunc );
-            if ( !out.is_open() )
+            return false;
+        }
+
+        journal.reset();
+        return true;
+    }
+
+
+
+    /**
+     * Inserts the entries recorded in the journal of the strong hypothesis at path, such as
+     * one left behind by an interrupted training, once the strong hypothesis file was read into
+     * this instance. Records of entries that file already holds, as it does if training was
+     * interrupted while compact()ing, are skipped.
+     * @return false if the journal does not follow the entries read or an entry could not be
+     * read. Having no journal is not an error.
+     */
+    bool recover(const std::string & path)
+    {
+        std::size_t base;
+        std::vector<std::string> entries;
+        if ( !ModelJournal::read(path, base, entries) )
+        {
+            return true;
+        }
+        if ( base > hypothesis.size() )
+        {
+            return false;
+        }
+
+        for (std::size_t k = hypothesis.size() - base; k < entries.size(); ++k)
+        {
+            std::istringstream in(entries[k]);
+            weight_type a;
+            WeakHypothesisType weak_hypothesis;
+            if ( !(in >> a) || !weak_hypothesis.read(in) )
             {
-                throw 220;
+                return false;
             }
-            write(out);
-            out.close();
+
+            insert(a, weak_hypothesis);
         }
+
+        return true;
     }
 
 
@@ -96,16 +255,32 @@ public:
         return classificationValue(example, scale) >= threshold ? yes : no;
     }
 
+    /**
+     * Classifies the example and sets value to its classification value, summing the votes once.
+     */
+    Classification classify(const Example & example, const float scale, float & value) const {
+        value = classificationValue(example, scale);
+        return value >= threshold ? yes : no;
+    }
+
 
 
     float classificationValue(const Example & example, const float scale = 1.0f) const {
-        float result = .0f;
+        unsigned int evaluated;
+        return classificationValue(example, scale, evaluated);
+    }
 
-        for (typename std::vector<entry>::const_iterator it = hypothesis.begin(); it != hypothesis.end(); ++it) {
-            result += (it->alpha) * (it->weakHypothesis.classify(example, scale));
-        }
 
-        return result;
+
+    /**
+     * With a rejection trace, windows rejected early get the lowest float, so that they rank
+     * below every window all votes were summed for.
+     * If the weak hypothesis share the normalization of a window (see SharesWindowNormalization),
+     * it is computed once here rather than by each of them.
+     * @param evaluated set to how many weak hypothesis were evaluated.
+     */
+    float classificationValue(const Example & example, const float scale, unsigned int & evaluated) const {
+        return classificationValue(example, scale, evaluated, boost::integral_constant<bool, SharesWindowNormalization<WeakHypothesisType>::value>());
     }
 
 
@@ -151,7 +326,100 @@ public:
         return true;
     }
 
-    //TODO accessor methods to the weak hypothesis
+    std::size_t size() const
+    {
+        return hypothesis.size();
+    }
+
+    weight_type alpha(const std::size_t i) const
+    {
+        return hypothesis[i].alpha;
+    }
+
+    const WeakHypothesisType & weakHypothesis(const std::size_t i) const
+    {
+        return hypothesis[i].weakHypothesis;
+    }
+
+
+
+private:
+    /**
+     * The vote of a weak hypothesis that normalizes the window on its own.
+     */
+    struct Vote
+    {
+        const Example & example;
+        const float scale;
+
+        Vote(const Example & example_, const float scale_) : example(example_),
+                                                             scale(scale_) {}
+
+        Classification operator()(const WeakHypothesisType & weakHypothesis) const
+        {
+            return weakHypothesis.classify(example, scale);
+        }
+    };
+
+    /**
+     * The vote of a weak hypothesis given the normalization of the window.
+     */
+    struct NormalizedVote
+    {
+        const Example & example;
+        const float scale;
+        const double normalization;
+
+        NormalizedVote(const Example & example_, const float scale_) : example(example_),
+                                                                       scale(scale_),
+                                                                       normalization(WeakHypothesisType::normalization(example_)) {}
+
+        Classification operator()(const WeakHypothesisType & weakHypothesis) const
+        {
+            return weakHypothesis.classify(example, scale, normalization);
+        }
+    };
+
+
+
+    float classificationValue(const Example & example, const float scale, unsigned int & evaluated, boost::false_type) const {
+        return sumVotes(Vote(example, scale), evaluated);
+    }
+
+    float classificationValue(const Example & example, const float scale, unsigned int & evaluated, boost::true_type) const {
+        return sumVotes(NormalizedVote(example, scale), evaluated);
+    }
+
+
+
+    template<typename VoteType>
+    float sumVotes(const VoteType & vote, unsigned int & evaluated) const {
+        float result = .0f;
+
+        if ( rejectionTrace.empty() )
+        {
+            for (typename std::vector<entry>::const_iterator it = hypothesis.begin(); it != hypothesis.end(); ++it) {
+                result += (it->alpha) * vote(it->weakHypothesis);
+            }
+
+            evaluated = hypothesis.size();
+            return result;
+        }
+
+        const std::size_t traced = std::min(rejectionTrace.size(), hypothesis.size());
+        for (std::size_t k = 0; k < hypothesis.size(); ++k) {
+            result += hypothesis[k].alpha * vote(hypothesis[k].weakHypothesis);
+
+            if ( k < traced && result < rejectionTrace[k] )
+            {
+                evaluated = k + 1;
+                return -std::numeric_limits<float>::max();
+            }
+        }
+
+        evaluated = hypothesis.size();
+        return result;
+    }
 };
 
 
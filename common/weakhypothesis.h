@@ -16,13 +16,34 @@
 
 #include "common.h"
 #include "labeledexample.h"
+#include "integralimage.h"
+#include "integralevaluators.h"
+#include "binarymodel.h"
 
 /**
- * Loads many WeakHypothesis found in a file to a vector of HaarClassifierType.
+ * haarcommon's intensity normalized evaluator divides by the mean, which only needs the integral
+ * sum. test/test_evaluators checks that it gives the same values with an empty integral square.
+ */
+template<>
+struct EvaluatorNeedsIntegralSquare<IntensityNormalizedWaveletEvaluator>
+{
+    static const bool value = false;
+};
+
+
+
+/**
+ * Loads many WeakHypothesis found in a file to a vector of HaarClassifierType. The file is a
+ * text wavelet pool, a wavelet per line, or a binary one (see binarymodel.h).
  */
 template<typename HaarClassifierType>
 bool loadHaarClassifiers(const std::string &filename, std::vector<HaarClassifierType> &classifiers)
 {
+    if ( BinaryModel::isBinary(filename) )
+    {
+        return loadBinaryHaarClassifiers(filename, classifiers);
+    }
+
     std::ifstream ifs;
     ifs.open(filename.c_str(), std::ifstream::in);
 
@@ -68,6 +89,14 @@ template <typename FeatureType, typename HaarEvaluatorType>
 class ThresholdedWeakClassifier
 {
 public:
+    /** The integral images representation the evaluator reads */
+    typedef typename EvaluatorIntegrals<HaarEvaluatorType>::type integrals_type;
+
+    typedef HaarEvaluatorType evaluator_type;
+
+    /** If false, samples and scanned images need no integral square */
+    static const bool needs_integral_square = EvaluatorNeedsIntegralSquare<HaarEvaluatorType>::value;
+
     //About those constructors and operator=, see the links below:
     //http://pages.cs.wisc.edu/~hasti/cs368/CppTutorial/NOTES/CLASSES-PTRS.html#destructor
     //http://stackoverflow.com/questions/6435404/c-error-double-free-or-corruption-fasttop
@@ -136,6 +165,21 @@ public:
         p = p_;
     }
 
+    const FeatureType & getFeature() const
+    {
+        return feature;
+    }
+
+    float getThreshold() const
+    {
+        return theta;
+    }
+
+    float getPolarity() const
+    {
+        return p;
+    }
+
 
 
     //This is supposed to be used only during trainning and ROC curve construction
@@ -146,7 +190,30 @@ public:
 
     Classification classify(const Example &example, const float scale = 1.0f) const
     {
-        return featureValue(example, scale) * p <= theta * p ? yes : no;
+        return classifyFeatureValue( featureValue(example, scale) );
+    }
+
+    //Classifies a feature value previously returned by featureValue()
+    Classification classifyFeatureValue(const feature_value_type featureValue) const
+    {
+        return featureValue * p <= theta * p ? yes : no;
+    }
+
+
+
+    /**
+     * What the evaluator divides feature values by in the example's window. Only for evaluators
+     * that share it (see SharesWindowNormalization).
+     */
+    static double normalization(const Example &example)
+    {
+        return HaarEvaluatorType::normalization(example.getIntegralSum(), example.getIntegralSquare());
+    }
+
+    //Same as classify(example, scale), given the normalization() of the example's window
+    Classification classify(const Example &example, const float scale, const double normalization) const
+    {
+        return classifyFeatureValue( evaluator(feature, example.getIntegralSum(), scale, normalization) );
     }
 
 private:
@@ -167,6 +234,37 @@ typedef ThresholdedWeakClassifier<HaarWavelet, IntensityNormalizedWaveletEvaluat
 //My classifier
 typedef ThresholdedWeakClassifier<MyHaarWavelet, IntensityNormalizedWaveletEvaluator> MyHaarClassifier;
 
+//Viola & Jones' classifier over 32 bit integer integral sums
+typedef ThresholdedWeakClassifier<HaarWavelet, IntegralVarianceNormalizedEvaluator<Int32Integrals> > ViolaJonesInt32Classifier;
+
+//The classifiers above, over the in-tree evaluators, which were written after haarcommon's. They
+//read the same models and, for detection, compute the normalization of a window once per strong
+//hypothesis (see SharesWindowNormalization) and scan compiled (see CompiledStrongHypothesis).
+//test/test_evaluators checks that they give haarcommon's feature and classification values bit
+//for bit on scanned windows; test/bench_evaluators times them against it on a trained model.
+//The detection programs read models as these unless given --haarcommon.
+typedef ThresholdedWeakClassifier<HaarWavelet, IntegralVarianceNormalizedEvaluator<DoubleIntegrals> > ViolaJonesIntegralClassifier;
+typedef ThresholdedWeakClassifier<HaarWavelet, IntegralIntensityNormalizedEvaluator<DoubleIntegrals> > PavaniHaarIntegralClassifier;
+typedef ThresholdedWeakClassifier<MyHaarWavelet, IntegralIntensityNormalizedEvaluator<DoubleIntegrals> > MyHaarIntegralClassifier;
+
+
+
+/**
+ * The in-tree evaluators can compute the normalization of a window apart from the feature value.
+ * haarcommon's evaluators can not, so the classifiers that use them normalize on their own.
+ */
+template<typename FeatureType, typename IntegralsType>
+struct SharesWindowNormalization< ThresholdedWeakClassifier<FeatureType, IntegralVarianceNormalizedEvaluator<IntegralsType> > >
+{
+    static const bool value = true;
+};
+
+template<typename FeatureType, typename IntegralsType>
+struct SharesWindowNormalization< ThresholdedWeakClassifier<FeatureType, IntegralIntensityNormalizedEvaluator<IntegralsType> > >
+{
+    static const bool value = true;
+};
+
 
 
 
@@ -429,6 +527,9 @@ template <typename PositiveProbabilityEvaluatorType, typename NegativeProbabilit
 class DualWeightVectorBayesWeakClassifier
 {
 public:
+    typedef DoubleIntegrals integrals_type;
+    static const bool needs_integral_square = EvaluatorNeedsIntegralSquare<IntensityNormalizedWaveletEvaluator>::value;
+
 
     DualWeightVectorBayesWeakClassifier() {}
 
@@ -500,6 +601,9 @@ template <typename DiscriminantType>
 class SingleWeightVectorBayesWeakClassifier
 {
 public:
+    typedef DoubleIntegrals integrals_type;
+    static const bool needs_integral_square = EvaluatorNeedsIntegralSquare<VarianceNormalizedWaveletEvaluator>::value;
+
 
     SingleWeightVectorBayesWeakClassifier() {}
 
@@ -0,0 +1,198 @@
+#include "batchdetector.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+
+
+FrameSource::FrameSource() : paths(),
+                             nextPath(0),
+                             video(),
+                             videoPath(),
+                             frames(0) {}
+
+
+
+bool FrameSource::openDirectory(const std::string & path)
+{
+    namespace fs = boost::filesystem;
+    if ( !fs::is_directory(path) )
+    {
+        return false;
+    }
+
+    paths.clear();
+    for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it)
+    {
+        if ( fs::is_regular_file(it->status()) )
+        {
+            paths.push_back(it->path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    nextPath = 0;
+    return true;
+}
+
+
+
+bool FrameSource::openList(const std::string & path)
+{
+    std::ifstream in(path.c_str());
+    if ( !in.is_open() )
+    {
+        return false;
+    }
+
+    paths.clear();
+    std::string line;
+    while ( std::getline(in, line) )
+    {
+        if ( !line.empty() )
+        {
+            paths.push_back(line);
+        }
+    }
+    nextPath = 0;
+    return true;
+}
+
+
+
+bool FrameSource::openVideo(const std::string & path)
+{
+    videoPath = path;
+    frames = 0;
+    return video.open(path);
+}
+
+
+
+boost::shared_ptr<Frame> FrameSource::next()
+{
+    if ( video.isOpened() )
+    {
+        cv::Mat image;
+        if ( !video.read(image) )
+        {
+            return boost::shared_ptr<Frame>();
+        }
+
+        //The capture may reuse its buffer, so the frame gets its own gray copy
+        const boost::shared_ptr<Frame> frame(new Frame(frames++, videoPath));
+        if ( image.channels() == 1 )
+        {
+            image.copyTo(frame->image);
+        }
+        else
+        {
+            cv::cvtColor(image, frame->image, cv::COLOR_BGR2GRAY);
+        }
+        return frame;
+    }
+
+    if ( nextPath >= paths.size() )
+    {
+        return boost::shared_ptr<Frame>();
+    }
+    const boost::shared_ptr<Frame> frame(new Frame(nextPath, paths[nextPath]));
+    ++nextPath;
+    return frame;
+}
+
+
+
+void FrameSource::decode(Frame & frame)
+{
+    if ( !frame.image.data )
+    {
+        frame.image = cv::imread(frame.source, cv::DataType<unsigned char>::type);
+    }
+}
+
+
+
+namespace
+{
+
+void writeJsonString(std::ostream & out, const std::string & s)
+{
+    out << '"';
+    for (std::string::const_iterator c = s.begin(); c != s.end(); ++c)
+    {
+        switch (*c)
+        {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n";  break;
+        case '\r': out << "\\r";  break;
+        case '\t': out << "\\t";  break;
+        default:
+            if ( (unsigned char)*c < 0x20 )
+            {
+                const char * hex = "0123456789abcdef";
+                out << "\\u00" << hex[(*c >> 4) & 0xf] << hex[*c & 0xf];
+            }
+            else
+            {
+                out << *c;
+            }
+        }
+    }
+    out << '"';
+}
+
+
+
+/**
+ * JSON has no infinities or NaN, so non-finite numbers are written as null.
+ */
+void writeJsonNumber(std::ostream & out, const float value)
+{
+    if ( (boost::math::isfinite)(value) )
+    {
+        out << value;
+    }
+    else
+    {
+        out << "null";
+    }
+}
+
+}
+
+
+
+std::string jsonLine(const Frame & frame)
+{
+    std::ostringstream out;
+    out << "{\"frame\":" << frame.index << ",\"source\":";
+    writeJsonString(out, frame.source);
+
+    if ( !frame.image.data )
+    {
+        out << ",\"error\":\"unreadable\"}";
+        return out.str();
+    }
+
+    out << ",\"width\":" << frame.image.cols << ",\"height\":" << frame.image.rows << ",\"detections\":[";
+    for (std::vector<Detection>::const_iterator detection = frame.detections.begin(); detection != frame.detections.end(); ++detection)
+    {
+        out << (detection == frame.detections.begin() ? "" : ",")
+            << "{\"x\":" << detection->rect.x
+            << ",\"y\":" << detection->rect.y
+            << ",\"width\":" << detection->rect.width
+            << ",\"height\":" << detection->rect.height
+            << ",\"score\":";
+        writeJsonNumber(out, detection->score);
+        out << ",\"neighbors\":" << detection->neighbors << '}';
+    }
+    out << "]}";
+
+    return out.str();
+}
@@ -0,0 +1,203 @@
+#ifndef BATCHDETECTOR_H
+#define BATCHDETECTOR_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "scanner.h"
+#include "grouping.h"
+
+
+
+/**
+ * A frame on its way through the pipeline of a BatchDetector.
+ */
+struct Frame
+{
+    std::size_t index;
+    std::string source;                 //the image file, or the video file the frame is from
+    cv::Mat image;                      //grayscale; empty if it could not be decoded
+    std::vector<Detection> detections;
+    std::string line;                   //the JSON line written for the frame
+
+    Frame(const std::size_t index_,
+          const std::string & source_) : index(index_),
+                                         source(source_),
+                                         image(),
+                                         detections(),
+                                         line() {}
+};
+
+
+
+/**
+ * The frames of a batch: the images of a directory or of a file list, or the frames of a video.
+ *
+ * Images are only named by next() and decoded by decode(), which BatchDetector runs in
+ * parallel. Video frames can only be decoded one after the other, so next() decodes them.
+ */
+class FrameSource
+{
+public:
+    FrameSource();
+
+    /**
+     * Every regular file of the directory, in name order. Files that are not images are
+     * reported as unreadable frames.
+     */
+    bool openDirectory(const std::string & path);
+
+    /**
+     * The image files named one per line in the file at path. Empty lines are skipped.
+     */
+    bool openList(const std::string & path);
+
+    bool openVideo(const std::string & path);
+
+    /**
+     * @return the next frame, or null after the last one. Not thread safe.
+     */
+    boost::shared_ptr<Frame> next();
+
+    /**
+     * Reads the image of a frame next() only named. Thread safe.
+     */
+    static void decode(Frame & frame);
+
+private:
+    std::vector<std::string> paths;
+    std::size_t nextPath;
+
+    cv::VideoCapture video;
+    std::string videoPath;
+    std::size_t frames;
+};
+
+
+
+/**
+ * Formats the detections of a frame as a line of JSON, such as
+ * {"frame":0,"source":"a.pgm","width":320,"height":240,"detections":[{"x":10,"y":12,"width":30,"height":30,"score":4.25,"neighbors":12}]}
+ * or, if the frame could not be decoded, {"frame":1,"source":"b.txt","error":"unreadable"}.
+ * Scores that are not finite are written as null.
+ */
+std::string jsonLine(const Frame & frame);
+
+
+
+/**
+ * Runs a detector over a batch of frames with a tbb::parallel_pipeline: frames are named (or,
+ * for videos, decoded) in order, then decoded, scanned and grouped in parallel, and written as
+ * JSON lines in order. At most maximumFramesInFlight frames are in memory at a time. Decoding
+ * images in parallel keeps it from limiting the throughput; scanning uses every core, both
+ * across frames and, through the Scanner, within each one. Frames are shared pointers, so
+ * those in flight are released if a stage throws and the pipeline is cancelled.
+ */
+template<typename WeakClassifierType, typename ClassifierType = StrongHypothesis<WeakClassifierType> >
+class BatchDetector
+{
+public:
+    BatchDetector(const Scanner<WeakClassifierType, ClassifierType> & scanner_,
+                  const DetectionGrouping & grouping_,
+                  const std::size_t maximumFramesInFlight_) : scanner(scanner_),
+                                                              grouping(grouping_),
+                                                              maximumFramesInFlight(maximumFramesInFlight_ ? maximumFramesInFlight_ : 1) {}
+
+
+
+    /**
+     * @return how many frames were written to out.
+     */
+    std::size_t run(FrameSource & source, std::ostream & out) const
+    {
+        std::size_t written = 0;
+        tbb::parallel_pipeline( maximumFramesInFlight,
+                                tbb::make_filter<void, FramePointer>( tbb::filter_mode::serial_in_order, NextFrame(source) )
+                              & tbb::make_filter<FramePointer, FramePointer>( tbb::filter_mode::parallel, DetectFrame(scanner, grouping) )
+                              & tbb::make_filter<FramePointer, void>( tbb::filter_mode::serial_in_order, WriteFrame(out, written) ) );
+        return written;
+    }
+
+private:
+    typedef boost::shared_ptr<Frame> FramePointer;
+
+
+
+    struct NextFrame
+    {
+        FrameSource & source;
+
+        NextFrame(FrameSource & source_) : source(source_) {}
+
+        FramePointer operator()(tbb::flow_control & control) const
+        {
+            const FramePointer frame = source.next();
+            if ( !frame )
+            {
+                control.stop();
+            }
+            return frame;
+        }
+    };
+
+
+
+    /**
+     * Decodes, scans and groups a frame, and formats its line.
+     */
+    struct DetectFrame
+    {
+        const Scanner<WeakClassifierType, ClassifierType> & scanner;
+        const DetectionGrouping & grouping;
+
+        DetectFrame(const Scanner<WeakClassifierType, ClassifierType> & scanner_,
+                    const DetectionGrouping & grouping_) : scanner(scanner_),
+                                                           grouping(grouping_) {}
+
+        FramePointer operator()(const FramePointer & frame) const
+        {
+            FrameSource::decode(*frame);
+            if ( frame->image.data )
+            {
+                scanner.detect(frame->image, frame->detections);
+                grouping.apply(frame->detections);
+            }
+            frame->line = jsonLine(*frame);
+            frame->image.release();
+            return frame;
+        }
+    };
+
+
+
+    struct WriteFrame
+    {
+        std::ostream & out;
+        std::size_t & written;
+
+        WriteFrame(std::ostream & out_, std::size_t & written_) : out(out_),
+                                                                 written(written_) {}
+
+        void operator()(const FramePointer & frame) const
+        {
+            out << frame->line << '\n';
+            ++written;
+        }
+    };
+
+
+
+    const Scanner<WeakClassifierType, ClassifierType> & scanner;
+    const DetectionGrouping grouping;
+    const std::size_t maximumFramesInFlight;
+};
+
+
+
+#endif // BATCHDETECTOR_H
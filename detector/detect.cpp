@@ -1,53 +1,106 @@
-#ifndef TEMPLATE_TESTCLASSIFIER_H
-#define TEMPLATE_TESTCLASSIFIER_H
-
 #include <vector>
 #include <iostream>
-
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+
 #include <tbb/tbb.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
-#include <boost/unordered_map.hpp>
-#include <boost/filesystem.hpp>
-
 #include "common.h"
 #include "stronghypothesis.h"
 #include "scanner.h"
+#include "grouping.h"
+#include "batchdetector.h"
 #include "weakhypothesis.h"
-#include "sampleextractor.h"
+#include "binarymodel.h"
 
 
 
 /**
- * Arguments:
- *     positivesIndexFile
- *     positivesImageFile
- *     negativesIndexFile
- *     negativesImageFile
- *     strongHypothesisInputFile
+ * Returns the argument that follows the flag among the optional command line arguments,
+ * or an empty string if the flag was not given.
  */
-int main(int, char **argv) {
-    const std::string imageFile = argv[1];
-    const std::string strongHypothesisFile = argv[2];
+std::string optionValue(const std::vector<std::string> & options, const std::string & flag)
+{
+    std::vector<std::string>::const_iterator it = std::find(options.begin(), options.end(), flag);
+    if ( it == options.end() || ++it == options.end() )
+    {
+        return std::string();
+    }
+    return *it;
+}
 
 
 
-    StrongHypothesis<MyHaarClassifier> strongHypothesis;
+/**
+ * Detects on every frame of source and writes the detections as JSON lines, without a window.
+ */
+template<typename WeakClassifierType, typename ClassifierType>
+int batch(const std::string & source,
+          const Scanner<WeakClassifierType, ClassifierType> & scanner,
+          const DetectionGrouping & grouping,
+          const std::vector<std::string> & options)
+{
+    FrameSource frames;
+    const bool opened = std::find(options.begin(), options.end(), "--video") != options.end()
+                      ? frames.openVideo(source)
+                      : frames.openDirectory(source) || frames.openList(source);
+    if ( !opened )
     {
-        std::ifstream in(strongHypothesisFile.c_str());
-        if ( !in.is_open() )
-        {
-            return 7;
-        }
-        if ( !strongHypothesis.read(in) )
-        {
-            return 11;
-        }
+        return 17;
+    }
 
-        std::cout << "Loaded strong classifier." << std::endl;
+    std::size_t inFlight = 2 * tbb::this_task_arena::max_concurrency();
+    std::stringstream(optionValue(options, "--frames")) >> inFlight;
+    const BatchDetector<WeakClassifierType, ClassifierType> detector(scanner, grouping, inFlight);
+
+    const std::string outputFile = optionValue(options, "--output");
+    if ( outputFile.empty() )
+    {
+        detector.run(frames, std::cout);
+        return 0;
+    }
+
+    std::ofstream out(outputFile.c_str());
+    if ( !out.is_open() )
+    {
+        return 19;
+    }
+    std::cerr << "Wrote " << detector.run(frames, out) << " frames to " << outputFile << '.' << std::endl;
+    return out.good() ? 0 : 19;
+}
+
+
+
+/**
+ * Detects on the image, or on every frame of the batch, with the classifier, made of weak
+ * classifiers of WeakClassifierType.
+ */
+template<typename WeakClassifierType, typename ClassifierType>
+int detect(const std::string & imageFile,
+           const bool batchMode,
+           const ClassifierType & classifier,
+           const std::vector<std::string> & options)
+{
+    //Thousands of windows around each face are merged into one box
+    DetectionGrouping grouping;
+    if ( !optionValue(options, "--group").empty() )
+    {
+        grouping.mode = DetectionGrouping::group;
+        std::stringstream(optionValue(options, "--group")) >> grouping.parameter;
+    }
+    else if ( !optionValue(options, "--nms").empty() )
+    {
+        grouping.mode = DetectionGrouping::nms;
+        std::stringstream(optionValue(options, "--nms")) >> grouping.parameter;
+    }
+
+    const Scanner<WeakClassifierType, ClassifierType> scanner(classifier);
+    if ( batchMode )
+    {
+        return batch(imageFile, scanner, grouping, options);
     }
 
 
@@ -58,16 +111,16 @@ int main(int, char **argv) {
         return 1;
     }
 
-    std::vector<cv::Rect> detections;
-    Scanner<MyHaarClassifier> scanner(&strongHypothesis);
-    scanner.scan(image, detections);
+    std::vector<Detection> detections;
+    scanner.detect(image, detections);
+    grouping.apply(detections);
 
     cv::Mat outputImage(image.rows, image.cols, CV_8UC3); //don't know how to use datatype here
     image.copyTo(outputImage);
 
-    for(std::vector<cv::Rect>::iterator detection = detections.begin(); detection != detections.end(); ++detection)
+    for(std::vector<Detection>::const_iterator detection = detections.begin(); detection != detections.end(); ++detection)
     {
-        cv::rectangle(outputImage, *detection, cv::Scalar(255,0,0));
+        cv::rectangle(outputImage, detection->rect, cv::Scalar(255,0,0));
     }
 
     cv::imshow("Detection results", outputImage);
@@ -77,4 +130,103 @@ int main(int, char **argv) {
 }
 
 
-#endif // TEMPLATE_TESTCLASSIFIER_H
+
+/**
+ * Reads the text strong hypothesis, and its rejection trace if there is one, as weak classifiers
+ * of WeakClassifierType, then detects with it.
+ */
+template<typename WeakClassifierType>
+int detectText(const std::string & imageFile,
+               const bool batchMode,
+               const std::string & strongHypothesisFile,
+               const float threshold,
+               const std::string & traceFile,
+               const std::vector<std::string> & options)
+{
+    StrongHypothesis<WeakClassifierType> strongHypothesis;
+    {
+        std::ifstream in(strongHypothesisFile.c_str());
+        if ( !in.is_open() )
+        {
+            return 7;
+        }
+        if ( !strongHypothesis.read(in) )
+        {
+            return 11;
+        }
+        strongHypothesis.setThreshold(threshold);
+
+        std::cerr << "Loaded strong classifier." << std::endl;
+    }
+
+    if ( !traceFile.empty() )
+    {
+        std::ifstream in(traceFile.c_str());
+        if ( !in.is_open() || !strongHypothesis.readRejectionTrace(in) )
+        {
+            return 13;
+        }
+
+        std::cerr << "Loaded rejection trace." << std::endl;
+    }
+
+    return detect<WeakClassifierType>(imageFile, batchMode, strongHypothesis, options);
+}
+
+
+
+/**
+ * Arguments:
+ *     imageFile | --batch (imagesDirectory | imageListFile | videoFile --video)
+ *     strongHypothesisInputFile (text, or binary as written by convertmodel)
+ *     [--threshold threshold (default 0)]
+ *     [--trace rejectionTraceFile (text models only)]
+ *     [--group minimumNeighbors | --nms maximumOverlap]
+ *     [--haarcommon]
+ * and, with --batch,
+ *     [--output jsonLinesFile (default standard output)]
+ *     [--frames mostFramesInFlight (default twice the threads)]
+ *
+ * Text models are read as MyHaarIntegralClassifier, over the in-tree evaluators, and scan compiled
+ * (see weakhypothesis.h). With --haarcommon they are read as MyHaarClassifier instead, over
+ * haarcommon's evaluators.
+ * Binary models are always evaluated by the in-tree intensity normalized evaluator, and those
+ * converted for another evaluator are rejected.
+ */
+int main(int argc, char **argv) {
+    const bool batchMode = argc > 1 && std::string(argv[1]) == "--batch";
+    const int first = batchMode ? 2 : 1;
+    const std::string imageFile = argv[first];
+    const std::string strongHypothesisFile = argv[first + 1];
+    const std::vector<std::string> options(argv + first + 2, argv + argc);
+    const std::string traceFile = optionValue(options, "--trace");
+    const bool haarcommon = std::find(options.begin(), options.end(), "--haarcommon") != options.end();
+    float threshold = 0;
+    std::stringstream(optionValue(options, "--threshold")) >> threshold;
+
+    //Messages go to the standard error, which batch mode leaves free for the results
+    if ( BinaryModel::isBinary(strongHypothesisFile) )
+    {
+        //Mapped and evaluated in place: nothing to parse before the first frame
+        MappedStrongHypothesis<MyHaarIntegralClassifier::evaluator_type> strongHypothesis;
+        if ( !strongHypothesis.map(strongHypothesisFile) )
+        {
+            std::cerr << strongHypothesisFile << " is not a binary strong classifier converted as band or pavani (see convertmodel)." << std::endl;
+            return 11;
+        }
+        if ( !traceFile.empty() )
+        {
+            return 13;
+        }
+        strongHypothesis.setThreshold(threshold);
+
+        std::cerr << "Mapped binary strong classifier." << std::endl;
+        return detect<MyHaarIntegralClassifier>(imageFile, batchMode, strongHypothesis, options);
+    }
+
+    if ( haarcommon )
+    {
+        return detectText<MyHaarClassifier>(imageFile, batchMode, strongHypothesisFile, threshold, traceFile, options);
+    }
+    return detectText<MyHaarIntegralClassifier>(imageFile, batchMode, strongHypothesisFile, threshold, traceFile, options);
+}
@@ -0,0 +1,335 @@
+#include "grouping.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+
+
+GridIndex::GridIndex(const cv::Rect & bounds_, const int cellSize_) : bounds(bounds_),
+                                                                      cellSize(std::max(cellSize_, 1)),
+                                                                      columns(std::max(bounds_.width, 1) / std::max(cellSize_, 1) + 1),
+                                                                      rows(std::max(bounds_.height, 1) / std::max(cellSize_, 1) + 1),
+                                                                      buckets(columns * rows),
+                                                                      stamps(),
+                                                                      stamp(0) {}
+
+
+
+void GridIndex::insert(const std::size_t id, const cv::Rect & rect)
+{
+    int firstColumn, firstRow, lastColumn, lastRow;
+    cells(rect, firstColumn, firstRow, lastColumn, lastRow);
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+            buckets[row * columns + column].push_back(id);
+        }
+    }
+
+    if ( id >= stamps.size() )
+    {
+        stamps.resize(id + 1, 0);
+    }
+}
+
+
+
+void GridIndex::query(const cv::Rect & rect, std::vector<std::size_t> & ids) const
+{
+    ids.clear();
+    if ( ++stamp == 0 )
+    {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        stamp = 1;
+    }
+
+    int firstColumn, firstRow, lastColumn, lastRow;
+    cells(rect, firstColumn, firstRow, lastColumn, lastRow);
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+            const std::vector<std::size_t> & bucket = buckets[row * columns + column];
+            for (std::vector<std::size_t>::const_iterator id = bucket.begin(); id != bucket.end(); ++id)
+            {
+                if ( stamps[*id] != stamp )
+                {
+                    stamps[*id] = stamp;
+                    ids.push_back(*id);
+                }
+            }
+        }
+    }
+
+    //Ids come bucket by bucket
+    std::sort(ids.begin(), ids.end());
+}
+
+
+
+void GridIndex::cells(const cv::Rect & rect, int & firstColumn, int & firstRow, int & lastColumn, int & lastRow) const
+{
+    //Clamping keeps the cells of overlapping rectangles overlapping, even outside the bounds
+    firstColumn = std::min(std::max((rect.x - bounds.x) / cellSize, 0), columns - 1);
+    firstRow    = std::min(std::max((rect.y - bounds.y) / cellSize, 0), rows - 1);
+    lastColumn  = std::min(std::max((rect.x + rect.width  - bounds.x) / cellSize, 0), columns - 1);
+    lastRow     = std::min(std::max((rect.y + rect.height - bounds.y) / cellSize, 0), rows - 1);
+}
+
+
+
+namespace
+{
+
+/**
+ * A grid index of the detections, with cells of a fraction of their median width.
+ */
+GridIndex indexFor(const std::vector<cv::Rect> & rects, const double fraction = 1.0)
+{
+    cv::Rect bounds = rects.front();
+    std::vector<int> widths;
+    widths.reserve(rects.size());
+    for (std::vector<cv::Rect>::const_iterator rect = rects.begin(); rect != rects.end(); ++rect)
+    {
+        bounds |= *rect;
+        widths.push_back(rect->width);
+    }
+    std::nth_element(widths.begin(), widths.begin() + widths.size() / 2, widths.end());
+
+    return GridIndex(bounds, (int)(fraction * widths[widths.size() / 2]));
+}
+
+
+
+cv::Rect expand(const cv::Rect & rect, const int dx, const int dy)
+{
+    return cv::Rect(rect.x - dx, rect.y - dy, rect.width + 2 * dx, rect.height + 2 * dy);
+}
+
+
+
+/**
+ * The similarity of cv::groupRectangles.
+ */
+bool similar(const cv::Rect & r1, const cv::Rect & r2, const double eps)
+{
+    const double delta = eps * (std::min(r1.width, r2.width) + std::min(r1.height, r2.height)) * 0.5;
+    return std::abs(r1.x - r2.x) <= delta
+        && std::abs(r1.y - r2.y) <= delta
+        && std::abs(r1.x + r1.width  - r2.x - r2.width)  <= delta
+        && std::abs(r1.y + r1.height - r2.y - r2.height) <= delta;
+}
+
+
+
+std::size_t root(std::vector<std::size_t> & parents, std::size_t i)
+{
+    while ( parents[i] != i )
+    {
+        parents[i] = parents[ parents[i] ];
+        i = parents[i];
+    }
+    return i;
+}
+
+}
+
+
+
+void groupDetections(const std::vector<Detection> & detections,
+                     const int minimumNeighbors,
+                     const double eps,
+                     std::vector<Detection> & groups)
+{
+    groups.clear();
+    if ( minimumNeighbors <= 0 || detections.empty() )
+    {
+        groups = detections;
+        return;
+    }
+
+    std::vector<cv::Rect> rects;
+    rects.reserve(detections.size());
+    for (std::vector<Detection>::const_iterator detection = detections.begin(); detection != detections.end(); ++detection)
+    {
+        rects.push_back(detection->rect);
+    }
+
+    //Similar detections are joined in the same set. Their top left corners are at most delta
+    //apart, so only corners are indexed, in cells about delta wide.
+    GridIndex index = indexFor(rects, eps);
+    std::vector<std::size_t> parents(rects.size());
+    std::vector<std::size_t> near;
+    for (std::size_t i = 0; i < rects.size(); ++i)
+    {
+        parents[i] = i;
+        const int delta = (int)std::ceil( eps * (rects[i].width + rects[i].height) * 0.5 );
+        const cv::Rect corner(rects[i].x, rects[i].y, 0, 0);
+        index.query(expand(corner, delta, delta), near);
+        for (std::vector<std::size_t>::const_iterator j = near.begin(); j != near.end(); ++j)
+        {
+            if ( similar(rects[i], rects[*j], eps) )
+            {
+                parents[ root(parents, i) ] = root(parents, *j);
+            }
+        }
+        index.insert(i, corner);
+    }
+
+    //Sum up each set, numbering them in the order of their first detection
+    std::vector<std::size_t> label(rects.size(), rects.size());
+    std::vector<Detection> sums;
+    std::vector<int> counts;
+    std::vector<double> x, y, width, height;
+    for (std::size_t i = 0; i < rects.size(); ++i)
+    {
+        std::size_t & k = label[ root(parents, i) ];
+        if ( k == rects.size() )
+        {
+            k = sums.size();
+            sums.push_back( Detection(cv::Rect(), detections[i].score) );
+            sums.back().neighbors = 0;
+            counts.push_back(0);
+            x.push_back(0); y.push_back(0); width.push_back(0); height.push_back(0);
+        }
+        sums[k].score = std::max(sums[k].score, detections[i].score);
+        sums[k].neighbors += detections[i].neighbors;
+        counts[k] += 1;
+        x[k] += rects[i].x;
+        y[k] += rects[i].y;
+        width[k] += rects[i].width;
+        height[k] += rects[i].height;
+    }
+
+    std::vector<cv::Rect> averages;
+    for (std::size_t k = 0; k < sums.size(); ++k)
+    {
+        const double s = 1.0 / counts[k];
+        sums[k].rect = cv::Rect( cvRound(x[k] * s), cvRound(y[k] * s), cvRound(width[k] * s), cvRound(height[k] * s) );
+        averages.push_back(sums[k].rect);
+    }
+
+    //Drops groups inside a larger one that has more detections
+    std::vector<char> dropped(sums.size(), 0);
+    GridIndex groupIndex = indexFor(averages);
+    for (std::size_t k = 0; k < averages.size(); ++k)
+    {
+        groupIndex.insert(k, averages[k]);
+    }
+    for (std::size_t j = 0; j < sums.size(); ++j)
+    {
+        const int n2 = sums[j].neighbors;
+        if ( n2 <= minimumNeighbors )
+        {
+            continue;
+        }
+
+        const cv::Rect & r2 = averages[j];
+        const int dx = cvRound(r2.width * eps);
+        const int dy = cvRound(r2.height * eps);
+        groupIndex.query(expand(r2, dx, dy), near);
+        for (std::vector<std::size_t>::const_iterator i = near.begin(); i != near.end(); ++i)
+        {
+            const cv::Rect & r1 = averages[*i];
+            const int n1 = sums[*i].neighbors;
+            if ( *i != j
+                 && r1.x >= r2.x - dx
+                 && r1.y >= r2.y - dy
+                 && r1.x + r1.width  <= r2.x + r2.width  + dx
+                 && r1.y + r1.height <= r2.y + r2.height + dy
+                 && (n2 > std::max(3, n1) || n1 < 3) )
+            {
+                dropped[*i] = 1;
+            }
+        }
+    }
+
+    for (std::size_t k = 0; k < sums.size(); ++k)
+    {
+        if ( sums[k].neighbors > minimumNeighbors && !dropped[k] )
+        {
+            groups.push_back(sums[k]);
+        }
+    }
+}
+
+
+
+void suppressNonMaxima(const std::vector<Detection> & detections,
+                       const double maximumOverlap,
+                       std::vector<Detection> & kept)
+{
+    kept.clear();
+    if ( detections.empty() )
+    {
+        return;
+    }
+
+    //By decreasing score, ties in the order given
+    std::vector< std::pair<float, std::size_t> > order;
+    order.reserve(detections.size());
+    for (std::size_t i = 0; i < detections.size(); ++i)
+    {
+        order.push_back( std::make_pair(-detections[i].score, i) );
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<cv::Rect> rects;
+    rects.reserve(detections.size());
+    for (std::vector<Detection>::const_iterator detection = detections.begin(); detection != detections.end(); ++detection)
+    {
+        rects.push_back(detection->rect);
+    }
+
+    GridIndex index = indexFor(rects);
+    std::vector<std::size_t> near;
+    for (std::vector< std::pair<float, std::size_t> >::const_iterator it = order.begin(); it != order.end(); ++it)
+    {
+        const Detection & detection = detections[it->second];
+        const double area = detection.rect.area();
+
+        //Ids of the index are positions in kept, so the first overlapping one has the highest score
+        std::size_t suppressor = kept.size();
+        index.query(detection.rect, near);
+        for (std::vector<std::size_t>::const_iterator k = near.begin(); k != near.end(); ++k)
+        {
+            const double intersection = (detection.rect & kept[*k].rect).area();
+            if ( intersection > maximumOverlap * (area + kept[*k].rect.area() - intersection) )
+            {
+                suppressor = *k;
+                break;
+            }
+        }
+
+        if ( suppressor < kept.size() )
+        {
+            kept[suppressor].neighbors += detection.neighbors;
+        }
+        else
+        {
+            index.insert(kept.size(), detection.rect);
+            kept.push_back(detection);
+        }
+    }
+}
+
+
+
+void DetectionGrouping::apply(std::vector<Detection> & detections) const
+{
+    std::vector<Detection> grouped;
+    switch (mode)
+    {
+    case group:
+        groupDetections(detections, (int)parameter, eps, grouped);
+        break;
+    case nms:
+        suppressNonMaxima(detections, parameter, grouped);
+        break;
+    default:
+        return;
+    }
+    detections.swap(grouped);
+}
@@ -0,0 +1,115 @@
+#ifndef GROUPING_H
+#define GROUPING_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+
+
+/**
+ * A window a classifier accepted, or a box that stands for several of them.
+ */
+struct Detection
+{
+    cv::Rect rect;
+    float score;        //the classification value, or the highest among the windows merged
+    int neighbors;      //how many windows were merged into this one
+
+    Detection() : rect(),
+                  score(0),
+                  neighbors(1) {}
+
+    Detection(const cv::Rect & rect_,
+              const float score_) : rect(rect_),
+                                    score(score_),
+                                    neighbors(1) {}
+};
+
+
+
+/**
+ * Buckets rectangles by the cells of a regular grid they overlap, so that the rectangles near
+ * another one are found without looking at all of them. Every rectangle is in each cell it
+ * overlaps; with cells about the size of the rectangles, that is a few cells each.
+ */
+class GridIndex
+{
+public:
+    /**
+     * @param bounds the region every rectangle inserted or queried lies in. Parts outside it
+     *        are clipped to its border cells.
+     * @param cellSize the width and height of the cells.
+     */
+    GridIndex(const cv::Rect & bounds, const int cellSize);
+
+    void insert(const std::size_t id, const cv::Rect & rect);
+
+    /**
+     * Sets ids to those of the rectangles in the cells rect overlaps, each once, in the order
+     * they were inserted. Not thread safe, even though it does not change the rectangles indexed.
+     */
+    void query(const cv::Rect & rect, std::vector<std::size_t> & ids) const;
+
+private:
+    void cells(const cv::Rect & rect, int & firstColumn, int & firstRow, int & lastColumn, int & lastRow) const;
+
+    const cv::Rect bounds;
+    const int cellSize;
+    const int columns;
+    const int rows;
+    std::vector< std::vector<std::size_t> > buckets;
+
+    /** The last query each id was found by, to report it once */
+    mutable std::vector<unsigned int> stamps;
+    mutable unsigned int stamp;
+};
+
+
+
+/**
+ * Groups similar detections as cv::groupRectangles does (Viola and Jones 2004, section 5.6):
+ * two detections are similar if their corners are within eps times their average size; the
+ * detections connected by similarity form a group, which becomes their average box if it has
+ * more than minimumNeighbors of them. Groups inside a larger one with more detections are
+ * dropped. Each group keeps the highest score among its detections and their number.
+ */
+void groupDetections(const std::vector<Detection> & detections,
+                     const int minimumNeighbors,
+                     const double eps,
+                     std::vector<Detection> & groups);
+
+/**
+ * Greedy non-maximum suppression: takes detections by decreasing score and keeps each one that
+ * overlaps no detection kept before by more than maximumOverlap of their union. Each detection
+ * kept counts the ones it suppressed among its neighbors.
+ */
+void suppressNonMaxima(const std::vector<Detection> & detections,
+                       const double maximumOverlap,
+                       std::vector<Detection> & kept);
+
+
+
+/**
+ * Which of the stages above, if any, merges the detections of a detector, and its parameter.
+ */
+struct DetectionGrouping
+{
+    enum Mode { none, group, nms };
+
+    Mode mode;
+    double parameter;   //minimumNeighbors for group, maximumOverlap for nms
+    double eps;         //how similar detections are grouped; 0.2 is cv::groupRectangles' default
+
+    DetectionGrouping(const Mode mode_ = none,
+                      const double parameter_ = 0,
+                      const double eps_ = 0.2) : mode(mode_),
+                                                 parameter(parameter_),
+                                                 eps(eps_) {}
+
+    void apply(std::vector<Detection> & detections) const;
+};
+
+
+
+#endif // GROUPING_H
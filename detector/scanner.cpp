@@ -0,0 +1,79 @@
+#include "scanner.h"
+
+#include <algorithm>
+
+
+
+ScanPlan::ScanPlan(const int initialSize_,
+                   const double initialScale_,
+                   const double scalingFactor_,
+                   const double delta_,
+                   const std::size_t tileRows_) : initialSize(initialSize_),
+                                                  initialScale(initialScale_),
+                                                  scalingFactor(scalingFactor_),
+                                                  delta(delta_),
+                                                  tileRows(tileRows_ ? tileRows_ : 1) {}
+
+
+
+void ScanPlan::plan(const cv::Size & imageSize,
+                    std::vector<ScanLevel> & levels,
+                    std::vector<ScanTile> & tiles) const
+{
+    levels.clear();
+    tiles.clear();
+
+    //The integral images are 1 unit bigger than the image
+    for(double scale = initialScale; scale * initialSize < imageSize.width + 1
+                                  && scale * initialSize < imageSize.height + 1; scale *= scalingFactor)
+    {
+        ScanLevel level;
+        level.scale = scale;
+        level.size = (int)(initialSize * scale);
+
+        const double shift = delta * scale;
+        for (int x = 0; x <= imageSize.width - level.size; x += shift)
+        {
+            level.xs.push_back(x);
+        }
+        for (int y = 0; y <= imageSize.height - level.size; y += shift)
+        {
+            level.ys.push_back(y);
+        }
+
+        for (std::size_t row = 0; row < level.ys.size(); row += tileRows)
+        {
+            tiles.push_back( ScanTile(levels.size(), row, std::min(row + tileRows, level.ys.size())) );
+        }
+        levels.push_back(level);
+    }
+}
+
+
+
+namespace
+{
+
+bool scanOrder(const Detection & first, const Detection & second)
+{
+    const cv::Rect & a = first.rect;
+    const cv::Rect & b = second.rect;
+    if ( a.width != b.width )
+    {
+        return a.width < b.width;
+    }
+    if ( a.y != b.y )
+    {
+        return a.y < b.y;
+    }
+    return a.x < b.x;
+}
+
+}
+
+
+
+void ScanPlan::sort(std::vector<Detection> & detections)
+{
+    std::sort(detections.begin(), detections.end(), scanOrder);
+}
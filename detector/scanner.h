@@ -0,0 +1,323 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <vector>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "stronghypothesis.h"
+#include "compiledstronghypothesis.h"
+#include "grouping.h"
+
+
+
+/**
+ * The windows scanned at one scale. Positions advance by the shift truncated to whole pixels,
+ * one step after the other, as the scanners of the test tools always did.
+ */
+struct ScanLevel
+{
+    double scale;
+    int size;               //width and height of the windows on the image
+    std::vector<int> xs;
+    std::vector<int> ys;
+
+    ScanLevel() : scale(0),
+                  size(0),
+                  xs(),
+                  ys() {}
+};
+
+
+
+/**
+ * A few rows of windows of a scale: the unit of work of the scanning threads.
+ */
+struct ScanTile
+{
+    std::size_t level;
+    std::size_t firstRow;
+    std::size_t lastRow;    //one past the last row
+
+    ScanTile(const std::size_t level_,
+             const std::size_t firstRow_,
+             const std::size_t lastRow_) : level(level_),
+                                           firstRow(firstRow_),
+                                           lastRow(lastRow_) {}
+};
+
+
+
+/**
+ * Lays out the sliding windows: the scales, the positions at each of them and the tiles they
+ * are split into. Does not depend on the classifier, so it is compiled into the scanner library.
+ */
+class ScanPlan
+{
+public:
+    /**
+     * @param initialSize the width and height of the windows the classifier was trained on.
+     * @param initialScale the scale of the smallest windows scanned.
+     * @param scalingFactor how much larger each scale is than the previous one.
+     * @param delta the shift between windows, in pixels of the initial size.
+     * @param tileRows how many rows of windows make a tile.
+     */
+    ScanPlan(const int initialSize = 20,
+             const double initialScale = 1.5,
+             const double scalingFactor = 1.25,
+             const double delta = 1.5,
+             const std::size_t tileRows = 4);
+
+    void plan(const cv::Size & imageSize,
+              std::vector<ScanLevel> & levels,
+              std::vector<ScanTile> & tiles) const;
+
+    /**
+     * Sorts detections by size, then top to bottom and left to right, so that they do not
+     * depend on which thread found them.
+     */
+    static void sort(std::vector<Detection> & detections);
+
+private:
+    const int initialSize;
+    const double initialScale;
+    const double scalingFactor;
+    const double delta;
+    const std::size_t tileRows;
+};
+
+
+
+/**
+ * Multi-threaded sliding window detector. Each frame's integral images are computed once and
+ * shared by every thread: a window's integrals are a region of them, since rectangle sums are
+ * differences. The windows of every scale are split into tiles of rows, all of which go to a
+ * single tbb::parallel_for, so that idle threads steal tiles of any scale. Each thread appends
+ * its detections to its own buffer, and the buffers are only joined after scanning.
+ *
+ * ClassifierType is anything that classifies an Example at a scale and gives its classification
+ * value with it: a StrongHypothesis (with or without a rejection trace), a Cascade or a
+ * MappedStrongHypothesis. A StrongHypothesis is compiled once, by the constructor (see
+ * CompiledStrongHypothesis), and laid out once per scale of each frame, before the threads
+ * start. The classifier must outlive the scanner, and changes to it are not seen.
+ */
+template<typename WeakClassifierType, typename ClassifierType = StrongHypothesis<WeakClassifierType> >
+class Scanner
+{
+public:
+    Scanner(const ClassifierType & classifier_,
+            const ScanPlan & scanPlan_ = ScanPlan()) : classifier(classifier_),
+                                                       compiled( compile(classifier_, StrongHypothesisScan()) ),
+                                                       scanPlan(scanPlan_) {}
+
+
+
+    /**
+     * @return the windows of image the classifier accepts.
+     */
+    std::vector<cv::Rect> detect(const cv::Mat & image) const
+    {
+        std::vector<Detection> detections;
+        detect(image, detections);
+
+        std::vector<cv::Rect> rects;
+        rects.reserve(detections.size());
+        for (std::vector<Detection>::const_iterator detection = detections.begin(); detection != detections.end(); ++detection)
+        {
+            rects.push_back(detection->rect);
+        }
+        return rects;
+    }
+
+
+
+    /**
+     * Sets detections to the windows of image the classifier accepts and their classification
+     * values, to be grouped by groupDetections() or suppressNonMaxima().
+     */
+    void detect(const cv::Mat & image, std::vector<Detection> & detections) const
+    {
+        cv::Mat integralSum;
+        cv::Mat integralSquare;
+        WeakClassifierType::integrals_type::compute(image, integralSum, integralSquare, WeakClassifierType::needs_integral_square);
+
+        std::vector<ScanLevel> levels;
+        std::vector<ScanTile> tiles;
+        scanPlan.plan(cv::Size(image.cols, image.rows), levels, tiles);
+
+        Buffers buffers;
+        scan(levels, tiles, integralSum, integralSquare, buffers, StrongHypothesisScan());
+
+        detections.clear();
+        for (typename Buffers::const_iterator buffer = buffers.begin(); buffer != buffers.end(); ++buffer)
+        {
+            detections.insert(detections.end(), buffer->begin(), buffer->end());
+        }
+        ScanPlan::sort(detections);
+    }
+
+private:
+    typedef tbb::enumerable_thread_specific< std::vector<Detection> > Buffers;
+
+    /** Whether the classifier is a StrongHypothesis, which is scanned compiled */
+    typedef boost::is_same< ClassifierType, StrongHypothesis<WeakClassifierType> > StrongHypothesisScan;
+
+
+
+    static CompiledStrongHypothesis<WeakClassifierType> * compile(const ClassifierType & classifier, boost::true_type)
+    {
+        return new CompiledStrongHypothesis<WeakClassifierType>(classifier);
+    }
+
+    static CompiledStrongHypothesis<WeakClassifierType> * compile(const ClassifierType &, boost::false_type)
+    {
+        return 0;
+    }
+
+
+
+    void scan(const std::vector<ScanLevel> & levels,
+              const std::vector<ScanTile> & tiles,
+              const cv::Mat & integralSum,
+              const cv::Mat & integralSquare,
+              Buffers & buffers,
+              boost::false_type) const
+    {
+        tbb::parallel_for( tbb::blocked_range< std::size_t >(0, tiles.size(), 1),
+                           ScanTiles<Vote>(Vote(classifier, levels), levels, tiles, integralSum, integralSquare, buffers) );
+    }
+
+    void scan(const std::vector<ScanLevel> & levels,
+              const std::vector<ScanTile> & tiles,
+              const cv::Mat & integralSum,
+              const cv::Mat & integralSquare,
+              Buffers & buffers,
+              boost::true_type) const
+    {
+        std::vector<typename CompiledStrongHypothesis<WeakClassifierType>::Layout> layouts(levels.size());
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            compiled->layout(levels[l].scale, integralSum.step1(), layouts[l]);
+        }
+
+        tbb::parallel_for( tbb::blocked_range< std::size_t >(0, tiles.size(), 1),
+                           ScanTiles<CompiledVote>(CompiledVote(*compiled, layouts), levels, tiles, integralSum, integralSquare, buffers) );
+    }
+
+
+
+    /**
+     * Accepts a window of a level, and gives its classification value, through the classifier,
+     * which evaluates the window once for both.
+     */
+    struct Vote
+    {
+        const ClassifierType & classifier;
+        const std::vector<ScanLevel> & levels;
+
+        Vote(const ClassifierType & classifier_,
+             const std::vector<ScanLevel> & levels_) : classifier(classifier_),
+                                                       levels(levels_) {}
+
+        bool operator()(const Example & example, const std::size_t level, float & value) const
+        {
+            return classifier.classify(example, levels[level].scale, value) == yes;
+        }
+    };
+
+    /**
+     * Same as Vote, through a compiled strong hypothesis and the layout of the level.
+     */
+    struct CompiledVote
+    {
+        const CompiledStrongHypothesis<WeakClassifierType> & compiled;
+        const std::vector<typename CompiledStrongHypothesis<WeakClassifierType>::Layout> & layouts;
+
+        CompiledVote(const CompiledStrongHypothesis<WeakClassifierType> & compiled_,
+                     const std::vector<typename CompiledStrongHypothesis<WeakClassifierType>::Layout> & layouts_) : compiled(compiled_),
+                                                                                                                    layouts(layouts_) {}
+
+        bool operator()(const Example & example, const std::size_t level, float & value) const
+        {
+            unsigned int evaluated;
+            value = compiled.classificationValue(example, layouts[level], evaluated);
+            return value >= compiled.getThreshold();
+        }
+    };
+
+
+
+    /**
+     * Classifies the windows of a range of tiles.
+     */
+    template<typename VoteType>
+    struct ScanTiles
+    {
+        const VoteType vote;
+        const std::vector<ScanLevel> & levels;
+        const std::vector<ScanTile> & tiles;
+        const cv::Mat & integralSum;
+        const cv::Mat & integralSquare;
+        Buffers & buffers;
+
+        ScanTiles(const VoteType & vote_,
+                  const std::vector<ScanLevel> & levels_,
+                  const std::vector<ScanTile> & tiles_,
+                  const cv::Mat & integralSum_,
+                  const cv::Mat & integralSquare_,
+                  Buffers & buffers_) : vote(vote_),
+                                        levels(levels_),
+                                        tiles(tiles_),
+                                        integralSum(integralSum_),
+                                        integralSquare(integralSquare_),
+                                        buffers(buffers_) {}
+
+        void operator()(const tbb::blocked_range< std::size_t > & range) const
+        {
+            std::vector<Detection> & detections = buffers.local();
+
+            for (std::size_t t = range.begin(); t < range.end(); ++t)
+            {
+                const ScanTile & tile = tiles[t];
+                const ScanLevel & level = levels[tile.level];
+
+                //The integral image ROI is 1 unit bigger than the original image ROI.
+                cv::Rect integralRoi(0, 0, level.size + 1, level.size + 1);
+                for (std::size_t row = tile.firstRow; row < tile.lastRow; ++row)
+                {
+                    integralRoi.y = level.ys[row];
+                    for (std::vector<int>::const_iterator x = level.xs.begin(); x != level.xs.end(); ++x)
+                    {
+                        integralRoi.x = *x;
+                        const Example example(integralSum(integralRoi),
+                                              integralSquare.empty() ? cv::Mat() : integralSquare(integralRoi));
+
+                        float value;
+                        if ( vote(example, tile.level, value) )
+                        {
+                            detections.push_back( Detection(cv::Rect(integralRoi.x, integralRoi.y, level.size, level.size), value) );
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+
+
+    const ClassifierType & classifier;
+
+    /** The classifier compiled, if it is a StrongHypothesis. Shared by copies of the scanner. */
+    boost::shared_ptr< const CompiledStrongHypothesis<WeakClassifierType> > compiled;
+
+    const ScanPlan scanPlan;
+};
+
+
+
+#endif // SCANNER_H
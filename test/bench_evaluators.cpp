@@ -0,0 +1,263 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "weakhypothesis.h"
+#include "stronghypothesis.h"
+#include "compiledstronghypothesis.h"
+#include "scanner.h"
+
+
+
+/**
+ * The integral images of an image, as a classifier reads them.
+ */
+template<typename WeakHypothesisType>
+struct Integrals
+{
+    cv::Mat sum;
+    cv::Mat square;
+
+    Integrals(const cv::Mat & image)
+    {
+        WeakHypothesisType::integrals_type::compute(image, sum, square, WeakHypothesisType::needs_integral_square);
+    }
+
+    Example window(const cv::Rect & roi) const
+    {
+        return Example(sum(roi), square.empty() ? cv::Mat() : square(roi));
+    }
+};
+
+
+
+/**
+ * Sum of the votes of every weak hypothesis, each computing the normalization of the window on
+ * its own, as StrongHypothesis does for weak hypothesis that do not share it.
+ */
+template<typename WeakHypothesisType>
+float sumVotes(const StrongHypothesis<WeakHypothesisType> & strongHypothesis, const Example & example, const float scale)
+{
+    float result = .0f;
+    for (std::size_t k = 0; k < strongHypothesis.size(); ++k)
+    {
+        result += strongHypothesis.alpha(k) * strongHypothesis.weakHypothesis(k).classify(example, scale);
+    }
+    return result;
+}
+
+
+
+template<typename WeakHypothesisType>
+bool readModel(const std::string & path, StrongHypothesis<WeakHypothesisType> & strongHypothesis)
+{
+    std::ifstream in(path.c_str());
+    return in.is_open() && strongHypothesis.read(in);
+}
+
+
+
+/**
+ * Evaluates the windows a Scanner would of every image, up to a number of them, with a model
+ * read both as HaarcommonType, over haarcommon's evaluators, and as IntegralType, over the
+ * in-tree ones, and compiled as the Scanner does. Counts the feature values and classification
+ * values that are not the same bits, and times the classification values each way.
+ */
+template<typename HaarcommonType, typename IntegralType>
+int compare(const std::string & modelFile, const std::vector<std::string> & imageFiles, const std::size_t maximumWindows)
+{
+    StrongHypothesis<HaarcommonType> haarcommon;
+    StrongHypothesis<IntegralType> integral;
+    if ( !readModel(modelFile, haarcommon) || !readModel(modelFile, integral) )
+    {
+        return 11;
+    }
+    const CompiledStrongHypothesis<IntegralType> compiled(integral);
+
+    std::size_t windows = 0;
+    std::size_t differentFeatureValues = 0;
+    std::size_t differentPerWeak = 0;
+    std::size_t differentShared = 0;
+    std::size_t differentCompiled = 0;
+    double haarcommonSeconds = 0;
+    double perWeakSeconds = 0;
+    double sharedSeconds = 0;
+    double compiledSeconds = 0;
+
+    const ScanPlan scanPlan;
+    for (std::vector<std::string>::const_iterator imageFile = imageFiles.begin(); imageFile != imageFiles.end() && windows < maximumWindows; ++imageFile)
+    {
+        const cv::Mat image = cv::imread(*imageFile, cv::DataType<unsigned char>::type);
+        if ( !image.data )
+        {
+            std::cout << "Could not read " << *imageFile << '.' << std::endl;
+            return 13;
+        }
+        const Integrals<HaarcommonType> haarcommonIntegrals(image);
+        const Integrals<IntegralType> integralIntegrals(image);
+
+        std::vector<ScanLevel> levels;
+        std::vector<ScanTile> tiles;
+        scanPlan.plan(cv::Size(image.cols, image.rows), levels, tiles);
+
+        std::vector<typename CompiledStrongHypothesis<IntegralType>::Layout> layouts(levels.size());
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            compiled.layout(levels[l].scale, integralIntegrals.sum.step1(), layouts[l]);
+        }
+
+        //Windows are gathered first, so that each way of evaluating them is timed on its own
+        std::vector<cv::Rect> rois;
+        std::vector<float> scales;
+        std::vector<std::size_t> windowLevels;
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            const ScanLevel & level = levels[l];
+            for (std::vector<int>::const_iterator y = level.ys.begin(); y != level.ys.end(); ++y)
+            {
+                for (std::vector<int>::const_iterator x = level.xs.begin(); x != level.xs.end() && windows + rois.size() < maximumWindows; ++x)
+                {
+                    //The integral image ROI is 1 unit bigger than the original image ROI.
+                    rois.push_back( cv::Rect(*x, *y, level.size + 1, level.size + 1) );
+                    scales.push_back( (float)level.scale );
+                    windowLevels.push_back(l);
+                }
+            }
+        }
+        windows += rois.size();
+
+        for (std::size_t w = 0; w < rois.size(); ++w)
+        {
+            const Example haarcommonExample = haarcommonIntegrals.window(rois[w]);
+            const Example integralExample = integralIntegrals.window(rois[w]);
+            for (std::size_t k = 0; k < integral.size(); ++k)
+            {
+                differentFeatureValues += haarcommon.weakHypothesis(k).featureValue(haarcommonExample, scales[w])
+                                          != integral.weakHypothesis(k).featureValue(integralExample, scales[w]);
+            }
+        }
+
+        std::vector<float> haarcommonValues(rois.size()), perWeakValues(rois.size()), sharedValues(rois.size()), compiledValues(rois.size());
+        tbb::tick_count start = tbb::tick_count::now();
+        for (std::size_t w = 0; w < rois.size(); ++w)
+        {
+            haarcommonValues[w] = haarcommon.classificationValue(haarcommonIntegrals.window(rois[w]), scales[w]);
+        }
+        haarcommonSeconds += (tbb::tick_count::now() - start).seconds();
+
+        start = tbb::tick_count::now();
+        for (std::size_t w = 0; w < rois.size(); ++w)
+        {
+            perWeakValues[w] = sumVotes(integral, integralIntegrals.window(rois[w]), scales[w]);
+        }
+        perWeakSeconds += (tbb::tick_count::now() - start).seconds();
+
+        start = tbb::tick_count::now();
+        for (std::size_t w = 0; w < rois.size(); ++w)
+        {
+            sharedValues[w] = integral.classificationValue(integralIntegrals.window(rois[w]), scales[w]);
+        }
+        sharedSeconds += (tbb::tick_count::now() - start).seconds();
+
+        start = tbb::tick_count::now();
+        for (std::size_t w = 0; w < rois.size(); ++w)
+        {
+            unsigned int evaluated;
+            compiledValues[w] = compiled.classificationValue(integralIntegrals.window(rois[w]), layouts[windowLevels[w]], evaluated);
+        }
+        compiledSeconds += (tbb::tick_count::now() - start).seconds();
+
+        for (std::size_t w = 0; w < rois.size(); ++w)
+        {
+            differentPerWeak += perWeakValues[w] != haarcommonValues[w];
+            differentShared += sharedValues[w] != haarcommonValues[w];
+            differentCompiled += compiledValues[w] != haarcommonValues[w];
+        }
+    }
+
+    if ( windows == 0 )
+    {
+        std::cout << "No window was scanned: every image is smaller than the detector." << std::endl;
+        return 13;
+    }
+
+    std::cout << windows << " windows, " << integral.size() << " weak hypothesis\n"
+              << "Feature values that differ from haarcommon's: " << differentFeatureValues << '\n'
+              << "evaluation                      differ  us/window\n"
+              << std::fixed << std::setprecision(3)
+              << "haarcommon (reference)          " << std::setw(6) << '-' << std::setw(11) << haarcommonSeconds * 1e6 / windows << '\n'
+              << "in-tree, normalized per weak    " << std::setw(6) << differentPerWeak << std::setw(11) << perWeakSeconds * 1e6 / windows << '\n'
+              << "in-tree, normalization shared   " << std::setw(6) << differentShared << std::setw(11) << sharedSeconds * 1e6 / windows << '\n'
+              << "in-tree, compiled               " << std::setw(6) << differentCompiled << std::setw(11) << compiledSeconds * 1e6 / windows << std::endl;
+
+    return differentFeatureValues == 0 && differentPerWeak == 0 && differentShared == 0 && differentCompiled == 0 ? 0 : 2;
+}
+
+
+
+/**
+ * Checks that the classifiers over the in-tree evaluators (ViolaJonesIntegralClassifier and the
+ * like) evaluate a trained model exactly as the ones over haarcommon's evaluators do, bit for bit,
+ * on the windows the detector scans, both through StrongHypothesis::classificationValue() and
+ * compiled (see CompiledStrongHypothesis), and times each. Returns 2 if any value differs.
+ * test_evaluators checks the same on drawn wavelets; this checks a trained model on real images.
+ *
+ * Arguments:
+ *     vj | pavani | band
+ *     strongHypothesisFile
+ *     imageListFile (a path per line)
+ *     [windows (default 200000)]
+ */
+int main(int argc, char **argv) {
+    if ( argc < 4 )
+    {
+        std::cout << "USAGE: " << argv[0] << " vj|pavani|band STRONG_HYPOTHESIS_FILE IMAGE_LIST_FILE [WINDOWS]" << std::endl;
+        return 1;
+    }
+    const std::string kind = argv[1];
+    const std::string modelFile = argv[2];
+    const std::string imageListFile = argv[3];
+    const std::size_t maximumWindows = argc > 4 ? std::atoi(argv[4]) : 200000;
+
+    std::vector<std::string> imageFiles;
+    {
+        std::ifstream in(imageListFile.c_str());
+        if ( !in.is_open() )
+        {
+            return 7;
+        }
+        std::string line;
+        while ( std::getline(in, line) )
+        {
+            if ( !line.empty() )
+            {
+                imageFiles.push_back(line);
+            }
+        }
+    }
+
+    if ( kind == "vj" )
+    {
+        return compare<ViolaJonesClassifier, ViolaJonesIntegralClassifier>(modelFile, imageFiles, maximumWindows);
+    }
+    if ( kind == "pavani" )
+    {
+        return compare<PavaniHaarClassifier, PavaniHaarIntegralClassifier>(modelFile, imageFiles, maximumWindows);
+    }
+    if ( kind == "band" )
+    {
+        return compare<MyHaarClassifier, MyHaarIntegralClassifier>(modelFile, imageFiles, maximumWindows);
+    }
+
+    std::cout << "Unknown classifier " << kind << '.' << std::endl;
+    return 1;
+}
@@ -0,0 +1,269 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "integralimage.h"
+#include "stronghypothesis.h"
+#include "weakhypothesis.h"
+#include "binarymodel.h"
+
+
+
+/**
+ * Writes a binary model as text, in the format StrongHypothesis::write() or the wavelet pool
+ * files use. A strong hypothesis must have been written for the evaluator given.
+ */
+bool binaryToText(const std::string & inputFile, const std::string & outputFile, const BinaryModel::Kind kind, const BinaryModel::Evaluator evaluator)
+{
+    BinaryModel model;
+    if ( !model.map(inputFile) || model.kind() != kind || model.evaluator() != evaluator )
+    {
+        return false;
+    }
+
+    std::ofstream out(outputFile.c_str(), std::ios::trunc);
+    if ( !out.is_open() )
+    {
+        return false;
+    }
+
+    for (std::size_t k = 0; k < model.size(); ++k)
+    {
+        const BinaryModelEntry & entry = model.entry(k);
+        if (kind == BinaryModel::strongHypothesisKind)
+        {
+            out << entry.alpha << ' ';
+        }
+        model.wavelet(k).write(out);
+        if (kind == BinaryModel::strongHypothesisKind)
+        {
+            out << ' ' << entry.polarity << ' ' << entry.theta;
+        }
+        out << std::endl;
+    }
+
+    return out.good();
+}
+
+
+
+/**
+ * Writes a text wavelet pool as a binary model. Pools hold no evaluator, so ViolaJonesClassifier
+ * reads them all.
+ */
+bool poolToBinary(const std::string & inputFile, const std::string & outputFile)
+{
+    std::vector<ViolaJonesClassifier> pool;
+    return loadHaarClassifiers(inputFile, pool) && BinaryModel::write(outputFile, pool);
+}
+
+
+
+/**
+ * Writes a text strong hypothesis, read as WeakHypothesisType, as a binary model for the
+ * evaluator of WeakHypothesisType.
+ */
+template<typename WeakHypothesisType>
+bool strongHypothesisToBinary(const std::string & inputFile, const std::string & outputFile)
+{
+    StrongHypothesis<WeakHypothesisType> strongHypothesis;
+    std::ifstream in(inputFile.c_str());
+    return in.is_open() && strongHypothesis.read(in) && BinaryModel::write(outputFile, strongHypothesis);
+}
+
+
+
+/**
+ * Counts the windows of a random image, at a few scales, whose classification value differs
+ * between the text strong hypothesis, read as WeakHypothesisType, and the binary one, mapped
+ * over the same evaluator.
+ */
+template<typename WeakHypothesisType>
+std::size_t differentValues(const StrongHypothesis<WeakHypothesisType> & text, const MappedStrongHypothesis<typename WeakHypothesisType::evaluator_type> & binary)
+{
+    boost::random::mt19937 rng(11);
+    boost::random::uniform_int_distribution<int> pixel(0, 255);
+    cv::Mat image(64, 64, cv::DataType<unsigned char>::type);
+    for (int r = 0; r < image.rows; ++r)
+    {
+        for (int c = 0; c < image.cols; ++c)
+        {
+            image.at<unsigned char>(r, c) = pixel(rng);
+        }
+    }
+
+    cv::Mat integralSum, integralSquare;
+    WeakHypothesisType::integrals_type::compute(image, integralSum, integralSquare, true);
+
+    std::size_t different = 0;
+    for (float scale = 1.0f; scale < 3.0f; scale *= 1.25f)
+    {
+        const int size = (int)(20 * scale);
+        for (int y = 0; y + size < integralSum.rows; y += 2)
+        {
+            for (int x = 0; x + size < integralSum.cols; x += 2)
+            {
+                //The integral image ROI is 1 unit bigger than the original image ROI.
+                const cv::Rect roi(x, y, size + 1, size + 1);
+                const Example example(integralSum(roi), integralSquare(roi));
+                different += text.classificationValue(example, scale) != binary.classificationValue(example, scale);
+            }
+        }
+    }
+    return different;
+}
+
+
+
+/**
+ * Checks that the binary strong hypothesis just written evaluates as the text one, both read
+ * as WeakHypothesisType, and reports how long each takes to load.
+ */
+template<typename WeakHypothesisType>
+bool checkStrongHypothesis(const std::string & textFile, const std::string & binaryFile)
+{
+    tbb::tick_count start = tbb::tick_count::now();
+    StrongHypothesis<WeakHypothesisType> text;
+    std::ifstream in(textFile.c_str());
+    if ( !in.is_open() || !text.read(in) )
+    {
+        return false;
+    }
+    const double textSeconds = (tbb::tick_count::now() - start).seconds();
+
+    start = tbb::tick_count::now();
+    MappedStrongHypothesis<typename WeakHypothesisType::evaluator_type> binary;
+    if ( !binary.map(binaryFile) )
+    {
+        return false;
+    }
+    const double binarySeconds = (tbb::tick_count::now() - start).seconds();
+
+    const std::size_t different = text.size() != binary.size() ? 1 : differentValues(text, binary);
+    std::cout << text.size() << " weak classifiers. Loaded in " << textSeconds * 1e3 << " ms as text, "
+              << binarySeconds * 1e3 << " ms as binary. Classification values that differ: " << different << std::endl;
+    return different == 0;
+}
+
+
+
+/**
+ * Converts a text strong hypothesis, read as WeakHypothesisType, to a binary one and checks it.
+ * @return the exit code of this program.
+ */
+template<typename WeakHypothesisType>
+int convertStrongHypothesis(const std::string & inputFile, const std::string & outputFile)
+{
+    if ( !strongHypothesisToBinary<WeakHypothesisType>(inputFile, outputFile) )
+    {
+        return 11;
+    }
+    return checkStrongHypothesis<WeakHypothesisType>(inputFile, outputFile) ? 0 : 13;
+}
+
+
+
+/**
+ * Checks that the binary wavelet pool just written loads the same wavelets as the text one,
+ * and reports how long each takes to load.
+ */
+bool checkPool(const std::string & textFile, const std::string & binaryFile)
+{
+    std::vector<ViolaJonesClassifier> textPool, binaryPool;
+    tbb::tick_count start = tbb::tick_count::now();
+    if ( !loadHaarClassifiers(textFile, textPool) )
+    {
+        return false;
+    }
+    const double textSeconds = (tbb::tick_count::now() - start).seconds();
+
+    start = tbb::tick_count::now();
+    if ( !loadHaarClassifiers(binaryFile, binaryPool) )
+    {
+        return false;
+    }
+    const double binarySeconds = (tbb::tick_count::now() - start).seconds();
+
+    std::size_t different = textPool.size() != binaryPool.size();
+    for (std::size_t j = 0; !different && j < textPool.size(); ++j)
+    {
+        std::ostringstream text, binary;
+        textPool[j].getFeature().write(text);
+        binaryPool[j].getFeature().write(binary);
+        different += text.str() != binary.str();
+    }
+    std::cout << textPool.size() << " wavelets. Loaded in " << textSeconds * 1e3 << " ms as text, "
+              << binarySeconds * 1e3 << " ms as binary. Wavelets that differ: " << different << std::endl;
+    return different == 0;
+}
+
+
+
+/**
+ * Converts strong hypothesis and wavelet pool files between the text and the binary formats
+ * (see binarymodel.h). Binary input files are written as text, text ones as binary. A binary
+ * file written is then checked against the text it came from: a strong hypothesis must give
+ * the same classification values, mapped, as read from text, and a pool the same wavelets.
+ * Returns 13 if it does not.
+ *
+ * A strong hypothesis is read as the in-tree classifier of the model it was trained as, and
+ * written for its evaluator: vj for ViolaJonesIntegralClassifier, pavani for
+ * PavaniHaarIntegralClassifier and band for MyHaarIntegralClassifier. A binary one is written
+ * as text only if it was written for the evaluator of the model given.
+ *
+ * Arguments:
+ *     strong vj|pavani|band | pool
+ *     inputFile
+ *     outputFile
+ */
+int main(int argc, char **argv) {
+    const bool strong = argc > 1 && std::string(argv[1]) == "strong";
+    const std::string model = strong && argc > 2 ? argv[2] : "";
+    if ( argc != (strong ? 5 : 4)
+         || (!strong && std::string(argv[1]) != "pool")
+         || (strong && model != "vj" && model != "pavani" && model != "band") )
+    {
+        std::cout << "Usage: " << argv[0] << " strong vj|pavani|band inputFile outputFile" << std::endl
+                  << "       " << argv[0] << " pool inputFile outputFile" << std::endl;
+        return 1;
+    }
+
+    const std::string inputFile = argv[argc - 2];
+    const std::string outputFile = argv[argc - 1];
+
+    if ( BinaryModel::isBinary(inputFile) )
+    {
+        const bool written = !strong ? binaryToText(inputFile, outputFile, BinaryModel::waveletPoolKind, BinaryModel::noEvaluator)
+                           : model == "vj" ? binaryToText(inputFile, outputFile, BinaryModel::strongHypothesisKind, BinaryModelEvaluator<ViolaJonesIntegralClassifier::evaluator_type>::value)
+                           : binaryToText(inputFile, outputFile, BinaryModel::strongHypothesisKind, BinaryModelEvaluator<MyHaarIntegralClassifier::evaluator_type>::value);
+        return written ? 0 : 7;
+    }
+
+    if ( model == "vj" )
+    {
+        return convertStrongHypothesis<ViolaJonesIntegralClassifier>(inputFile, outputFile);
+    }
+    if ( model == "pavani" )
+    {
+        return convertStrongHypothesis<PavaniHaarIntegralClassifier>(inputFile, outputFile);
+    }
+    if ( model == "band" )
+    {
+        return convertStrongHypothesis<MyHaarIntegralClassifier>(inputFile, outputFile);
+    }
+
+    if ( !poolToBinary(inputFile, outputFile) )
+    {
+        return 11;
+    }
+    return checkPool(inputFile, outputFile) ? 0 : 13;
+}
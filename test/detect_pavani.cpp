@@ -7,81 +7,19 @@
 #include "common.h"
 #include "stronghypothesis.h"
 #include "weakhypothesis.h"
+#include "scanner.h"
+#include "grouping.h"
 
 
-#define USAGE_MSG "USAGE: " << argv[0] << " IMAGE_PATH CLASSIFIER_PATH THRESHOLD" << std::endl
+#define USAGE_MSG "USAGE: " << argv[0] << " IMAGE_PATH CLASSIFIER_PATH THRESHOLD [--group MIN_NEIGHBORS | --nms MAX_OVERLAP] [--haarcommon]" << std::endl
 
 
 /**
- * Iterates over an image producing instances of ScannerEntry. Latter, such entries will be processed
- * so a ROC curve is produced.
+ * Reads the classifier as weak classifiers of WeakClassifierType, detects with it and shows
+ * the detections. argc does not count --haarcommon.
  */
 template<typename WeakClassifierType>
-class Scanner
-{
-public:
-    Scanner(StrongHypothesis<WeakClassifierType> & classifier_) : classifier(classifier_),
-                                                                  initial_size(20),
-                                                                  scaling_factor(1.25),
-                                                                  delta(1.5) {}
-
-
-
-    void scan(const cv::Mat               & image,
-              std::vector<cv::Rect>       & detections)
-    {
-        cv::Mat integralSum   (image.rows + 1, image.cols + 1, cv::DataType<double>::type);
-        cv::Mat integralSquare(image.rows + 1, image.cols + 1, cv::DataType<double>::type);
-        cv::integral(image, integralSum, integralSquare, cv::DataType<double>::type);
-
-        //This algorithm will iterate over the INTEGRAL images, reflecting what would be happening while
-        //iterating over the real image.
-
-        for(double scale = 1.5; scale * initial_size < integralSum.cols
-                             && scale * initial_size < integralSum.rows; scale *= scaling_factor)
-        {
-            const double shift = delta * scale;
-            cv::Rect integralRoi(0, 0, (initial_size * scale) + 1, (initial_size * scale) + 1); //The integral image ROI is 1 unit bigger than the original image ROI.
-
-            for (integralRoi.x = 0; integralRoi.x <= integralSum.cols - integralRoi.width; integralRoi.x += shift)
-            {
-                for (integralRoi.y = 0; integralRoi.y <= integralSum.rows - integralRoi.height; integralRoi.y += shift)
-                {
-                    cv::Rect roi = integralRoi; //This is the ROI on the real image. We need it because the
-                    roi.width -= 1;             //integral images ROIs are 1 unit bigger the the original.
-                    roi.height -= 1;            //This unit shouldn't be used when scaling the real image ROI.
-
-                    const Example example(integralSum(integralRoi), integralSquare(integralRoi));
-
-                    if ( classifier.classify(example, scale) == yes )
-                    {
-                        detections.push_back(roi);
-                    }
-                }
-            }
-        }
-    }
-
-private:
-
-    const StrongHypothesis<WeakClassifierType> & classifier;
-    const int initial_size;      //initial width and height of the detector
-    const double scaling_factor; //how mutch the scale will change per iteration
-    const double delta;          //window shift constant
-};
-
-
-
-/**
- *
- */
-int main(int argc, char **argv) {
-    if (argc != 4) {
-        std::cout << USAGE_MSG;
-
-        return 1;
-    }
-
+int detect(int argc, char **argv) {
     const std::string imagePath = argv[1];
     const std::string classifierPath = argv[2];
     const std::string thresholdParam = argv[3];
@@ -95,7 +33,7 @@ int main(int argc, char **argv) {
 
 
 
-    StrongHypothesis<PavaniHaarClassifier> strongHypothesis;
+    StrongHypothesis<WeakClassifierType> strongHypothesis;
     {
         std::ifstream in(classifierPath.c_str());
         if ( !in.is_open() )
@@ -117,16 +55,40 @@ int main(int argc, char **argv) {
 
 
 
-    std::vector<cv::Rect> detections;
-    Scanner<PavaniHaarClassifier> scanner(strongHypothesis);
-    scanner.scan(image, detections);
+    const Scanner<WeakClassifierType> scanner(strongHypothesis);
+    std::vector<Detection> detections;
+    scanner.detect(image, detections);
+
+    if ( argc == 6 )
+    {
+        const std::string mode = argv[4];
+        DetectionGrouping grouping;
+        if ( mode == "--group" )
+        {
+            grouping.mode = DetectionGrouping::group;
+        }
+        else if ( mode == "--nms" )
+        {
+            grouping.mode = DetectionGrouping::nms;
+        }
+        else
+        {
+            std::cout << USAGE_MSG;
+            return 1;
+        }
+        std::stringstream(argv[5]) >> grouping.parameter;
+
+        const std::size_t found = detections.size();
+        grouping.apply(detections);
+        std::cout << "Grouped " << found << " detections." << std::endl;
+    }
     std::cout << "Found " << detections.size() << " face(s)." << std::endl;
 
 
 
-    for(std::vector<cv::Rect>::iterator it = detections.begin(); it != detections.end(); ++it)
+    for(std::vector<Detection>::iterator it = detections.begin(); it != detections.end(); ++it)
     {
-        cv::rectangle(image, *it, cv::Scalar( 255, 0, 0 ));
+        cv::rectangle(image, it->rect, cv::Scalar( 255, 0, 0 ));
     }
     cv::imshow("Detections", image);
     cv::waitKey( 0 );
@@ -135,3 +97,22 @@ int main(int argc, char **argv) {
 
     return 0;
 }
+
+
+
+/**
+ * The classifier is read as PavaniHaarIntegralClassifier, over the in-tree evaluators (see
+ * weakhypothesis.h), unless --haarcommon is given last: then it is read as PavaniHaarClassifier.
+ */
+int main(int argc, char **argv) {
+    const bool haarcommon = argc > 1 && std::string(argv[argc - 1]) == "--haarcommon";
+    const int arguments = haarcommon ? argc - 1 : argc;
+    if (arguments != 4 && arguments != 6) {
+        std::cout << USAGE_MSG;
+
+        return 1;
+    }
+
+    return haarcommon ? detect<PavaniHaarClassifier>(arguments, argv)
+                      : detect<PavaniHaarIntegralClassifier>(arguments, argv);
+}
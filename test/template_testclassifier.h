@@ -18,6 +18,7 @@
 
 #include "common.h"
 #include "stronghypothesis.h"
+#include "compiledstronghypothesis.h"
 #include "weakhypothesis.h"
 
 
@@ -60,7 +61,8 @@ struct ScannerEntry
 
 /**
  * Iterates over an image producing instances of ScannerEntry. Latter, such entries will be processed
- * so a ROC curve is produced.
+ * so a ROC curve is produced. The strong hypothesis is compiled once per scanner (see
+ * CompiledStrongHypothesis), and laid out once for each scale of each image.
  */
 template<typename WeakClassifierType>
 class RocScanner
@@ -76,11 +78,12 @@ public:
     void scan(const cv::Mat & image, const std::vector<cv::Rect> & groundTruth,
               tbb::concurrent_vector<ScannerEntry> & entries,
               unsigned int & positiveInstances,
-              unsigned int & negativeInstances)
+              unsigned int & negativeInstances,
+              unsigned long & evaluations)
     {
-        cv::Mat integralSum   (image.rows + 1, image.cols + 1, cv::DataType<double>::type);
-        cv::Mat integralSquare(image.rows + 1, image.cols + 1, cv::DataType<double>::type);
-        cv::integral(image, integralSum, integralSquare, cv::DataType<double>::type);
+        cv::Mat integralSum;
+        cv::Mat integralSquare;
+        WeakClassifierType::integrals_type::compute(image, integralSum, integralSquare, WeakClassifierType::needs_integral_square);
 
         //This algorithm will iterate over the INTEGRAL images, reflecting what would be happening while
         //iterating over the real image.
@@ -91,6 +94,9 @@ public:
             const double shift = delta * scale;
             cv::Rect integralRoi(0, 0, (initial_size * scale) + 1, (initial_size * scale) + 1); //The integral image ROI is 1 unit bigger than the original image ROI.
 
+            typename CompiledStrongHypothesis<WeakClassifierType>::Layout layout;
+            classifier.layout(scale, integralSum.step1(), layout);
+
             for (integralRoi.x = 0; integralRoi.x <= integralSum.cols - integralRoi.width; integralRoi.x += shift)
             {
                 for (integralRoi.y = 0; integralRoi.y <= integralSum.rows - integralRoi.height; integralRoi.y += shift)
@@ -101,10 +107,13 @@ public:
 
                     const bool isFaceRegion = matchesGroundTruth(roi, groundTruth); //if true, detections on this ROI are true positives
 
-                    const Example example(integralSum(integralRoi), integralSquare(integralRoi));
+                    const Example example(integralSum(integralRoi),
+                                          integralSquare.empty() ? cv::Mat() : integralSquare(integralRoi));
 
-                    ScannerEntry e(roi, classifier.classificationValue(example, scale), isFaceRegion);
+                    unsigned int evaluated;
+                    ScannerEntry e(roi, classifier.classificationValue(example, layout, evaluated), isFaceRegion);
                     entries.push_back(e);
+                    evaluations += evaluated;
 
                     positiveInstances += isFaceRegion;
                     negativeInstances += !isFaceRegion;
@@ -149,7 +158,7 @@ private:
 
 
 
-    const StrongHypothesis<WeakClassifierType> & classifier;
+    const CompiledStrongHypothesis<WeakClassifierType> classifier;
     const int initial_size;      //initial width and height of the detector
     const double scaling_factor; //how mutch the scale will change per iteration
     const double delta;          //window shift constant
@@ -167,6 +176,7 @@ struct ParallelScan
     unsigned int & totalPositiveInstances;
     unsigned int & totalNegativeInstances;
     unsigned int & evaluatedImages;
+    unsigned long & totalEvaluations;
     StrongHypothesis<WeakHypothesisType> & strongHypothesis;
     tbb::concurrent_vector<ScannerEntry> & entries;
     tbb::queuing_mutex & mutex;
@@ -175,12 +185,14 @@ struct ParallelScan
                  unsigned int                         & totalPositiveInstances_,
                  unsigned int                         & totalNegativeInstances_,
                  unsigned int                         & evaluatedImages_,
+                 unsigned long                        & totalEvaluations_,
                  StrongHypothesis<WeakHypothesisType> & strongHypothesis_,
                  tbb::concurrent_vector<ScannerEntry> & entries_,
                  tbb::queuing_mutex                   & mutex_) : images(images_),
                                                                   totalPositiveInstances(totalPositiveInstances_),
                                                                   totalNegativeInstances(totalNegativeInstances_),
                                                                   evaluatedImages(evaluatedImages_),
+                                                                  totalEvaluations(totalEvaluations_),
                                                                   strongHypothesis(strongHypothesis_),
                                                                   entries(entries_),
                                                                   mutex(mutex_) {}
@@ -193,14 +205,16 @@ struct ParallelScan
         {
             unsigned int positiveInstancesCount = 0;
             unsigned int negativeInstancesCount = 0;
+            unsigned long evaluations = 0;
 
             ImageAndGroundTruth imageAndGt = images[k];
-            scanner.scan(imageAndGt.image, imageAndGt.faces, entries, positiveInstancesCount, negativeInstancesCount);
+            scanner.scan(imageAndGt.image, imageAndGt.faces, entries, positiveInstancesCount, negativeInstancesCount, evaluations);
 
             {
                 tbb::queuing_mutex::scoped_lock lock(mutex);
                 totalPositiveInstances += positiveInstancesCount;
                 totalNegativeInstances += negativeInstancesCount;
+                totalEvaluations += evaluations;
                 evaluatedImages += 1;
 
                 std::cout << "\rProgress " << 100 * evaluatedImages / images.size() << '%';
@@ -301,7 +315,8 @@ template<typename WeakHypothesisType>
 int ___main(const std::string testImagesIndexFileName,
             const std::string groundTruthFileName,
             const std::string strongHypothesisFile,
-            const std::string rocCurveFile)
+            const std::string rocCurveFile,
+            const std::string rejectionTraceFile = std::string())
 {
     StrongHypothesis<WeakHypothesisType> strongHypothesis;
     {
@@ -318,6 +333,17 @@ int ___main(const std::string testImagesIndexFileName,
         std::cout << "Loaded strong classifier from " << strongHypothesisFile << std::endl;
     }
 
+    if ( !rejectionTraceFile.empty() )
+    {
+        std::ifstream in(rejectionTraceFile.c_str());
+        if ( !in.is_open() || !strongHypothesis.readRejectionTrace(in) )
+        {
+            return 17;
+        }
+
+        std::cout << "Loaded rejection trace from " << rejectionTraceFile << std::endl;
+    }
+
 
 
     int totalFacesInGroundTruth = 0;
@@ -338,6 +364,7 @@ int ___main(const std::string testImagesIndexFileName,
 
     unsigned int totalPositiveWindows = 0;
     unsigned int totalNegativeWindows = 0;
+    unsigned long totalEvaluations = 0;
     tbb::concurrent_vector<ScannerEntry> entries;
     {
         unsigned int evaluatedImages = 0;
@@ -351,6 +378,7 @@ int ___main(const std::string testImagesIndexFileName,
                                                            totalPositiveWindows,
                                                            totalNegativeWindows,
                                                            evaluatedImages,
+                                                           totalEvaluations,
                                                            strongHypothesis,
                                                            entries,
                                                            mutex) );
@@ -358,7 +386,15 @@ int ___main(const std::string testImagesIndexFileName,
         std::cout << "\rTotal evaluated images: " << evaluatedImages;
         std::cout << "\rTotal positive windows: " << totalPositiveWindows;
         std::cout << "\nTotal negative windows: " << totalNegativeWindows;
-        std::cout << "\nTotal scanned windows : " << totalPositiveWindows + totalNegativeWindows << std::endl;
+        std::cout << "\nTotal scanned windows : " << totalPositiveWindows + totalNegativeWindows;
+        if ( totalPositiveWindows + totalNegativeWindows > 0 )
+        {
+            std::cout << "\nWeak classifiers evaluated per window: " << (double)totalEvaluations / (totalPositiveWindows + totalNegativeWindows) << std::endl;
+        }
+        else
+        {
+            std::cout << "\nNo window was scanned: every image is smaller than the detector." << std::endl;
+        }
     }
 
     std::cout << "\nBuilding ROC curve..." << std::endl;
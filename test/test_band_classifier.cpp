@@ -3,17 +3,34 @@
 
 
 /**
+ * Arguments: testImagesIndexFile groundTruthFile strongHypothesisFile rocCurveFile [rejectionTraceFile] [--haarcommon]
  *
+ * The model is read as MyHaarIntegralClassifier, over the in-tree evaluators (see weakhypothesis.h),
+ * unless --haarcommon is given: then it is read as MyHaarClassifier.
  */
-int main(int, char **argv) {
+int main(int argc, char **argv) {
+    const bool haarcommon = std::string(argv[argc - 1]) == "--haarcommon";
+    const int arguments = haarcommon ? argc - 1 : argc;
+
     const std::string testImagesIndexFileName = argv[1];
     const std::string groundTruthFileName = argv[2];
     const std::string strongHypothesisFile = argv[3];
     const std::string rocCurveFile = argv[4];
+    const std::string rejectionTraceFile = arguments > 5 ? argv[5] : "";
 
-    return ___main<MyHaarClassifier>(
+    if ( haarcommon )
+    {
+        return ___main<MyHaarClassifier>(
+                    testImagesIndexFileName,
+                    groundTruthFileName,
+                    strongHypothesisFile,
+                    rocCurveFile,
+                    rejectionTraceFile);
+    }
+    return ___main<MyHaarIntegralClassifier>(
                 testImagesIndexFileName,
                 groundTruthFileName,
                 strongHypothesisFile,
-                rocCurveFile);
+                rocCurveFile,
+                rejectionTraceFile);
 }
@@ -0,0 +1,309 @@
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "weakhypothesis.h"
+#include "stronghypothesis.h"
+#include "compiledstronghypothesis.h"
+#include "scanner.h"
+
+
+
+namespace
+{
+
+/**
+ * The integral images of an image, as a classifier reads them.
+ */
+template<typename WeakHypothesisType>
+struct Integrals
+{
+    cv::Mat sum;
+    cv::Mat square;
+
+    Integrals(const cv::Mat & image)
+    {
+        WeakHypothesisType::integrals_type::compute(image, sum, square, WeakHypothesisType::needs_integral_square);
+    }
+
+    Example window(const cv::Rect & roi) const
+    {
+        return Example(sum(roi), square.empty() ? cv::Mat() : square(roi));
+    }
+};
+
+
+
+/**
+ * Two, three and four rectangle wavelets of a 20 x 20 window, as a wavelet pool has them, at
+ * a few positions and sizes. The weight of the last rectangle of each is multiplied by
+ * adjustment, as the band classifier adjusts the weights of its wavelets away from integers.
+ */
+template<typename FeatureType>
+void makeWavelets(const float adjustment, std::vector<FeatureType> & wavelets)
+{
+    for (int y = 0; y + 8 <= 20; y += 5)
+    {
+        for (int x = 0; x + 8 <= 20; x += 5)
+        {
+            for (int size = 2; size <= 4; size += 2)
+            {
+                std::vector<cv::Rect> rects;
+                std::vector<float> weights;
+
+                //Left and right
+                rects.push_back( cv::Rect(x, y, size, 2 * size) );        weights.push_back(1);
+                rects.push_back( cv::Rect(x + size, y, size, 2 * size) ); weights.push_back(-adjustment);
+                wavelets.push_back( FeatureType(rects, weights) );
+
+                //Top, middle and bottom
+                rects.clear();
+                weights.clear();
+                rects.push_back( cv::Rect(x, y, 2 * size, size) );            weights.push_back(1);
+                rects.push_back( cv::Rect(x, y + size, 2 * size, size) );     weights.push_back(-2);
+                rects.push_back( cv::Rect(x, y + 2 * size, 2 * size, size) ); weights.push_back(adjustment);
+                wavelets.push_back( FeatureType(rects, weights) );
+
+                //Diagonals
+                rects.clear();
+                weights.clear();
+                rects.push_back( cv::Rect(x, y, size, size) );               weights.push_back(1);
+                rects.push_back( cv::Rect(x + size, y, size, size) );        weights.push_back(-1);
+                rects.push_back( cv::Rect(x, y + size, size, size) );        weights.push_back(-1);
+                rects.push_back( cv::Rect(x + size, y + size, size, size) ); weights.push_back(adjustment);
+                wavelets.push_back( FeatureType(rects, weights) );
+            }
+        }
+    }
+}
+
+
+
+/**
+ * Images with the flat regions, edges, gradients and noise of a photograph. Saturated and
+ * constant regions are where normalizations divide by small or zero values.
+ */
+void makeImages(std::vector<cv::Mat> & images)
+{
+    boost::random::mt19937 rng(137);
+    boost::random::uniform_int_distribution<int> noise(-12, 12);
+
+    const cv::Size sizes[] = { cv::Size(64, 48), cv::Size(97, 71), cv::Size(160, 120) };
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        cv::Mat image(sizes[s], cv::DataType<unsigned char>::type);
+        for (int r = 0; r < image.rows; ++r)
+        {
+            for (int c = 0; c < image.cols; ++c)
+            {
+                int value = 40 + 150 * c / image.cols + noise(rng);
+                if ( r > image.rows / 3 && r < image.rows / 2 && c > image.cols / 4 && c < image.cols / 2 )
+                {
+                    value = 255;
+                }
+                else if ( r > 2 * image.rows / 3 && c > 2 * image.cols / 3 )
+                {
+                    value = 0;
+                }
+                image.at<unsigned char>(r, c) = (unsigned char)std::max(0, std::min(255, value));
+            }
+        }
+        images.push_back(image);
+    }
+}
+
+
+
+/**
+ * Evaluates every window a Scanner would of every image with the same weak hypothesis over
+ * haarcommon's evaluator, HaarcommonType, and over the in-tree one, IntegralType, the latter
+ * also compiled as the Scanner does. Returns how many feature values and classification values
+ * are not the same bits as haarcommon's.
+ */
+template<typename HaarcommonType, typename IntegralType, typename FeatureType>
+std::size_t compare(const char * name, const std::vector<FeatureType> & wavelets, const std::vector<cv::Mat> & images)
+{
+    StrongHypothesis<HaarcommonType> haarcommon;
+    StrongHypothesis<IntegralType> integral;
+    for (std::size_t k = 0; k < wavelets.size(); ++k)
+    {
+        FeatureType wavelet = wavelets[k];
+        HaarcommonType haarcommonWeak(wavelet);
+        IntegralType integralWeak(wavelet);
+        haarcommonWeak.setPolarity(k % 2 ? 1 : -1);
+        integralWeak.setPolarity(k % 2 ? 1 : -1);
+
+        const weight_type alpha = 1.0f / (k + 1);
+        haarcommon.insert(alpha, haarcommonWeak);
+        integral.insert(alpha, integralWeak);
+    }
+    const CompiledStrongHypothesis<IntegralType> compiled(integral);
+
+    std::size_t windows = 0;
+    std::size_t different = 0;
+    const ScanPlan scanPlan;
+    for (std::size_t i = 0; i < images.size(); ++i)
+    {
+        const Integrals<HaarcommonType> haarcommonIntegrals(images[i]);
+        const Integrals<IntegralType> integralIntegrals(images[i]);
+
+        std::vector<ScanLevel> levels;
+        std::vector<ScanTile> tiles;
+        scanPlan.plan(cv::Size(images[i].cols, images[i].rows), levels, tiles);
+
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            const ScanLevel & level = levels[l];
+            typename CompiledStrongHypothesis<IntegralType>::Layout layout;
+            compiled.layout(level.scale, integralIntegrals.sum.step1(), layout);
+
+            for (std::vector<int>::const_iterator y = level.ys.begin(); y != level.ys.end(); ++y)
+            {
+                for (std::vector<int>::const_iterator x = level.xs.begin(); x != level.xs.end(); ++x)
+                {
+                    //The integral image ROI is 1 unit bigger than the original image ROI.
+                    const cv::Rect roi(*x, *y, level.size + 1, level.size + 1);
+                    const Example haarcommonExample = haarcommonIntegrals.window(roi);
+                    const Example integralExample = integralIntegrals.window(roi);
+                    const float scale = (float)level.scale;
+
+                    for (std::size_t k = 0; k < wavelets.size(); ++k)
+                    {
+                        different += haarcommon.weakHypothesis(k).featureValue(haarcommonExample, scale)
+                                     != integral.weakHypothesis(k).featureValue(integralExample, scale);
+                    }
+
+                    unsigned int evaluated;
+                    const float reference = haarcommon.classificationValue(haarcommonExample, scale);
+                    different += integral.classificationValue(integralExample, scale) != reference;
+                    different += compiled.classificationValue(integralExample, layout, evaluated) != reference;
+                    ++windows;
+                }
+            }
+        }
+    }
+
+    std::cout << name << ": " << windows << " windows, " << different << " values differ from haarcommon's" << std::endl;
+    return windows == 0 ? 1 : different;
+}
+
+
+
+/**
+ * Evaluates every window a Scanner would of every image with weak hypotheses of
+ * WeakHypothesisType, declared not to need the integral square, both with the integral square
+ * and with an empty one. Returns how many feature values are not the same bits.
+ */
+template<typename WeakHypothesisType, typename FeatureType>
+std::size_t compareWithoutSquare(const char * name, const std::vector<FeatureType> & wavelets, const std::vector<cv::Mat> & images)
+{
+    if ( WeakHypothesisType::needs_integral_square )
+    {
+        std::cout << name << ": declared to need the integral square" << std::endl;
+        return 1;
+    }
+
+    std::vector<WeakHypothesisType> weakHypotheses;
+    for (std::size_t k = 0; k < wavelets.size(); ++k)
+    {
+        FeatureType wavelet = wavelets[k];
+        weakHypotheses.push_back( WeakHypothesisType(wavelet) );
+    }
+
+    std::size_t windows = 0;
+    std::size_t different = 0;
+    const ScanPlan scanPlan;
+    for (std::size_t i = 0; i < images.size(); ++i)
+    {
+        cv::Mat sum, square;
+        WeakHypothesisType::integrals_type::compute(images[i], sum, square, true);
+
+        std::vector<ScanLevel> levels;
+        std::vector<ScanTile> tiles;
+        scanPlan.plan(cv::Size(images[i].cols, images[i].rows), levels, tiles);
+
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            const ScanLevel & level = levels[l];
+            for (std::vector<int>::const_iterator y = level.ys.begin(); y != level.ys.end(); ++y)
+            {
+                for (std::vector<int>::const_iterator x = level.xs.begin(); x != level.xs.end(); ++x)
+                {
+                    const cv::Rect roi(*x, *y, level.size + 1, level.size + 1);
+                    const Example squared(sum(roi), square(roi));
+                    const Example unsquared(sum(roi), cv::Mat());
+                    const float scale = (float)level.scale;
+
+                    for (std::size_t k = 0; k < weakHypotheses.size(); ++k)
+                    {
+                        different += weakHypotheses[k].featureValue(squared, scale)
+                                     != weakHypotheses[k].featureValue(unsquared, scale);
+                    }
+                    ++windows;
+                }
+            }
+        }
+    }
+
+    std::cout << name << ": " << windows << " windows, " << different << " values differ without the integral square" << std::endl;
+    return windows == 0 ? 1 : different;
+}
+
+}
+
+
+
+/**
+ * Checks that the in-tree evaluators, over double and 32 bit integer integral sums, give
+ * haarcommon's feature values, bit for bit, on the windows the Scanner scans at every scale,
+ * and that the strong hypothesis over them gives haarcommon's classification values, both
+ * through StrongHypothesis and compiled (see CompiledStrongHypothesis). Both HaarWavelet and
+ * MyHaarWavelet are checked, since the in-tree evaluators and the compiled form read either as
+ * a weighted sum of rectangles. Also checks that haarcommon's intensity normalized evaluator,
+ * declared not to need the integral square, gives the same values without it. Returns 2 if
+ * any value differs.
+ *
+ * Scans the images given as arguments, or a few drawn ones if none is.
+ */
+int main(int argc, char **argv) {
+    std::vector<cv::Mat> images;
+    for (int i = 1; i < argc; ++i)
+    {
+        const cv::Mat image = cv::imread(argv[i], cv::DataType<unsigned char>::type);
+        if ( !image.data )
+        {
+            std::cout << "Could not read " << argv[i] << '.' << std::endl;
+            return 13;
+        }
+        images.push_back(image);
+    }
+    if ( images.empty() )
+    {
+        makeImages(images);
+    }
+
+    std::vector<HaarWavelet> wavelets;
+    makeWavelets(1.0f, wavelets);
+    std::vector<MyHaarWavelet> bandWavelets;
+    makeWavelets(0.73f, bandWavelets);
+
+    std::size_t different = 0;
+    different += compare<ViolaJonesClassifier, ViolaJonesIntegralClassifier>("variance normalized", wavelets, images);
+    different += compare<ViolaJonesClassifier, ViolaJonesInt32Classifier>("variance normalized, int32 sums", wavelets, images);
+    different += compare<PavaniHaarClassifier, PavaniHaarIntegralClassifier>("intensity normalized", wavelets, images);
+    different += compare<MyHaarClassifier, MyHaarIntegralClassifier>("intensity normalized, band wavelets", bandWavelets, images);
+    different += compareWithoutSquare<PavaniHaarClassifier>("haarcommon intensity normalized", wavelets, images);
+    different += compareWithoutSquare<MyHaarClassifier>("haarcommon intensity normalized, band wavelets", bandWavelets, images);
+
+    std::cout << (different ? "FAILED" : "PASSED") << std::endl;
+
+    return different ? 2 : 0;
+}
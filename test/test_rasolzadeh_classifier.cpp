@@ -5,15 +5,17 @@
 /**
  *
  */
-int main(int, char **argv) {
+int main(int argc, char **argv) {
     const std::string testImagesIndexFileName = argv[1];
     const std::string groundTruthFileName = argv[2];
     const std::string strongHypothesisFile = argv[3];
     const std::string rocCurveFile = argv[4];
+    const std::string rejectionTraceFile = argc > 5 ? argv[5] : "";
 
     return ___main<RasolzadehHaarClassifier>(
                 testImagesIndexFileName,
                 groundTruthFileName,
                 strongHypothesisFile,
-                rocCurveFile);
+                rocCurveFile,
+                rejectionTraceFile);
 }
@@ -0,0 +1,20 @@
+#include "template_testclassifier.h"
+
+
+
+/**
+ *
+ */
+int main(int argc, char **argv) {
+    const std::string testImagesIndexFileName = argv[1];
+    const std::string groundTruthFileName = argv[2];
+    const std::string strongHypothesisFile = argv[3];
+    const std::string rocCurveFile = argv[4];
+    const std::string rejectionTraceFile = argc > 5 ? argv[5] : "";
+
+    return ___main<ViolaJonesInt32Classifier>(testImagesIndexFileName,
+                                              groundTruthFileName,
+                                              strongHypothesisFile,
+                                              rocCurveFile,
+                                              rejectionTraceFile);
+}
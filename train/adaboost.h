@@ -4,26 +4,48 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <string>
+#include <sstream>
+#include <limits>
 #include <algorithm>
+#include <functional>
 #include <tbb/tbb.h>
 
 #include "common.h"
 #include "labeledexample.h"
 #include "stronghypothesis.h"
 #include "progresscallback.h"
+#include "samplestore.h"
+#include "trainingdata.h"
+#include "weightedresampler.h"
+#include "featuresampler.h"
+#include "checkpoint.h"
 
 #include "weaklearner.h"
 
 
 
+/**
+ * Decides, after each boosting round, whether Adaboost should stop before its maximum amount
+ * of rounds, looking at the strong hypothesis trained so far.
+ */
+template<typename WeakHypothesisType>
+class StopCriterion
+{
+public:
+    virtual ~StopCriterion() {}
+
+    virtual bool stop(const StrongHypothesis<WeakHypothesisType> & strong_hypothesis) = 0;
+};
+
+
+
 /**
  * Implementation of the Adaboost algorithm.
  */
 template<typename WeakHypothesisType, typename WeakLearnerType> //WTF THIS COMPILES???? ==> template<typename WeakHypothesisType, typename WeakLearnerType = WeakLearner<std::vector<WeakHypothesisType> > >
 class Adaboost {
-    //TODO implement means to allow different weak learner boosting strategies: reweighting and resampling
     //TODO Store errors and historic data gathered through the iterations
-    //TODO devise means to implement some flexible stop criteria
 
 protected:
     /** Its methods will be invoked to report the algorithm progress */
@@ -38,32 +60,413 @@ protected:
 
 
 
+    /**
+     * If true, the value of every feature for every sample is computed once, before the
+     * first boosting round, and reused by the weak learner in every round.
+     */
+    bool precomputeFeatureValues;
+
+
+
+    /**
+     * If true, the samples are sorted by each feature value once, before the first boosting
+     * round, so the weak learner does not sort them again every round. Implies precomputeFeatureValues.
+     */
+    bool presortSamples;
+
+
+
+    /**
+     * If not empty, precomputed feature values are kept in this file and memory-mapped
+     * instead of being held in memory.
+     */
+    std::string featureValueCacheFile;
+
+
+
+    /**
+     * If not zero, each boosting round trains the weak learner on this many samples drawn
+     * from the weight distribution (boosting by resampling) instead of on the whole training set.
+     */
+    unsigned int resamplingSize;
+
+
+
+    /**
+     * Seeds the draws of boosting by resampling.
+     */
+    boost::uint32_t resamplingSeed;
+
+
+
+    /**
+     * If greater than zero, each boosting round trains the weak learner only on the heaviest
+     * samples that hold 1 - weightTrimming of the total weight (Friedman, Hastie and Tibshirani 2000).
+     */
+    weight_type weightTrimming;
+
+
+
+    /**
+     * The fraction of the features the weak learner evaluates each boosting round.
+     */
+    float featureFraction;
+
+
+
+    /**
+     * How many of the best features of a round are evaluated again in the next one, when
+     * featureFraction is less than 1.
+     */
+    unsigned int featuresKept;
+
+
+
+    /**
+     * Seeds the choice of features each round.
+     */
+    boost::uint32_t featureSamplingSeed;
+
+
+
+    /**
+     * If not empty, the training state is saved to this file every checkpointInterval rounds.
+     */
+    std::string checkpointFile;
+
+
+
+    /**
+     * How many boosting rounds between checkpoints.
+     */
+    unsigned int checkpointInterval;
+
+
+
+    /**
+     * If true, train() resumes from checkpointFile, when there is one.
+     */
+    bool resume;
+
+
+
+    /**
+     * If not null, asked after each round whether to stop boosting.
+     */
+    StopCriterion<WeakHypothesisType> * stopCriterion;
+
+
+
+    /**
+     * Sums the weights of the samples the selected weak hypothesis misclassifies.
+     * A tbb::parallel_deterministic_reduce body, so the sum does not change between runs.
+     */
+    struct WeightedError
+    {
+        const CorrectnessVector & correct;
+        const WeightVector      & weight_distribution;
+        weight_type               sum;
+
+        WeightedError(const CorrectnessVector & correct_,
+                      const WeightVector      & weight_distribution_) : correct(correct_),
+                                                                        weight_distribution(weight_distribution_),
+                                                                        sum(0) {}
+
+        WeightedError(WeightedError & e, tbb::split) : correct(e.correct),
+                                                       weight_distribution(e.weight_distribution),
+                                                       sum(0) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range)
+        {
+            weight_type partial = sum;
+            for (unsigned int i = range.begin(); i < range.end(); ++i)
+            {
+                partial += correct[i] ? 0 : weight_distribution[i];
+            }
+            sum = partial;
+        }
+
+        void join(const WeightedError & e)
+        {
+            sum += e.sum;
+        }
+    };
+
+
+
+    /**
+     * Multiplies each weight by one of two factors, depending on whether the selected weak
+     * hypothesis classified its sample correctly, and sums the new weights.
+     * A tbb::parallel_deterministic_reduce body, so the sum does not change between runs.
+     */
+    struct MultiplyWeights
+    {
+        const CorrectnessVector & correct;
+        WeightVector            & weight_distribution;
+        const weight_type       * const multipliers; //indexed by correctness: [0] incorrect, [1] correct
+        weight_type               sum;
+
+        MultiplyWeights(const CorrectnessVector & correct_,
+                        WeightVector            & weight_distribution_,
+                        const weight_type       * const multipliers_) : correct(correct_),
+                                                                        weight_distribution(weight_distribution_),
+                                                                        multipliers(multipliers_),
+                                                                        sum(0) {}
+
+        MultiplyWeights(MultiplyWeights & m, tbb::split) : correct(m.correct),
+                                                           weight_distribution(m.weight_distribution),
+                                                           multipliers(m.multipliers),
+                                                           sum(0) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range)
+        {
+            weight_type partial = sum;
+            for (unsigned int i = range.begin(); i < range.end(); ++i)
+            {
+                weight_distribution[i] *= multipliers[ correct[i] ];
+                partial += weight_distribution[i];
+            }
+            sum = partial;
+        }
+
+        void join(const MultiplyWeights & m)
+        {
+            sum += m.sum;
+        }
+    };
+
+
+
+    /**
+     * Multiplies every weight by a factor.
+     */
+    struct ScaleWeights
+    {
+        WeightVector & weight_distribution;
+        const weight_type factor;
+
+        ScaleWeights(WeightVector & weight_distribution_, const weight_type factor_) : weight_distribution(weight_distribution_),
+                                                                                       factor(factor_) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range) const
+        {
+            for (unsigned int i = range.begin(); i < range.end(); ++i)
+            {
+                weight_distribution[i] *= factor;
+            }
+        }
+    };
+
+
+
+    /**
+     * Computes the margin of each sample under the strong hypothesis: the sum of the alphas of
+     * the weak hypothesis that classify it correctly minus the sum of the others. Also finds the
+     * lowest margin.
+     */
+    struct Margins
+    {
+        const StrongHypothesis<WeakHypothesisType> & strong_hypothesis;
+        const std::vector<const LabeledExample *> & samples;
+        WeightVector & margins;
+        weight_type lowest;
+
+        Margins(const StrongHypothesis<WeakHypothesisType> & strong_hypothesis_,
+                const std::vector<const LabeledExample *> & samples_,
+                WeightVector & margins_) : strong_hypothesis(strong_hypothesis_),
+                                           samples(samples_),
+                                           margins(margins_),
+                                           lowest(std::numeric_limits<weight_type>::max()) {}
+
+        Margins(Margins & m, tbb::split) : strong_hypothesis(m.strong_hypothesis),
+                                           samples(m.samples),
+                                           margins(m.margins),
+                                           lowest(std::numeric_limits<weight_type>::max()) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range)
+        {
+            for (unsigned int i = range.begin(); i < range.end(); ++i)
+            {
+                weight_type margin = 0;
+                for (std::size_t k = 0; k < strong_hypothesis.size(); ++k)
+                {
+                    const bool correct = strong_hypothesis.weakHypothesis(k).classify(*samples[i]) == samples[i]->getLabel();
+                    margin += correct ? strong_hypothesis.alpha(k) : -strong_hypothesis.alpha(k);
+                }
+                margins[i] = margin;
+                lowest = std::min(lowest, margin);
+            }
+        }
+
+        void join(const Margins & m)
+        {
+            lowest = std::min(lowest, m.lowest);
+        }
+    };
+
+
+
+    /**
+     * Multiplies each weight by exp(lowest - margin), which is at most 1, and sums the new weights.
+     * A tbb::parallel_deterministic_reduce body, so the sum does not change between runs.
+     */
+    struct ExponentialWeights
+    {
+        const WeightVector & margins;
+        const weight_type    lowest;
+        WeightVector       & weight_distribution;
+        weight_type          sum;
+
+        ExponentialWeights(const WeightVector & margins_,
+                           const weight_type    lowest_,
+                           WeightVector       & weight_distribution_) : margins(margins_),
+                                                                        lowest(lowest_),
+                                                                        weight_distribution(weight_distribution_),
+                                                                        sum(0) {}
+
+        ExponentialWeights(ExponentialWeights & e, tbb::split) : margins(e.margins),
+                                                                 lowest(e.lowest),
+                                                                 weight_distribution(e.weight_distribution),
+                                                                 sum(0) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range)
+        {
+            weight_type partial = sum;
+            for (unsigned int i = range.begin(); i < range.end(); ++i)
+            {
+                weight_distribution[i] *= std::exp(lowest - margins[i]);
+                partial += weight_distribution[i];
+            }
+            sum = partial;
+        }
+
+        void join(const ExponentialWeights & e)
+        {
+            sum += e.sum;
+        }
+    };
+
+
+
+    /** Samples per task of the weight update. */
+    static const unsigned int WEIGHT_UPDATE_GRAIN = 4096;
+
+
+
     /**
      * Returns the normalization factor so it can be displayed to the user.
+     * @param correct which samples the selected weak hypothesis classified correctly.
      */
-    weight_type updateWeightDistribution( const std::vector<const LabeledExample *> & allSamples,
+    weight_type updateWeightDistribution( const CorrectnessVector & correct,
                                           const weight_type alpha,
-                                          const WeakHypothesisType & selected_hypothesis,
                                           WeightVector & weight_distribution )
     {
-        weight_type normalizationFactor = 0;
+        //This is the original Adaboost weight update, exp(-alpha * y * h(x)), where y * h(x) is either 1 or -1.
+        //Viola and Jones report a slightly different equation, but their starting weights are a little different too.
+        const weight_type multipliers[2] = { std::exp(alpha), std::exp(-alpha) };
 
-        for( WeightVector::size_type i = 0; i < allSamples.size(); ++i )
-        {
-            const Classification c = selected_hypothesis.classify( *(allSamples[i]) );
+        MultiplyWeights multiply(correct, weight_distribution, multipliers);
+        tbb::parallel_deterministic_reduce( tbb::blocked_range< unsigned int >(0, weight_distribution.size(), WEIGHT_UPDATE_GRAIN),
+                                            multiply );
+        const weight_type normalizationFactor = multiply.sum;
+
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, weight_distribution.size(), WEIGHT_UPDATE_GRAIN),
+                           ScaleWeights(weight_distribution, 1.0f / normalizationFactor) );
+
+        return normalizationFactor;
+    }
+
+
+
+    /**
+     * Warm start: sets the weights the starting weights would have after boosting the rounds of
+     * the entries of strong_hypothesis. Each weight is multiplied by exp(-margin), the product of
+     * the updates of all those rounds, in one pass over the samples; the normalizations of the
+     * rounds only scale all weights alike, so a single one at the end does the same.
+     */
+    void replayStrongHypothesis(const StrongHypothesis<WeakHypothesisType> & strong_hypothesis,
+                                const std::vector<const LabeledExample *> & samples,
+                                WeightVector & weight_distribution) const
+    {
+        WeightVector margins(samples.size());
+        Margins margin(strong_hypothesis, samples, margins);
+        tbb::parallel_reduce( tbb::blocked_range< unsigned int >(0, samples.size()),
+                              margin );
+
+        //Shifting the exponents by the lowest margin keeps the products from overflowing
+        ExponentialWeights exponential(margins, margin.lowest, weight_distribution);
+        tbb::parallel_deterministic_reduce( tbb::blocked_range< unsigned int >(0, weight_distribution.size(), WEIGHT_UPDATE_GRAIN),
+                                            exponential );
+
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, weight_distribution.size(), WEIGHT_UPDATE_GRAIN),
+                           ScaleWeights(weight_distribution, 1.0f / exponential.sum) );
+    }
 
-            //This is the original Adaboost weight update. Viola and Jones report a slightly different equation,
-            //but their starting weights are a little different too.
-            weight_distribution[i] = weight_distribution[i] * std::exp(-alpha * (allSamples[i]->getLabel()) * c);
-            normalizationFactor += weight_distribution[i];
+
+
+    /**
+     * Selects the heaviest samples that, together, hold at least 1 - weightTrimming of the total
+     * weight. Samples as heavy as the lightest one selected are selected too.
+     *
+     * The lightest weight selected is found without sorting the weights: std::nth_element
+     * halves the range it may be in, and the weights heavier than that range are summed as it
+     * shrinks, so finding it takes linear time on average.
+     * @param ranked a buffer for the weights, which are reordered there.
+     * @param active output parameter. The indexes of the selected samples, in increasing order.
+     * @param active_weights output parameter. Their weights.
+     */
+    void trimWeights(const WeightVector & weight_distribution,
+                     WeightVector & ranked,
+                     std::vector<unsigned int> & active,
+                     WeightVector & active_weights) const
+    {
+        ranked.assign(weight_distribution.begin(), weight_distribution.end());
+
+        weight_type total = 0;
+        for (WeightVector::const_iterator it = ranked.begin(); it != ranked.end(); ++it)
+        {
+            total += *it;
         }
 
-        std::transform(weight_distribution.begin(), weight_distribution.end(),
-                       weight_distribution.begin(),
-                       std::bind2nd(std::divides<weight_type>(), normalizationFactor)); //bind2nd makes normalizationFactor the divisor.
-                                                                                        //see also bind1st.
+        //The lightest weight still needed to reach the kept mass is the heaviest but k-th one, for
+        //some k in [first, last). heavier is the sum of the first heaviest ones.
+        const weight_type kept = (1.0f - weightTrimming) * total;
+        weight_type heavier = 0;
+        WeightVector::iterator first = ranked.begin();
+        WeightVector::iterator last = ranked.end();
+        while (last - first > 1)
+        {
+            const WeightVector::iterator middle = first + (last - first) / 2;
+            std::nth_element(first, middle, last, std::greater<weight_type>());
 
-        return normalizationFactor;
+            weight_type sum = heavier;
+            for (WeightVector::const_iterator it = first; it != middle; ++it)
+            {
+                sum += *it;
+            }
+
+            if (sum < kept)
+            {
+                heavier = sum;
+                first = middle;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+        const weight_type cutoff = *first;
+
+        active.clear();
+        active_weights.clear();
+        for (WeightVector::size_type i = 0; i < weight_distribution.size(); ++i)
+        {
+            if (weight_distribution[i] >= cutoff)
+            {
+                active.push_back(i);
+                active_weights.push_back(weight_distribution[i]);
+            }
+        }
     }
 
 
@@ -73,7 +476,7 @@ protected:
      */
     struct ToPointer
     {
-        inline LabeledExample * operator()(LabeledExample & ex) const
+        inline const LabeledExample * operator()(const LabeledExample & ex) const
         {
             return &ex;
         }
@@ -83,10 +486,36 @@ protected:
 
 public:
     Adaboost() : progressCallback(new SimpleProgressCallback()),
-                 weak_learner_mutex() {}
+                 weak_learner_mutex(),
+                 precomputeFeatureValues(false),
+                 presortSamples(false),
+                 featureValueCacheFile(),
+                 resamplingSize(0),
+                 resamplingSeed(0),
+                 weightTrimming(0),
+                 featureFraction(1.0f),
+                 featuresKept(0),
+                 featureSamplingSeed(0),
+                 checkpointFile(),
+                 checkpointInterval(1),
+                 resume(false),
+                 stopCriterion(0) {}
 
     Adaboost(ProgressCallback * progressCallback_) : progressCallback(progressCallback_),
-                                                     weak_learner_mutex() {}
+                                                     weak_learner_mutex(),
+                                                     precomputeFeatureValues(false),
+                                                     presortSamples(false),
+                                                     featureValueCacheFile(),
+                                                     resamplingSize(0),
+                                                     resamplingSeed(0),
+                                                     weightTrimming(0),
+                                                     featureFraction(1.0f),
+                                                     featuresKept(0),
+                                                     featureSamplingSeed(0),
+                                                     checkpointFile(),
+                                                     checkpointInterval(1),
+                                                     resume(false),
+                                                     stopCriterion(0) {}
 
     ~Adaboost() {
         if ( !progressCallback )
@@ -96,8 +525,147 @@ public:
     }
 
     /**
+     * Trades memory for speed: when set, train() evaluates the full feature x sample matrix
+     * once instead of once per boosting round. The matrix takes
+     * hypothesis.size() * samples * sizeof(feature_value_type) bytes.
+     */
+    void setPrecomputeFeatureValues(const bool precompute)
+    {
+        precomputeFeatureValues = precompute;
+    }
+
+
+
+    /**
+     * When set, train() keeps a sorted sample permutation for each feature, so each boosting
+     * round is a linear scan instead of a sort. Feature values are precomputed too, and the
+     * permutation takes as much memory as them.
+     */
+    void setPresortSamples(const bool presort)
+    {
+        presortSamples = presort;
+    }
+
+
+
+    /**
+     * Keeps the precomputed feature values in a disk-backed cache file instead of memory, for
+     * sample sets whose feature x sample matrix does not fit in RAM. The file is written once,
+     * then memory-mapped read-only; a later run with the same wavelets and samples maps the
+     * existing file instead of computing it again. Implies precomputed feature values.
+     */
+    void setFeatureValueCacheFile(const std::string & path)
+    {
+        featureValueCacheFile = path;
+    }
+
+
+
+    /**
+     * Boosting by resampling: each round draws size samples from the weight distribution, with
+     * replacement, through an alias table (see weightedresampler.h), and trains the weak learner
+     * only on them. The weak hypothesis selected this way gets its weighted error, and so its
+     * alpha, from the whole training set. Trades a little accuracy for much faster rounds when
+     * size is much smaller than the training set. Draws only depend on seed and the round,
+     * not on the amount of threads. A size of zero trains on the whole training set.
+     */
+    void setResampling(const unsigned int size, const boost::uint32_t seed = 0)
+    {
+        resamplingSize = size;
+        resamplingSeed = seed;
+    }
+
+
+
+    /**
+     * Weight trimming: each round trains the weak learner only on the heaviest samples holding
+     * 1 - beta of the total weight, which after a few rounds are a small fraction of them. All
+     * samples still have their weights updated, and the selected weak hypothesis gets its
+     * weighted error, and so its alpha, from the whole training set. The amount of samples
+     * trained on is reported to the ProgressCallback every round. Typical values of beta are
+     * 0.01 to 0.1; zero trains on all samples. Has no effect when resampling, which already
+     * draws the heaviest samples most often.
+     */
+    void setWeightTrimming(const weight_type beta)
+    {
+        weightTrimming = beta;
+    }
+
+
+
+    /**
+     * Random feature sampling: each round the weak learner only evaluates a random fraction of
+     * the features, plus the keep features that had the lowest weighted errors last round (at
+     * most WeakLearnerBody::RANKED). Rounds get nearly fraction times faster; since good
+     * features stay in the pool for as long as they remain among the best, little accuracy is
+     * lost. The features of each round only depend on seed and the round. A fraction of 1
+     * evaluates all features.
+     */
+    void setFeatureSampling(const float fraction, const unsigned int keep = 0, const boost::uint32_t seed = 0)
+    {
+        featureFraction = fraction;
+        featuresKept = keep < WeakLearnerBody::RANKED ? keep : WeakLearnerBody::RANKED;
+        featureSamplingSeed = seed;
+    }
+
+
+
+    /**
+     * Saves the training state to path every interval boosting rounds (see checkpoint.h), replacing
+     * the previous checkpoint atomically, so that a long training run that is interrupted can be
+     * resumed (see setResume()). A failure to write a checkpoint is reported, and training goes on.
+     */
+    void setCheckpoint(const std::string & path, const unsigned int interval = 1)
+    {
+        checkpointFile = path;
+        checkpointInterval = interval ? interval : 1;
+    }
+
+
+
+    /**
+     * When set, train() restores the weights, the round and the strong hypothesis from the
+     * checkpoint file before boosting, then boosts the remaining rounds. The same samples,
+     * features and options of the interrupted run must be given. Feature values are mapped from
+     * the cache file again (see setFeatureValueCacheFile()), if there is one. Since resampling
+     * and feature sampling only depend on their seeds and on the round, a resumed run selects
+     * the same weak hypothesis the interrupted one would have. Without a checkpoint file,
+     * training starts from the first round.
      *
-     * @return true if reached maximum_iterations when returning, of false otherwise.
+     * The checkpoint is only used if it holds the entries strong_hypothesis already has (see
+     * TrainingCheckpoint::follows()). Otherwise, such as when the journal recovered rounds
+     * boosted after the last checkpoint, those entries are replayed as a warm start does
+     * (see replayStrongHypothesis()), and the features kept by feature sampling are lost.
+     */
+    void setResume(const bool resume_)
+    {
+        resume = resume_;
+    }
+
+
+
+    /**
+     * Boosting stops early when criterion, asked after each round, says so. The criterion is not
+     * owned by Adaboost. Null boosts all rounds.
+     */
+    void setStopCriterion(StopCriterion<WeakHypothesisType> * criterion)
+    {
+        stopCriterion = criterion;
+    }
+
+
+
+    /**
+     * Boosts until strong_hypothesis has maximum_iterations entries, or the stop criterion is met. If strong_hypothesis
+     * already has entries, such as those of a model trained before on the same samples, the
+     * weights are first set as if their rounds had just been boosted (see
+     * replayStrongHypothesis()), and boosting continues from there.
+     *
+     * The samples are copied to a SampleStore, so while training they take memory twice, once
+     * as given and once packed. Callers that need the samples only to train load them into a
+     * store and call the other train().
+     *
+     * @return false if boosting stopped because alpha was infinity or not a number, or true otherwise.
      */
     bool train(std::vector<LabeledExample> positiveSamples,
                std::vector<LabeledExample> negativeSamples,
@@ -105,9 +673,6 @@ public:
                std::vector <WeakHypothesisType> & hypothesis,
                const unsigned int maximum_iterations)
     {
-        unsigned int t = 0;
-
-
         //allSamples collects pointers to both positive and negative LabeledExamples
         std::vector<const LabeledExample *> allSamples(positiveSamples.size() + negativeSamples.size());
         std::transform(positiveSamples.begin(), positiveSamples.end(),
@@ -117,40 +682,202 @@ public:
                        allSamples.begin() + positiveSamples.size(),
                        ToPointer());
 
+        SampleStore samples;
+        samples.assign<typename WeakHypothesisType::integrals_type>(allSamples, WeakHypothesisType::needs_integral_square);
+
+        return train(samples, strong_hypothesis, hypothesis, maximum_iterations);
+    }
+
+
+
+    /**
+     * Same as the other train(), over samples already packed for WeakHypothesisType::integrals_type,
+     * such as samples loaded straight into the store (see SampleStore). The positive samples
+     * get half of the initial weight, and the negative ones the other half, wherever they are
+     * in the store. The store must outlive training.
+     */
+    bool train(const SampleStore & samples,
+               StrongHypothesis<WeakHypothesisType> & strong_hypothesis,
+               std::vector <WeakHypothesisType> & hypothesis,
+               const unsigned int maximum_iterations)
+    {
+        unsigned int t = 0;
+
+
+        //Feature evaluation walks all samples over and over: their integral images are contiguous,
+        //in the representation the weak hypothesis read
+        TrainingData trainingData;
+        std::vector<const LabeledExample *> & allSamples = trainingData.allSamples;
+        samples.pointers(allSamples);
+
 
         //Vector weight_distribution holds the weights of each data sample.
+        std::size_t positives = 0;
+        for (std::size_t i = 0; i < allSamples.size(); ++i)
+        {
+            positives += allSamples[i]->getLabel() == yes;
+        }
         WeightVector weight_distribution(allSamples.size());
-        std::fill(weight_distribution.begin(),  weight_distribution.begin() + positiveSamples.size(),
-                  0.5f / positiveSamples.size());
-        std::fill(weight_distribution.begin() + positiveSamples.size(), weight_distribution.end(),
-                  0.5f / negativeSamples.size());
+        for (std::size_t i = 0; i < allSamples.size(); ++i)
+        {
+            weight_distribution[i] = allSamples[i]->getLabel() == yes ? 0.5f / positives
+                                                                      : 0.5f / (allSamples.size() - positives);
+        }
 
 
-        do {//Main Adaboost loop
-            if(progressCallback)
+        //Feature values and the samples order only depend on the samples and on the features, so they may be computed only once.
+        //They are not built for weak learners that would not read them.
+        if ( WeakLearnerType::reads_feature_values && !featureValueCacheFile.empty() )
+        {
+            if ( !trainingData.featureValues.computeOrMap(hypothesis, allSamples, featureValueCacheFile) )
             {
-                progressCallback->beginAdaboostIteration(t);
+                throw 227;
             }
+        }
+        else if ( WeakLearnerType::reads_feature_values && (precomputeFeatureValues || (presortSamples && WeakLearnerType::reads_sorted_samples)) )
+        {
+            trainingData.featureValues.compute(hypothesis, allSamples);
+        }
+        if (presortSamples && WeakLearnerType::reads_sorted_samples)
+        {
+            trainingData.sortedSamples.compute(trainingData.featureValues);
+        }
+        WeakLearnerType::prepare(trainingData, hypothesis);
+
+        //Which samples the weak hypothesis selected each round classifies correctly
+        CorrectnessVector correct(allSamples.size());
+
+        //When resampling or trimming weights, the weak learner trains on a subset of trainingData (see TrainingData::subset).
+        //Resampled samples are weighted by how many times they were drawn; trimmed ones keep their weights.
+        WeightedResampler resampler(resamplingSeed);
+        std::vector<unsigned int> subset;
+        WeightVector subset_weights;
+        WeightVector ranked_weights;
+
+        //When sampling features, those near the best last round are evaluated again
+        const bool sampleFeatures = featureFraction < 1.0f;
+        FeatureSampler featureSampler(featureFraction, featureSamplingSeed);
+        std::vector<unsigned int> nearBest;
+
+        //Entries already in the strong hypothesis come from an earlier training, which this one continues
+        const unsigned int warm = strong_hypothesis.size();
+
+        //The strong hypothesis entries, serialized as they are selected, and the state of the last round
+        TrainingCheckpoint checkpoint;
+        const bool resuming = resume && !checkpointFile.empty() && checkpoint.read(checkpointFile);
+        if ( resuming && ( checkpoint.weights.size() != weight_distribution.size()
+                           || checkpoint.features != hypothesis.size() ) )
+        {
+            throw 229;
+        }
+
+        //After a crash, the journal may hold rounds boosted after the last checkpoint: those are replayed instead
+        if ( resuming && checkpoint.follows(strong_hypothesis) )
+        {
+            t = checkpoint.round;
+            weight_distribution = checkpoint.weights;
+            nearBest = checkpoint.nearBest;
+            for (std::vector<std::string>::size_type k = warm; k < checkpoint.weakHypothesis.size(); ++k)
+            {
+                std::istringstream in(checkpoint.weakHypothesis[k]);
+                WeakHypothesisType weak_hypothesis;
+                if ( !weak_hypothesis.read(in) )
+                {
+                    throw 229;
+                }
+                strong_hypothesis.insert(checkpoint.alphas[k], weak_hypothesis);
+            }
+
+            std::cout << "Resuming training from round " << t << " of checkpoint " << checkpointFile << '.' << std::endl;
+        }
+        else if (warm)
+        {
+            replayStrongHypothesis(strong_hypothesis, allSamples, weight_distribution);
+            t = warm;
+            checkpoint = TrainingCheckpoint();
+            for (unsigned int k = 0; k < warm && !checkpointFile.empty(); ++k)
+            {
+                checkpoint.alphas.push_back( strong_hypothesis.alpha(k) );
+                checkpoint.weakHypothesis.push_back( TrainingCheckpoint::entry(strong_hypothesis.weakHypothesis(k)) );
+            }
+
+            if (resuming)
+            {
+                std::cout << "Checkpoint " << checkpointFile << " does not hold the " << warm << " classifiers loaded: "
+                             "their rounds are replayed instead." << std::endl;
+            }
+            std::cout << "Continuing training from round " << t << " by replaying the classifiers loaded." << std::endl;
+        }
+        checkpoint.features = hypothesis.size();
 
-            //Holds the weighted error of the best weak classifier selected this boosting round. The weak lerner sets it.
-            weight_type weighted_error = std::numeric_limits<weight_type>::max();
 
-            //Holds the index of the best weak hypothesis. The weak lerner sets it.
-            unsigned int weak_hypothesis_index = 0;
+        while (t < maximum_iterations) {//Main Adaboost loop
+            if(progressCallback)
+            {
+                progressCallback->beginAdaboostIteration(t);
+            }
 
             //A progress counter
             unsigned long count = 0;
 
+            if (sampleFeatures)
+            {
+                featureSampler.sample(hypothesis.size(), t, nearBest, trainingData.features);
+            }
+
+            bool trainOnSubset = false;
+            if (resamplingSize)
+            {
+                resampler.resample(weight_distribution, resamplingSize, t, subset, subset_weights);
+                trainOnSubset = true;
+            }
+            else if (weightTrimming > 0)
+            {
+                trimWeights(weight_distribution, ranked_weights, subset, subset_weights);
+                trainOnSubset = subset.size() < allSamples.size();
+                if (progressCallback)
+                {
+                    progressCallback->activeSamples(subset.size(), allSamples.size());
+                }
+            }
+            trainingData.selectSubset(trainOnSubset ? subset : std::vector<unsigned int>());
+
             //Train weak learner and get weak hypothesis so that it "minimalizes" the weighted error.
-            tbb::parallel_for( tbb::blocked_range< unsigned int >(0, hypothesis.size()),
-                               WeakLearnerType(weak_learner_mutex,
-                                               allSamples,
-                                               weight_distribution,
-                                               hypothesis,
-                                               weighted_error,
-                                               weak_hypothesis_index,
-                                               count,
-                                               progressCallback) );
+            WeakLearnerType weakLearner(weak_learner_mutex,
+                                        trainingData,
+                                        trainOnSubset ? subset_weights : weight_distribution,
+                                        hypothesis,
+                                        count,
+                                        progressCallback);
+            tbb::parallel_reduce( tbb::blocked_range< unsigned int >(0, sampleFeatures ? trainingData.features.size() : hypothesis.size()),
+                                  weakLearner );
+
+            if (sampleFeatures)
+            {
+                weakLearner.ranking(nearBest);
+                nearBest.resize( std::min<std::size_t>(nearBest.size(), featuresKept) );
+            }
+
+            //The index of the best weak classifier selected this boosting round and its weighted error.
+            const unsigned int weak_hypothesis_index = weakLearner.selectedIndex();
+            WeakLearnerType::markCorrect(trainingData, hypothesis, weak_hypothesis_index, correct);
+
+            weight_type weighted_error = weakLearner.weightedError();
+            if (trainOnSubset)
+            {
+                WeightedError error(correct, weight_distribution);
+                tbb::parallel_deterministic_reduce( tbb::blocked_range< unsigned int >(0, weight_distribution.size(), WEIGHT_UPDATE_GRAIN),
+                                                    error );
+                weighted_error = error.sum;
+            }
+
+            //Let the weak learner report on its selection before the weights change
+            WeakLearnerType::selected(trainingData,
+                                      weight_distribution,
+                                      hypothesis,
+                                      weak_hypothesis_index,
+                                      weighted_error,
+                                      progressCallback);
 
             //Set alpha for this iteration
             const weight_type alpha = 0.5f * std::log( (1.0f - weighted_error) / weighted_error );
@@ -162,11 +889,7 @@ public:
 
             //Now we just have to update the weight distribution of the samples.
             //Normalization factor is not inside the block because we report it to the progressCallback.
-            const weight_type normalizationFactor =
-                    updateWeightDistribution( allSamples,
-                                              alpha,
-                                              hypothesis[weak_hypothesis_index],
-                                              weight_distribution );
+            const weight_type normalizationFactor = updateWeightDistribution( correct, alpha, weight_distribution );
 
             if (progressCallback)
             {
@@ -181,7 +904,29 @@ public:
             strong_hypothesis.insert(alpha, hypothesis[weak_hypothesis_index]);
 
             t++; //next training iteration
-        } while (t < maximum_iterations);
+
+            if ( !checkpointFile.empty() )
+            {
+                checkpoint.alphas.push_back(alpha);
+                checkpoint.weakHypothesis.push_back( TrainingCheckpoint::entry(hypothesis[weak_hypothesis_index]) );
+
+                if (t % checkpointInterval == 0 || t == maximum_iterations)
+                {
+                    checkpoint.round = t;
+                    checkpoint.weights = weight_distribution;
+                    checkpoint.nearBest = nearBest;
+                    if ( !checkpoint.write(checkpointFile) )
+                    {
+                        std::cout << "Could not write checkpoint " << checkpointFile << ". Training goes on." << std::endl;
+                    }
+                }
+            }
+
+            if ( stopCriterion && stopCriterion->stop(strong_hypothesis) )
+            {
+                break;
+            }
+        }
 
         return true;
     }
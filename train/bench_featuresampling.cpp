@@ -0,0 +1,230 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "integralimage.h"
+#include "stronghypothesis.h"
+#include "weaklearner.h"
+#include "adaboost.h"
+
+
+
+/**
+ * The feature values of every sample, feature-major. Samples find their values through an
+ * identifier kept in their integral sum.
+ */
+std::vector< std::vector<feature_value_type> > benchmarkValues;
+
+
+
+/**
+ * A decision stump over benchmarkValues.
+ */
+class BenchmarkStump
+{
+public:
+    typedef DoubleIntegrals integrals_type;
+    static const bool needs_integral_square = false;
+
+    BenchmarkStump(const unsigned int feature_ = 0) : feature(feature_), theta(0), p(1) {}
+
+    float featureValue(const Example & example, const float = 1.0f) const
+    {
+        return benchmarkValues[feature][ (std::size_t)example.getIntegralSum().at<double>(0, 0) ];
+    }
+
+    Classification classifyFeatureValue(const feature_value_type value) const
+    {
+        return value * p <= theta * p ? yes : no;
+    }
+
+    Classification classify(const Example & example, const float scale = 1.0f) const
+    {
+        return classifyFeatureValue( featureValue(example, scale) );
+    }
+
+    void setThreshold(const float theta_)
+    {
+        theta = theta_;
+    }
+
+    void setPolarity(const float p_)
+    {
+        p = p_;
+    }
+
+    bool write(std::ostream & out) const
+    {
+        out << feature << ' ' << p << ' ' << theta;
+        return true;
+    }
+
+    bool read(std::istream & in)
+    {
+        in >> feature >> p >> theta;
+        return !in.fail();
+    }
+
+private:
+    unsigned int feature;
+    float theta;
+    float p;
+};
+
+
+
+/**
+ * Measures how long boosting rounds take, from the first round on, so that precomputing and
+ * sorting feature values are not counted.
+ */
+struct TimingCallback : public ProgressCallback
+{
+    tbb::tick_count first;
+    tbb::tick_count last;
+
+    void beginAdaboostIteration(const unsigned int iteration)
+    {
+        if (iteration == 0)
+        {
+            first = tbb::tick_count::now();
+        }
+    }
+
+    void tick(const unsigned long, const unsigned long) {}
+
+    void classifierSelected(const weight_type, const weight_type, const weight_type, const unsigned int)
+    {
+        last = tbb::tick_count::now();
+    }
+
+    void approximateSelection(const weight_type, const weight_type) {}
+
+    void activeSamples(const unsigned int, const unsigned int) {}
+};
+
+
+
+/**
+ * How many samples a strong hypothesis misclassifies.
+ */
+unsigned int misclassified(const StrongHypothesis<BenchmarkStump> & strongHypothesis, const std::vector<LabeledExample> & samples)
+{
+    unsigned int errors = 0;
+    for (std::vector<LabeledExample>::const_iterator it = samples.begin(); it != samples.end(); ++it)
+    {
+        errors += strongHypothesis.classify(*it) != it->getLabel();
+    }
+    return errors;
+}
+
+
+
+/**
+ * Makes a sample whose integral sum identifies it in benchmarkValues.
+ */
+LabeledExample makeSample(const unsigned int id, const Classification label)
+{
+    cv::Mat sum = cv::Mat::zeros(2, 2, cv::DataType<double>::type);
+    sum.at<double>(0, 0) = id;
+    return LabeledExample(sum, cv::Mat(), label);
+}
+
+
+
+/**
+ * Shows the tradeoff of random feature sampling: how much faster boosting rounds get and how
+ * much the training and test errors of the strong hypothesis change, for several fractions
+ * of the feature pool, with and without keeping the best features of the previous round.
+ *
+ * Arguments:
+ *     [features (default 2000)]
+ *     [samples, both for training and for testing (default 4000)]
+ *     [rounds (default 30)]
+ */
+int main(int argc, char **argv) {
+    const unsigned int features = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const unsigned int samples = argc > 2 ? std::atoi(argv[2]) : 4000;
+    const unsigned int rounds = argc > 3 ? std::atoi(argv[3]) : 30;
+    const unsigned int kept = 8;
+
+    //A quarter of the samples are positive. Few features separate them well, as in wavelet pools.
+    boost::random::mt19937 rng(137);
+    boost::random::normal_distribution<feature_value_type> normal;
+    boost::random::uniform_01<feature_value_type> uniform;
+
+    std::vector<LabeledExample> positives, negatives, test;
+    std::vector<Classification> labels(2 * samples);
+    for (unsigned int i = 0; i < 2 * samples; ++i)
+    {
+        labels[i] = i % 4 ? no : yes;
+        LabeledExample sample = makeSample(i, labels[i]);
+        if (i >= samples)
+        {
+            test.push_back(sample);
+        }
+        else
+        {
+            (labels[i] == yes ? positives : negatives).push_back(sample);
+        }
+    }
+
+    benchmarkValues.assign(features, std::vector<feature_value_type>(2 * samples));
+    for (unsigned int j = 0; j < features; ++j)
+    {
+        const feature_value_type signal = uniform(rng) < 0.02f ? 1.0f : 0.2f * uniform(rng);
+        for (unsigned int i = 0; i < 2 * samples; ++i)
+        {
+            benchmarkValues[j][i] = normal(rng) + (labels[i] == yes) * signal;
+        }
+    }
+
+    std::vector<BenchmarkStump> pool;
+    for (unsigned int j = 0; j < features; ++j)
+    {
+        pool.push_back( BenchmarkStump(j) );
+    }
+
+    std::cout << features << " features, " << samples << " training and " << samples << " test samples, " << rounds << " rounds\n";
+    std::cout << "fraction  kept  seconds/round  speedup  training error  test error\n";
+
+    const float fractions[] = {1.0f, 0.5f, 0.25f, 0.1f, 0.1f, 0.05f, 0.05f};
+    const unsigned int keeps[] = {0, kept, kept, kept, 0, kept, 0};
+    double all_features = 0;
+    for (std::size_t r = 0; r < sizeof(fractions) / sizeof(fractions[0]); ++r)
+    {
+        std::vector<BenchmarkStump> hypothesis(pool);
+        StrongHypothesis<BenchmarkStump> strongHypothesis;
+        TimingCallback timing;
+
+        Adaboost<BenchmarkStump, DecisionStumpWeakLearner<BenchmarkStump> > adaboost(&timing);
+        adaboost.setPresortSamples(true);
+        adaboost.setFeatureSampling(fractions[r], keeps[r], 1);
+        adaboost.train(positives, negatives, strongHypothesis, hypothesis, rounds);
+
+        const double seconds = (timing.last - timing.first).seconds() / rounds;
+        if (r == 0)
+        {
+            all_features = seconds;
+        }
+
+        std::cout << std::setw(8) << std::fixed << std::setprecision(2) << fractions[r]
+                  << std::setw(6) << keeps[r]
+                  << std::setw(15) << std::setprecision(4) << seconds
+                  << std::setw(9) << std::setprecision(2) << all_features / seconds
+                  << std::setw(16) << std::setprecision(4) << (double)(misclassified(strongHypothesis, positives) + misclassified(strongHypothesis, negatives)) / samples
+                  << std::setw(12) << (double)misclassified(strongHypothesis, test) / test.size() << '\n';
+    }
+
+    return 0;
+}
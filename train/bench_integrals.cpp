@@ -0,0 +1,214 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "samplestore.h"
+#include "integralimage.h"
+#include "integralevaluators.h"
+#include "weakhypothesis.h"
+#include "stronghypothesis.h"
+#include "weaklearner.h"
+#include "adaboost.h"
+
+
+
+/**
+ * Loads the first features wavelets of a pool, or all of them if features is 0.
+ */
+template<typename WeakHypothesisType>
+bool loadPool(const std::string & waveletsFile, const unsigned int features, std::vector<WeakHypothesisType> & hypothesis)
+{
+    if ( !loadHaarClassifiers(waveletsFile, hypothesis) || hypothesis.empty() )
+    {
+        return false;
+    }
+    if ( features > 0 && features < hypothesis.size() )
+    {
+        hypothesis.resize(features);
+    }
+    return true;
+}
+
+
+
+/**
+ * Evaluates every feature against every sample of a store.
+ */
+template<typename WeakHypothesisType>
+double evaluate(const std::vector<WeakHypothesisType> & hypothesis,
+                const SampleStore & store,
+                std::vector<feature_value_type> & values)
+{
+    values.resize(hypothesis.size() * store.size());
+
+    const tbb::tick_count start = tbb::tick_count::now();
+    for (std::size_t j = 0; j < hypothesis.size(); ++j)
+    {
+        for (std::size_t i = 0; i < store.size(); ++i)
+        {
+            values[j * store.size() + i] = hypothesis[j].featureValue(store[i]);
+        }
+    }
+    return (tbb::tick_count::now() - start).seconds();
+}
+
+
+
+/**
+ * Trains a few rounds and returns the serialized strong hypothesis.
+ */
+template<typename WeakHypothesisType>
+std::string train(const std::vector<LabeledExample> & positives,
+                  const std::vector<LabeledExample> & negatives,
+                  std::vector<WeakHypothesisType> & hypothesis,
+                  const unsigned int rounds)
+{
+    StrongHypothesis<WeakHypothesisType> strongHypothesis;
+    Adaboost<WeakHypothesisType, DecisionStumpWeakLearner<WeakHypothesisType> > adaboost(0);
+    adaboost.setPresortSamples(true);
+    adaboost.train(positives, negatives, strongHypothesis, hypothesis, rounds);
+
+    std::ostringstream out;
+    strongHypothesis.write(out);
+    return out.str();
+}
+
+
+
+/**
+ * Evaluates every feature of a pool against every sample, with the integrals of the samples
+ * stored as the weak hypothesis read them, and prints a row of the report.
+ */
+template<typename WeakHypothesisType>
+void evaluate(const char * name,
+              const std::vector<WeakHypothesisType> & hypothesis,
+              const std::vector<const LabeledExample *> & allSamples,
+              std::vector<feature_value_type> & values)
+{
+    typedef typename WeakHypothesisType::integrals_type integrals_type;
+
+    SampleStore store;
+    store.assign<integrals_type>(allSamples);
+    const double seconds = evaluate(hypothesis, store, values);
+
+    const std::size_t integralPixels = allSamples.empty() ? 0 : (std::size_t)allSamples[0]->getIntegralSum().rows * allSamples[0]->getIntegralSum().cols;
+    std::cout << std::setw(22) << name
+              << std::setw(14) << integralPixels * (sizeof(typename integrals_type::sum_type) + sizeof(typename integrals_type::square_type))
+              << std::setw(15) << std::fixed << std::setprecision(2) << seconds * 1e9 / values.size() << '\n';
+}
+
+
+
+/**
+ * How many values differ from the reference ones.
+ */
+unsigned int differences(const std::vector<feature_value_type> & reference, const std::vector<feature_value_type> & values)
+{
+    unsigned int different = 0;
+    for (std::size_t k = 0; k < reference.size(); ++k)
+    {
+        different += reference[k] != values[k];
+    }
+    return different;
+}
+
+
+
+/**
+ * Checks that 32 bit integer integral sums evaluate the same feature values as haarcommon's
+ * ViolaJonesClassifier, on real wavelets, and make Adaboost select the same features and
+ * thresholds. The in-tree evaluator over double integrals is checked the same way. Also
+ * reports the memory each sample takes and how fast features are evaluated. Returns 2 if any
+ * feature value differs from haarcommon's or Adaboost selects other features or thresholds.
+ * test/test_evaluators checks the same feature values on scanned windows as a ctest.
+ *
+ * Arguments:
+ *     waveletsFile
+ *     [samples (default 2000)]
+ *     [features, the first ones of the pool (default 0, all)]
+ *     [rounds (default 10)]
+ */
+int main(int argc, char **argv) {
+    if ( argc < 2 )
+    {
+        std::cout << "USAGE: " << argv[0] << " WAVELETS_FILE [SAMPLES] [FEATURES] [ROUNDS]" << std::endl;
+        return 1;
+    }
+    const std::string waveletsFile = argv[1];
+    const unsigned int samples = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const unsigned int features = argc > 3 ? std::atoi(argv[3]) : 0;
+    const unsigned int rounds = argc > 4 ? std::atoi(argv[4]) : 10;
+    const int size = 20;
+
+    std::vector<ViolaJonesClassifier> haarcommonHypothesis;
+    std::vector<ViolaJonesIntegralClassifier> doubleHypothesis;
+    std::vector<ViolaJonesInt32Classifier> int32Hypothesis;
+    if ( !loadPool(waveletsFile, features, haarcommonHypothesis)
+         || !loadPool(waveletsFile, features, doubleHypothesis)
+         || !loadPool(waveletsFile, features, int32Hypothesis) )
+    {
+        return 7;
+    }
+
+    boost::random::mt19937 rng(137);
+    boost::random::uniform_int_distribution<int> pixel(0, 255);
+
+    //Positive samples have a brighter upper half
+    std::vector<LabeledExample> positives, negatives;
+    std::vector<const LabeledExample *> allSamples;
+    for (unsigned int i = 0; i < samples; ++i)
+    {
+        const Classification label = i % 4 ? no : yes;
+        cv::Mat image(size, size, cv::DataType<unsigned char>::type);
+        for (int r = 0; r < size; ++r)
+        {
+            for (int c = 0; c < size; ++c)
+            {
+                image.at<unsigned char>(r, c) = std::min(255, pixel(rng) + (label == yes && r < size / 2) * 8);
+            }
+        }
+        (label == yes ? positives : negatives).push_back( LabeledExample(image, label) );
+    }
+    for (std::size_t i = 0; i < positives.size(); ++i)
+    {
+        allSamples.push_back(&positives[i]);
+    }
+    for (std::size_t i = 0; i < negatives.size(); ++i)
+    {
+        allSamples.push_back(&negatives[i]);
+    }
+
+    std::cout << samples << " samples, " << int32Hypothesis.size() << " features of " << waveletsFile << '\n';
+    std::cout << "             evaluator  bytes/sample  ns/evaluation\n";
+
+    //Feature values
+    std::vector<feature_value_type> haarcommonValues, doubleValues, int32Values;
+    evaluate("haarcommon",      haarcommonHypothesis, allSamples, haarcommonValues);
+    evaluate("in-tree, double", doubleHypothesis,     allSamples, doubleValues);
+    evaluate("in-tree, int32",  int32Hypothesis,      allSamples, int32Values);
+
+    const unsigned int differentDouble = differences(haarcommonValues, doubleValues);
+    const unsigned int differentInt32 = differences(haarcommonValues, int32Values);
+    std::cout << "Feature values that differ from haarcommon's: " << differentDouble << " in-tree double, "
+              << differentInt32 << " in-tree int32\n";
+
+    //Selected features and thresholds
+    const std::string reference = train(positives, negatives, haarcommonHypothesis, rounds);
+    const bool sameDouble = train(positives, negatives, doubleHypothesis, rounds) == reference;
+    const bool sameInt32 = train(positives, negatives, int32Hypothesis, rounds) == reference;
+    std::cout << "Same features and thresholds as haarcommon after " << rounds << " rounds: "
+              << (sameDouble ? "yes" : "no") << " in-tree double, " << (sameInt32 ? "yes" : "no") << " in-tree int32" << std::endl;
+
+    return differentDouble == 0 && differentInt32 == 0 && sameDouble && sameInt32 ? 0 : 2;
+}
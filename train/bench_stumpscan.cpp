@@ -0,0 +1,111 @@
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <tbb/tick_count.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+
+#include "common.h"
+#include "weaklearner.h"
+#include "stumpscan.h"
+
+
+
+/**
+ * Measures the throughput of every supported stump scan kernel against that of selectThreshold().
+ * test_stumpscan checks that they agree.
+ *
+ * Arguments:
+ *     [samples (default 10000)]
+ *     [features (default 2000)]
+ */
+int main(int argc, char **argv) {
+    const unsigned int samples = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const unsigned int features = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    if (samples == 0 || features == 0)
+    {
+        std::cerr << "Samples and features must be positive." << std::endl;
+        return 1;
+    }
+
+    //Feature values are rounded, so thresholds between equal values are exercised too
+    boost::random::mt19937 rng(137);
+    boost::random::normal_distribution<feature_value_type> normal;
+    boost::random::uniform_01<weight_type> uniform;
+
+    std::vector<StumpScanBuffer> buffers(features);
+    std::vector< std::vector<FeatureAndWeight> > reference(features);
+    std::vector<weight_type> total_p(features, 0);
+    std::vector<weight_type> total_n(features, 0);
+    for (unsigned int j = 0; j < features; ++j)
+    {
+        reference[j].resize(samples);
+        for (unsigned int k = 0; k < samples; ++k)
+        {
+            reference[j][k].label = uniform(rng) < .25f ? yes : no;
+            reference[j][k].feature = std::floor( (normal(rng) + (reference[j][k].label == yes) * (j % 10) / 10.0f) * 64.0f );
+            reference[j][k].weight = (.5f + uniform(rng)) / samples;
+
+            (reference[j][k].label == yes ? total_p[j] : total_n[j]) += reference[j][k].weight;
+        }
+        std::sort(reference[j].begin(), reference[j].end());
+
+        buffers[j].resize(samples);
+        for (unsigned int k = 0; k < samples; ++k)
+        {
+            buffers[j].values[k] = reference[j][k].feature;
+            buffers[j].signed_weights[k] = reference[j][k].label == yes ? reference[j][k].weight : -reference[j][k].weight;
+        }
+    }
+
+    //The reference scan
+    std::vector<weight_type> expected_error(features);
+    std::vector<feature_value_type> expected_threshold(features);
+    std::vector<Classification> expected_polarity(features);
+    const tbb::tick_count reference_start = tbb::tick_count::now();
+    for (unsigned int j = 0; j < features; ++j)
+    {
+        expected_error[j] = selectThreshold(reference[j], total_p[j], total_n[j], expected_threshold[j], expected_polarity[j]);
+    }
+    const double reference_seconds = (tbb::tick_count::now() - reference_start).seconds();
+
+    std::cout << features << " features, " << samples << " samples\n";
+    std::cout << "kernel           ns/sample  speedup\n";
+    std::cout << std::setw(16) << std::left << "selectThreshold" << std::right
+              << std::setw(11) << std::fixed << std::setprecision(3) << reference_seconds * 1e9 / ((double)features * samples)
+              << std::setw(9) << std::setprecision(2) << 1.0 << '\n';
+
+    const StumpScanKernel kernels[] = {scalarStumpScan, sseStumpScan, avx2StumpScan};
+    const char * const names[] = {"scalar", "sse2", "avx2"};
+    for (unsigned int kernel = 0; kernel < sizeof(kernels) / sizeof(kernels[0]); ++kernel)
+    {
+        if ( !isStumpScanKernelSupported(kernels[kernel]) )
+        {
+            std::cout << std::setw(16) << std::left << names[kernel] << std::right << "  not supported\n";
+            continue;
+        }
+
+        std::vector<weight_type> error(features);
+        std::vector<feature_value_type> threshold(features);
+        std::vector<Classification> polarity(features);
+        const tbb::tick_count start = tbb::tick_count::now();
+        for (unsigned int j = 0; j < features; ++j)
+        {
+            error[j] = scanStumpThreshold(&buffers[j].values[0], &buffers[j].signed_weights[0], samples,
+                                          total_p[j], total_n[j], threshold[j], polarity[j], kernels[kernel]);
+        }
+        const double seconds = (tbb::tick_count::now() - start).seconds();
+
+        std::cout << std::setw(16) << std::left << names[kernel] << std::right
+                  << std::setw(11) << std::setprecision(3) << seconds * 1e9 / ((double)features * samples)
+                  << std::setw(9) << std::setprecision(2) << reference_seconds / seconds << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <limits>
+
+#include <tbb/tbb.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "trainingdata.h"
+#include "progresscallback.h"
+#include "weaklearner.h"
+
+
+
+/**
+ * A decision stump whose feature values only exist in the precomputed FeatureValueMatrix.
+ */
+struct BenchmarkHypothesis
+{
+    BenchmarkHypothesis() : theta(0), p(1) {}
+
+    void setThreshold(const float theta_)
+    {
+        theta = theta_;
+    }
+
+    void setPolarity(const float p_)
+    {
+        p = p_;
+    }
+
+    float featureValue(const Example &, const float = 1.0f) const
+    {
+        return .0f; //never called: feature values are precomputed
+    }
+
+    float theta;
+    float p;
+};
+
+
+
+/**
+ * Runs one boosting round worth of weak learning. Meant to be executed inside a tbb::task_arena.
+ */
+struct Round
+{
+    WeakLearnerMutex                   & mutex;
+    const TrainingData                 & trainingData;
+    const WeightVector                 & weights;
+    std::vector<BenchmarkHypothesis>   & hypothesis;
+    ProgressCallback                   * progressCallback;
+    unsigned int                       & selected;
+
+    Round(WeakLearnerMutex                 & mutex_,
+          const TrainingData               & trainingData_,
+          const WeightVector               & weights_,
+          std::vector<BenchmarkHypothesis> & hypothesis_,
+          ProgressCallback                 * progressCallback_,
+          unsigned int                     & selected_) : mutex(mutex_),
+                                                          trainingData(trainingData_),
+                                                          weights(weights_),
+                                                          hypothesis(hypothesis_),
+                                                          progressCallback(progressCallback_),
+                                                          selected(selected_) {}
+
+    void operator()() const
+    {
+        unsigned long count = 0;
+        DecisionStumpWeakLearner<BenchmarkHypothesis> weakLearner(mutex, trainingData, weights, hypothesis, count, progressCallback);
+        tbb::parallel_reduce( tbb::blocked_range< unsigned int >(0, hypothesis.size()), weakLearner );
+        selected = weakLearner.selectedIndex();
+    }
+};
+
+
+
+/**
+ * The baseline: weak learning the way it was done before weak learners were parallel_reduce
+ * bodies. Features are evaluated by a tbb::parallel_for, and after each one the mutex is taken
+ * to update the shared selection, then again to count it and report progress.
+ */
+struct LockedFeatures
+{
+    WeakLearnerMutex                   & mutex;
+    const TrainingData                 & trainingData;
+    const WeightVector                 & weights;
+    std::vector<BenchmarkHypothesis>   & hypothesis;
+    ProgressCallback                   * progressCallback;
+    weight_type                        & error;
+    unsigned int                       & selected;
+    unsigned long                      & count;
+
+    LockedFeatures(WeakLearnerMutex                 & mutex_,
+                   const TrainingData               & trainingData_,
+                   const WeightVector               & weights_,
+                   std::vector<BenchmarkHypothesis> & hypothesis_,
+                   ProgressCallback                 * progressCallback_,
+                   weight_type                      & error_,
+                   unsigned int                     & selected_,
+                   unsigned long                    & count_) : mutex(mutex_),
+                                                                trainingData(trainingData_),
+                                                                weights(weights_),
+                                                                hypothesis(hypothesis_),
+                                                                progressCallback(progressCallback_),
+                                                                error(error_),
+                                                                selected(selected_),
+                                                                count(count_) {}
+
+    void operator()(const tbb::blocked_range< unsigned int > & range) const
+    {
+        for (unsigned int j = range.begin(); j != range.end(); ++j)
+        {
+            //The same search the weak learner makes, on a single feature and without reporting it
+            unsigned long unused = 0;
+            DecisionStumpWeakLearner<BenchmarkHypothesis> weakLearner(mutex, trainingData, weights, hypothesis, unused, 0);
+            weakLearner( tbb::blocked_range< unsigned int >(j, j + 1) );
+
+            {
+                WeakLearnerMutex::scoped_lock lock(mutex);
+                if (weakLearner.weightedError() < error)
+                {
+                    error = weakLearner.weightedError();
+                    selected = j;
+                }
+            }
+
+            if (progressCallback)
+            {
+                WeakLearnerMutex::scoped_lock lock(mutex);
+                ++count;
+                progressCallback->tick(count, hypothesis.size());
+            }
+        }
+    }
+};
+
+struct LockedRound
+{
+    WeakLearnerMutex                   & mutex;
+    const TrainingData                 & trainingData;
+    const WeightVector                 & weights;
+    std::vector<BenchmarkHypothesis>   & hypothesis;
+    ProgressCallback                   * progressCallback;
+    unsigned int                       & selected;
+
+    LockedRound(WeakLearnerMutex                 & mutex_,
+                const TrainingData               & trainingData_,
+                const WeightVector               & weights_,
+                std::vector<BenchmarkHypothesis> & hypothesis_,
+                ProgressCallback                 * progressCallback_,
+                unsigned int                     & selected_) : mutex(mutex_),
+                                                                trainingData(trainingData_),
+                                                                weights(weights_),
+                                                                hypothesis(hypothesis_),
+                                                                progressCallback(progressCallback_),
+                                                                selected(selected_) {}
+
+    void operator()() const
+    {
+        unsigned long count = 0;
+        weight_type error = std::numeric_limits<weight_type>::max();
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, hypothesis.size()),
+                           LockedFeatures(mutex, trainingData, weights, hypothesis, progressCallback, error, selected, count) );
+    }
+};
+
+
+
+/**
+ * Seconds per round of one of the Round types, after a warm up round.
+ */
+template<typename RoundType>
+double timeRounds(tbb::task_arena & arena, const RoundType & round, const unsigned int rounds)
+{
+    arena.execute(round);
+
+    const tbb::tick_count start = tbb::tick_count::now();
+    for (unsigned int r = 0; r < rounds; ++r)
+    {
+        arena.execute(round);
+    }
+    return (tbb::tick_count::now() - start).seconds() / rounds;
+}
+
+
+
+/**
+ * Measures how the weak learner selection scales from 1 to all hardware threads, as a
+ * parallel_reduce (see WeakLearnerBody) and as the locked parallel_for it replaced, both
+ * reporting progress to a SimpleProgressCallback as the training tools do.
+ *
+ * Arguments:
+ *     [features (default 20000)]
+ *     [samples (default 4000)]
+ *     [--presort]
+ */
+int main(int argc, char **argv) {
+    const unsigned int features = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const unsigned int samples = argc > 2 ? std::atoi(argv[2]) : 4000;
+    const bool presort = argc > 3 && std::string(argv[3]) == "--presort";
+    const unsigned int rounds = 3;
+
+    std::vector<LabeledExample> examples;
+    examples.reserve(samples);
+    for (unsigned int i = 0; i < samples; ++i)
+    {
+        examples.push_back( LabeledExample(cv::Mat::zeros(20, 20, cv::DataType<unsigned char>::type), i % 4 ? no : yes) );
+    }
+
+    TrainingData trainingData;
+    for (unsigned int i = 0; i < samples; ++i)
+    {
+        trainingData.allSamples.push_back(&examples[i]);
+    }
+
+    //Positive samples get slightly higher values, more so on some features
+    boost::random::mt19937 rng(137);
+    boost::random::normal_distribution<feature_value_type> normal;
+    trainingData.featureValues.resize(features, samples);
+    for (unsigned int j = 0; j < features; ++j)
+    {
+        feature_value_type * const values = trainingData.featureValues.mutableRow(j);
+        for (unsigned int i = 0; i < samples; ++i)
+        {
+            values[i] = normal(rng) + (examples[i].getLabel() == yes) * (j % 100) / 100.0f;
+        }
+    }
+    if (presort)
+    {
+        trainingData.sortedSamples.compute(trainingData.featureValues);
+    }
+
+    const WeightVector weights(samples, 1.0f / samples);
+    std::vector<BenchmarkHypothesis> hypothesis(features);
+    WeakLearnerMutex mutex;
+
+    //1, 2, 4, ... up to all hardware threads
+    std::vector<int> concurrency;
+    const int max_threads = tbb::this_task_arena::max_concurrency();
+    for (int threads = 1; threads < max_threads; threads *= 2)
+    {
+        concurrency.push_back(threads);
+    }
+    concurrency.push_back(max_threads);
+
+    SimpleProgressCallback progressCallback;
+    std::ostringstream table;
+    table << features << " features, " << samples << " samples" << (presort ? ", presorted" : "") << '\n'
+          << "         locked parallel_for         parallel_reduce\n"
+          << "threads  seconds/round  speedup     seconds/round  speedup  over locked\n";
+
+    double locked_single_thread = 0;
+    double single_thread = 0;
+    for (std::vector<int>::const_iterator threads = concurrency.begin(); threads != concurrency.end(); ++threads)
+    {
+        tbb::task_arena arena(*threads);
+        unsigned int locked_selected = 0;
+        unsigned int selected = 0;
+
+        const double locked_seconds = timeRounds(arena, LockedRound(mutex, trainingData, weights, hypothesis, &progressCallback, locked_selected), rounds);
+        const double seconds = timeRounds(arena, Round(mutex, trainingData, weights, hypothesis, &progressCallback, selected), rounds);
+
+        if (*threads == 1)
+        {
+            locked_single_thread = locked_seconds;
+            single_thread = seconds;
+        }
+
+        table << std::setw(7) << *threads
+              << std::setw(15) << std::fixed << std::setprecision(4) << locked_seconds
+              << std::setw(9) << std::setprecision(2) << locked_single_thread / locked_seconds
+              << std::setw(18) << std::setprecision(4) << seconds
+              << std::setw(9) << std::setprecision(2) << single_thread / seconds
+              << std::setw(13) << locked_seconds / seconds
+              << "  (selected " << locked_selected << ", " << selected << ")\n";
+    }
+
+    //The callback reports progress on the same lines
+    std::cout << '\n' << table.str();
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "template_calibratetrace.h"
+
+/**
+ * Calibrates the soft cascade rejection trace of a strong classifier on validation positives.
+ * Arguments:
+ *     strongHypothesisFile
+ *     positivesImageFile
+ *     rejectionTraceOutputFile
+ *     [--threshold strongClassifierThreshold (default 0)]
+ *     [--detection-rate leastFractionOfPositivesKept (default 0.99)]
+ *     [--negatives negativesImageFile --index negativesIndexFile] to report the evaluations saved
+ */
+int main(int argc, char **argv) {
+    const std::string strongHypothesisFile = argv[1];
+    const std::string positivesFile = argv[2];
+    const std::string rejectionTraceFile = argv[3];
+    const std::vector<std::string> options(argv + 4, argv + argc);
+
+    return ___calibrate_main<ViolaJonesClassifier>(
+                strongHypothesisFile,
+                positivesFile,
+                rejectionTraceFile,
+                options);
+}
@@ -0,0 +1,372 @@
+#ifndef CASCADETRAINER_H
+#define CASCADETRAINER_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include <tbb/tbb.h>
+#include <boost/shared_ptr.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "stronghypothesis.h"
+#include "cascade.h"
+#include "atomicfile.h"
+#include "adaboost.h"
+#include "negativeminer.h"
+
+
+
+/**
+ * Adds the vote of a weak hypothesis to the score of each sample.
+ */
+template<typename WeakHypothesisType>
+struct AddVotes
+{
+    const WeakHypothesisType & weak_hypothesis;
+    const weight_type alpha;
+    const std::vector<LabeledExample> & samples;
+    std::vector<float> & scores;
+
+    AddVotes(const WeakHypothesisType & weak_hypothesis_,
+             const weight_type alpha_,
+             const std::vector<LabeledExample> & samples_,
+             std::vector<float> & scores_) : weak_hypothesis(weak_hypothesis_),
+                                             alpha(alpha_),
+                                             samples(samples_),
+                                             scores(scores_) {}
+
+    void operator()(const tbb::blocked_range< std::size_t > & range) const
+    {
+        for (std::size_t i = range.begin(); i < range.end(); ++i)
+        {
+            scores[i] += alpha * weak_hypothesis.classify(samples[i]);
+        }
+    }
+};
+
+
+
+/**
+ * Decides when a cascade stage has enough weak hypothesis: after each boosting round, sets the
+ * stage threshold as high as it can be while the stage still accepts minimumDetectionRate of
+ * the validation positives, then stops boosting if, with that threshold, the stage accepts at
+ * most maximumFalsePositiveRate of the validation negatives (Viola and Jones 2004, table 2).
+ *
+ * The scores of the validation samples are kept from round to round, so each round only
+ * evaluates the new weak hypothesis. They add up in the order StrongHypothesis sums them, so
+ * the stage classifies the validation samples exactly as measured here.
+ */
+template<typename WeakHypothesisType>
+class StageCriterion : public StopCriterion<WeakHypothesisType>
+{
+public:
+    StageCriterion(const std::vector<LabeledExample> & positives_,
+                   const std::vector<LabeledExample> & negatives_,
+                   const float minimumDetectionRate_,
+                   const float maximumFalsePositiveRate_) : positives(positives_),
+                                                            negatives(negatives_),
+                                                            minimumDetectionRate(minimumDetectionRate_),
+                                                            maximumFalsePositiveRate(maximumFalsePositiveRate_),
+                                                            positiveScores(positives_.size(), 0.0f),
+                                                            negativeScores(negatives_.size(), 0.0f),
+                                                            sorted(),
+                                                            threshold_(0),
+                                                            detectionRate_(1),
+                                                            falsePositiveRate_(1) {}
+
+    bool stop(const StrongHypothesis<WeakHypothesisType> & stage)
+    {
+        const std::size_t k = stage.size() - 1;
+        tbb::parallel_for( tbb::blocked_range< std::size_t >(0, positives.size()),
+                           AddVotes<WeakHypothesisType>(stage.weakHypothesis(k), stage.alpha(k), positives, positiveScores) );
+        tbb::parallel_for( tbb::blocked_range< std::size_t >(0, negatives.size()),
+                           AddVotes<WeakHypothesisType>(stage.weakHypothesis(k), stage.alpha(k), negatives, negativeScores) );
+
+        //The highest threshold that rejects at most 1 - minimumDetectionRate of the positives
+        if ( !positives.empty() )
+        {
+            const std::size_t rejected = std::min( (std::size_t)((1.0f - minimumDetectionRate) * positives.size()), positives.size() - 1 );
+            sorted.assign(positiveScores.begin(), positiveScores.end());
+            std::nth_element(sorted.begin(), sorted.begin() + rejected, sorted.end());
+            threshold_ = sorted[rejected];
+        }
+
+        detectionRate_ = accepted(positiveScores);
+        falsePositiveRate_ = accepted(negativeScores);
+
+        return falsePositiveRate_ <= maximumFalsePositiveRate;
+    }
+
+    float threshold() const
+    {
+        return threshold_;
+    }
+
+    float detectionRate() const
+    {
+        return detectionRate_;
+    }
+
+    float falsePositiveRate() const
+    {
+        return falsePositiveRate_;
+    }
+
+private:
+    /**
+     * The fraction of the scores at or above the threshold.
+     */
+    float accepted(const std::vector<float> & scores) const
+    {
+        if ( scores.empty() )
+        {
+            return 0;
+        }
+
+        std::size_t count = 0;
+        for (std::vector<float>::const_iterator it = scores.begin(); it != scores.end(); ++it)
+        {
+            count += *it >= threshold_;
+        }
+        return (float)count / scores.size();
+    }
+
+    const std::vector<LabeledExample> & positives;
+    const std::vector<LabeledExample> & negatives;
+    const float minimumDetectionRate;
+    const float maximumFalsePositiveRate;
+
+    std::vector<float> positiveScores;
+    std::vector<float> negativeScores;
+    std::vector<float> sorted;
+
+    float threshold_;
+    float detectionRate_;
+    float falsePositiveRate_;
+};
+
+
+
+/**
+ * Trains an attentional cascade (Viola and Jones 2004): each stage is boosted by Adaboost until
+ * it reaches its detection and false positive rates on a validation set (see StageCriterion).
+ * Every stage is trained and validated only on the samples all previous stages accept, so
+ * later stages learn to reject the negatives the earlier ones could not. With a NegativeMiner,
+ * the negatives rejected are replaced by false positives of the cascade on background images.
+ */
+template<typename WeakHypothesisType, typename WeakLearnerType>
+class CascadeTrainer
+{
+public:
+    /**
+     * @param boosting trains each stage, with whatever options it was given.
+     * @param stageDetectionRate the least fraction of the validation positives each stage accepts.
+     * @param stageFalsePositiveRate the most fraction of the validation negatives each stage accepts,
+     *        unless it reaches maximumStageRounds first.
+     * @param targetFalsePositiveRate training ends when the whole cascade accepts at most this
+     *        fraction of the validation negatives.
+     */
+    CascadeTrainer(Adaboost<WeakHypothesisType, WeakLearnerType> & boosting_,
+                   const float stageDetectionRate_,
+                   const float stageFalsePositiveRate_,
+                   const float targetFalsePositiveRate_,
+                   const unsigned int maximumStages_,
+                   const unsigned int maximumStageRounds_) : boosting(boosting_),
+                                                             stageDetectionRate(stageDetectionRate_),
+                                                             stageFalsePositiveRate(stageFalsePositiveRate_),
+                                                             targetFalsePositiveRate(targetFalsePositiveRate_),
+                                                             maximumStages(maximumStages_),
+                                                             maximumStageRounds(maximumStageRounds_),
+                                                             miner(0) {}
+
+
+
+    /**
+     * After each stage, bootstraps as many negatives as the stage rejected, both for training
+     * and for validation, from the background images of miner. The miner is not owned by the
+     * trainer. Null only removes the negatives rejected.
+     */
+    void setNegativeMiner(NegativeMiner<WeakHypothesisType> * miner_)
+    {
+        miner = miner_;
+    }
+
+
+
+    /**
+     * Adds stages to cascade until the target false positive rate or the maximum amount of
+     * stages is reached, or no negatives are left.
+     * @param hypothesis the weak hypothesis pool of every stage.
+     * @param path if not empty, the cascade is atomically written to this file after each stage.
+     * @return false if a stage could not be trained.
+     */
+    bool train(std::vector<LabeledExample> positives,
+               std::vector<LabeledExample> negatives,
+               std::vector<LabeledExample> validationPositives,
+               std::vector<LabeledExample> validationNegatives,
+               std::vector<WeakHypothesisType> & hypothesis,
+               Cascade<WeakHypothesisType> & cascade,
+               const std::string & path)
+    {
+        const std::size_t initialNegatives = negatives.size();
+        const std::size_t initialValidationNegatives = validationNegatives.size();
+        float cascadeFalsePositiveRate = 1.0f;
+
+        while ( cascade.size() < maximumStages )
+        {
+            if ( positives.empty() || negatives.empty() || validationNegatives.empty() )
+            {
+                std::cout << "No samples left to train another stage." << std::endl;
+                break;
+            }
+
+            boost::shared_ptr< StrongHypothesis<WeakHypothesisType> > stage(new StrongHypothesis<WeakHypothesisType>());
+            StageCriterion<WeakHypothesisType> criterion(validationPositives, validationNegatives, stageDetectionRate, stageFalsePositiveRate);
+            boosting.setStopCriterion(&criterion);
+            boosting.train(positives, negatives, *stage, hypothesis, maximumStageRounds);
+            boosting.setStopCriterion(0);
+
+            if ( stage->size() == 0 )
+            {
+                std::cout << "Stage " << cascade.size() << " could not be trained." << std::endl;
+                return false;
+            }
+
+            stage->setThreshold( criterion.threshold() );
+            cascade.insert(stage);
+
+            keepAccepted(*stage, positives);
+            keepAccepted(*stage, negatives);
+            keepAccepted(*stage, validationPositives);
+            keepAccepted(*stage, validationNegatives);
+
+            //Every validation negative was accepted by the previous stages
+            cascadeFalsePositiveRate *= criterion.falsePositiveRate();
+            std::cout << "Stage " << cascade.size() - 1 << ": " << stage->size() << " weak classifiers, threshold " << stage->getThreshold()
+                      << ", validation detection rate " << criterion.detectionRate()
+                      << " and false positive rate " << criterion.falsePositiveRate()
+                      << ". Cascade false positive rate " << cascadeFalsePositiveRate
+                      << ", " << negatives.size() << " training negatives left." << std::endl;
+
+            if ( !path.empty() && !write(cascade, path) )
+            {
+                std::cout << "Could not write " << path << ". Training goes on." << std::endl;
+            }
+
+            if ( cascadeFalsePositiveRate <= targetFalsePositiveRate )
+            {
+                break;
+            }
+
+            if ( miner && cascade.size() < maximumStages )
+            {
+                bootstrap(cascade, initialNegatives - negatives.size(), initialValidationNegatives - validationNegatives.size(), negatives, validationNegatives);
+            }
+        }
+
+        return true;
+    }
+
+private:
+    /**
+     * Marks the samples a stage accepts.
+     */
+    struct MarkAccepted
+    {
+        const StrongHypothesis<WeakHypothesisType> & stage;
+        const std::vector<LabeledExample> & samples;
+        std::vector<char> & accepted;
+
+        MarkAccepted(const StrongHypothesis<WeakHypothesisType> & stage_,
+                     const std::vector<LabeledExample> & samples_,
+                     std::vector<char> & accepted_) : stage(stage_),
+                                                      samples(samples_),
+                                                      accepted(accepted_) {}
+
+        void operator()(const tbb::blocked_range< std::size_t > & range) const
+        {
+            for (std::size_t i = range.begin(); i < range.end(); ++i)
+            {
+                accepted[i] = stage.classify(samples[i]) == yes;
+            }
+        }
+    };
+
+
+
+    /**
+     * Removes the samples a stage rejects, keeping the order of the others.
+     */
+    static void keepAccepted(const StrongHypothesis<WeakHypothesisType> & stage, std::vector<LabeledExample> & samples)
+    {
+        std::vector<char> accepted(samples.size());
+        tbb::parallel_for( tbb::blocked_range< std::size_t >(0, samples.size()),
+                           MarkAccepted(stage, samples, accepted) );
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            if (accepted[i])
+            {
+                samples[kept++] = samples[i];
+            }
+        }
+        samples.erase(samples.begin() + kept, samples.end());
+    }
+
+
+
+    /**
+     * Mines new negatives and deals them to the training and validation sets, spread along the
+     * order they were found in.
+     */
+    void bootstrap(const Cascade<WeakHypothesisType> & cascade,
+                   const std::size_t trainingQuota,
+                   const std::size_t validationQuota,
+                   std::vector<LabeledExample> & negatives,
+                   std::vector<LabeledExample> & validationNegatives)
+    {
+        const std::size_t quota = trainingQuota + validationQuota;
+        if ( quota == 0 )
+        {
+            return;
+        }
+
+        std::vector<LabeledExample> mined;
+        miner->mine(cascade, quota, mined);
+
+        for (std::size_t i = 0; i < mined.size(); ++i)
+        {
+            const bool validation = (i + 1) * validationQuota / quota != i * validationQuota / quota;
+            (validation ? validationNegatives : negatives).push_back(mined[i]);
+        }
+
+        std::cout << "Bootstrapped " << mined.size() << " of " << quota << " negatives, in "
+                  << miner->windowsScanned() << " background windows." << std::endl;
+    }
+
+
+
+    static bool write(const Cascade<WeakHypothesisType> & cascade, const std::string & path)
+    {
+        std::ostringstream out;
+        return cascade.write(out) && replaceFile(path, out.str());
+    }
+
+    Adaboost<WeakHypothesisType, WeakLearnerType> & boosting;
+    const float stageDetectionRate;
+    const float stageFalsePositiveRate;
+    const float targetFalsePositiveRate;
+    const unsigned int maximumStages;
+    const unsigned int maximumStageRounds;
+
+    NegativeMiner<WeakHypothesisType> * miner;
+};
+
+
+
+#endif // CASCADETRAINER_H
@@ -0,0 +1,236 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+
+#include "common.h"
+#include "atomicfile.h"
+#include "stronghypothesis.h"
+
+
+
+/**
+ * The state of Adaboost between two boosting rounds, from which training can resume.
+ *
+ * Everything else Adaboost keeps is either computed again from the samples and features (or
+ * mapped from the feature value cache file) or drawn from seeds and the round. The thresholds
+ * of the weak hypothesis pool need not be kept: the weak learner sets them again every round,
+ * and the ones that matter are in the strong hypothesis.
+ *
+ * The file starts with a Header, followed by the weights, the features kept by feature sampling
+ * and the strong hypothesis entries, each an alpha and a serialized weak hypothesis.
+ */
+struct TrainingCheckpoint
+{
+    /** The next boosting round */
+    unsigned int round;
+
+    /** The amount of weak hypothesis in the pool */
+    unsigned int features;
+
+    WeightVector weights;
+
+    /** The best features of the last round, which feature sampling evaluates again */
+    std::vector<unsigned int> nearBest;
+
+    std::vector<weight_type> alphas;
+    std::vector<std::string> weakHypothesis;
+
+    TrainingCheckpoint() : round(0),
+                           features(0),
+                           weights(),
+                           nearBest(),
+                           alphas(),
+                           weakHypothesis() {}
+
+
+
+    /**
+     * Serializes a weak hypothesis for a checkpoint, precisely enough to read it back unchanged.
+     */
+    template<typename WeakHypothesisType>
+    static std::string entry(const WeakHypothesisType & weak_hypothesis)
+    {
+        std::ostringstream out;
+        out.precision(std::numeric_limits<float>::digits10 + 3);
+        weak_hypothesis.write(out);
+        return out.str();
+    }
+
+
+
+    /**
+     * Whether the first entries of this checkpoint are those of strong_hypothesis, such as the
+     * entries recovered from a model file and its journal (see StrongHypothesis::recover()).
+     * Those are written less precisely than checkpoints are, so entries are compared as the
+     * model file writes them.
+     *
+     * Checkpoints are written every few rounds, and the journal records every round, so after a
+     * crash the checkpoint may have fewer entries than were recovered: it does not follow them
+     * then. It may also have more, since the journal syncs records in batches (see ModelJournal).
+     */
+    template<typename WeakHypothesisType>
+    bool follows(const StrongHypothesis<WeakHypothesisType> & strong_hypothesis) const
+    {
+        if ( weakHypothesis.size() < strong_hypothesis.size() )
+        {
+            return false;
+        }
+
+        for (std::size_t k = 0; k < strong_hypothesis.size(); ++k)
+        {
+            std::istringstream in(weakHypothesis[k]);
+            WeakHypothesisType weak_hypothesis;
+            if ( !weak_hypothesis.read(in)
+                 || StrongHypothesis<WeakHypothesisType>::entryLine(alphas[k], weak_hypothesis)
+                    != StrongHypothesis<WeakHypothesisType>::entryLine(strong_hypothesis.alpha(k), strong_hypothesis.weakHypothesis(k)) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+
+    /**
+     * Atomically replaces the checkpoint file at path.
+     */
+    bool write(const std::string & path) const
+    {
+        std::string payload;
+        append(payload, &weights[0], weights.size());
+        append(payload, nearBest.empty() ? 0 : &nearBest[0], nearBest.size());
+        for (std::vector<std::string>::size_type k = 0; k < weakHypothesis.size(); ++k)
+        {
+            const boost::uint32_t length = weakHypothesis[k].size();
+            append(payload, &alphas[k], 1);
+            append(payload, &length, 1);
+            payload.append(weakHypothesis[k]);
+        }
+
+        Header header;
+        std::fill(header.magic, header.magic + sizeof(header.magic), 0);
+        std::copy(magic(), magic() + MAGIC_LENGTH, header.magic);
+        header.round = round;
+        header.features = features;
+        header.samples = weights.size();
+        header.kept = nearBest.size();
+        header.entries = weakHypothesis.size();
+        boost::crc_32_type crc;
+        crc.process_bytes(payload.data(), payload.size());
+        header.crc = crc.checksum();
+
+        return replaceFile(path, std::string((const char *)&header, sizeof(header)) + payload);
+    }
+
+
+
+    /**
+     * @return false if there is no checkpoint file at path, or it is not a valid checkpoint.
+     */
+    bool read(const std::string & path)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if ( !in.is_open() )
+        {
+            return false;
+        }
+        const std::string file( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+
+        Header header;
+        if ( file.size() < sizeof(header) )
+        {
+            return false;
+        }
+        std::copy(file.data(), file.data() + sizeof(header), (char *)&header);
+
+        boost::crc_32_type crc;
+        crc.process_bytes(file.data() + sizeof(header), file.size() - sizeof(header));
+        if ( !std::equal(magic(), magic() + MAGIC_LENGTH, header.magic) || header.crc != crc.checksum() )
+        {
+            return false;
+        }
+
+        const char * data = file.data() + sizeof(header);
+        const char * const end = file.data() + file.size();
+
+        round = header.round;
+        features = header.features;
+        weights.resize(header.samples);
+        nearBest.resize(header.kept);
+        alphas.resize(header.entries);
+        weakHypothesis.resize(header.entries);
+        if ( !extract(data, end, weights.empty() ? 0 : &weights[0], weights.size())
+             || !extract(data, end, nearBest.empty() ? 0 : &nearBest[0], nearBest.size()) )
+        {
+            return false;
+        }
+        for (boost::uint32_t k = 0; k < header.entries; ++k)
+        {
+            boost::uint32_t length;
+            if ( !extract(data, end, &alphas[k], 1) || !extract(data, end, &length, 1) || (std::size_t)(end - data) < length )
+            {
+                return false;
+            }
+            weakHypothesis[k].assign(data, length);
+            data += length;
+        }
+
+        return data == end;
+    }
+
+private:
+
+    static const char * magic()
+    {
+        return "ABPCKP1";
+    }
+
+    static const std::size_t MAGIC_LENGTH = 7;
+
+    struct Header
+    {
+        char magic[8];
+        boost::uint32_t round;
+        boost::uint32_t features;
+        boost::uint32_t samples;
+        boost::uint32_t kept;
+        boost::uint32_t entries;
+        boost::uint32_t crc;
+    };
+
+
+
+    template<typename T>
+    static void append(std::string & payload, const T * values, const std::size_t count)
+    {
+        payload.append((const char *)values, count * sizeof(T));
+    }
+
+    template<typename T>
+    static bool extract(const char * & data, const char * const end, T * values, const std::size_t count)
+    {
+        if ( (std::size_t)(end - data) < count * sizeof(T) )
+        {
+            return false;
+        }
+        std::copy(data, data + count * sizeof(T), (char *)values);
+        data += count * sizeof(T);
+        return true;
+    }
+};
+
+
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,74 @@
+#ifndef FEATURESAMPLER_H
+#define FEATURESAMPLER_H
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/seed_seq.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+
+
+/**
+ * Picks which features the weak learner evaluates each boosting round: a uniform random
+ * fraction of all of them, without repetition, plus any features the caller asks to keep,
+ * such as those that were near the best in the previous round.
+ *
+ * The random features of a round only depend on the seed and on the round.
+ */
+class FeatureSampler
+{
+public:
+    FeatureSampler(const float fraction_ = 1.0f,
+                   const boost::uint32_t seed_ = 0) : fraction(fraction_),
+                                                      seed(seed_),
+                                                      permutation() {}
+
+
+
+    /**
+     * @param total how many features there are.
+     * @param round the boosting round. Different rounds sample different features.
+     * @param keep features to evaluate besides the sampled ones.
+     * @param features output parameter. The indexes of the features to evaluate, in increasing order.
+     */
+    void sample(const unsigned int total,
+                const unsigned int round,
+                const std::vector<unsigned int> & keep,
+                std::vector<unsigned int> & features)
+    {
+        const unsigned int size = std::min(total, std::max(1u, (unsigned int)(fraction * total + 0.5f)));
+
+        permutation.resize(total);
+        for (unsigned int j = 0; j < total; ++j)
+        {
+            permutation[j] = j;
+        }
+
+        //The first size positions of a Fisher-Yates shuffle
+        const boost::uint32_t key[2] = {seed, round};
+        boost::random::seed_seq sequence(key, key + 2);
+        boost::random::mt19937 rng(sequence);
+        for (unsigned int k = 0; k < size; ++k)
+        {
+            boost::random::uniform_int_distribution<unsigned int> pick(k, total - 1);
+            std::swap(permutation[k], permutation[ pick(rng) ]);
+        }
+
+        features.assign(permutation.begin(), permutation.begin() + size);
+        features.insert(features.end(), keep.begin(), keep.end());
+        std::sort(features.begin(), features.end());
+        features.erase(std::unique(features.begin(), features.end()), features.end());
+    }
+
+private:
+    const float fraction;
+    const boost::uint32_t seed;
+    std::vector<unsigned int> permutation;
+};
+
+
+
+#endif // FEATURESAMPLER_H
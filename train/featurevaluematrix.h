@@ -0,0 +1,351 @@
+#ifndef FEATUREVALUEMATRIX_H
+#define FEATUREVALUEMATRIX_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <tbb/tbb.h>
+
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+
+
+
+/**
+ * Holds the value of every feature for every training sample in a single contiguous
+ * buffer. Values are stored feature-major: all samples of feature 0, then all samples
+ * of feature 1 and so on. Feature values do not change between boosting rounds, so
+ * this matrix is computed once and reused by the weak learners in every round.
+ *
+ * The values are either kept in memory or in a cache file that is memory-mapped read-only.
+ * A cache file starts with a Header followed by the rows. It records a fingerprint of the
+ * features and samples it was computed from, so later runs over the same wavelets file and
+ * sample set can map it again instead of recomputing it.
+ */
+class FeatureValueMatrix
+{
+public:
+    FeatureValueMatrix() : total_features(0),
+                           total_samples(0),
+                           values(),
+                           data(0) {}
+
+
+
+    /**
+     * Evaluates all hypothesis against all samples, in parallel, keeping the values in memory.
+     */
+    template<typename WeakHypothesisType>
+    void compute(const std::vector<WeakHypothesisType> & hypothesis,
+                 const std::vector<const LabeledExample *> & allSamples)
+    {
+        resize(hypothesis.size(), allSamples.size());
+        if ( values.empty() )
+        {
+            return;
+        }
+
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, hypothesis.size()),
+                           Evaluate<WeakHypothesisType>(&values[0], 0, hypothesis, allSamples) );
+    }
+
+
+
+    /**
+     * Maps the cache file at path if it was computed from the same hypothesis and samples.
+     * Otherwise, evaluates all hypothesis against all samples into that file, one block of
+     * features at a time, and then maps it.
+     * @return false if the cache file could not be written or mapped.
+     */
+    template<typename WeakHypothesisType>
+    bool computeOrMap(const std::vector<WeakHypothesisType> & hypothesis,
+                      const std::vector<const LabeledExample *> & allSamples,
+                      const std::string & path)
+    {
+        const boost::uint32_t expected_fingerprint = fingerprint(hypothesis, allSamples);
+
+        if ( map(path, hypothesis.size(), allSamples.size(), expected_fingerprint) )
+        {
+            return true;
+        }
+
+        std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+        if ( !out.is_open() )
+        {
+            return false;
+        }
+
+        Header header;
+        std::fill(header.magic, header.magic + sizeof(header.magic), 0);
+        std::copy(magic(), magic() + MAGIC_LENGTH, header.magic);
+        header.features = hypothesis.size();
+        header.samples = allSamples.size();
+        header.fingerprint = expected_fingerprint;
+        std::fill(header.reserved, header.reserved + sizeof(header.reserved), 0);
+        out.write((const char *)&header, sizeof(header));
+
+        //Blocks of rows are evaluated in parallel and written sequentially, so memory usage stays bounded
+        const unsigned int block_features = std::max<std::size_t>(1, BLOCK_BYTES / (sizeof(feature_value_type) * std::max<std::size_t>(1, allSamples.size())));
+        std::vector<feature_value_type> block( (std::size_t)block_features * allSamples.size() );
+        for (unsigned int first = 0; first < hypothesis.size(); first += block_features)
+        {
+            const unsigned int last = std::min<unsigned int>(first + block_features, hypothesis.size());
+
+            tbb::parallel_for( tbb::blocked_range< unsigned int >(first, last),
+                               Evaluate<WeakHypothesisType>(&block[0],
+                                                            first,
+                                                            hypothesis,
+                                                            allSamples) );
+
+            out.write((const char *)&block[0], (std::size_t)(last - first) * allSamples.size() * sizeof(feature_value_type));
+        }
+
+        out.close();
+        if ( out.fail() )
+        {
+            return false;
+        }
+
+        return map(path, hypothesis.size(), allSamples.size(), expected_fingerprint);
+    }
+
+
+
+    /**
+     * Discards the current values and allocates room in memory for the given amount of features and samples.
+     */
+    void resize(const unsigned int features_, const unsigned int samples_)
+    {
+        clear();
+        total_features = features_;
+        total_samples = samples_;
+        values.resize( (std::size_t)total_features * total_samples );
+        data = values.empty() ? 0 : &values[0];
+    }
+
+    void clear()
+    {
+        total_features = 0;
+        total_samples = 0;
+        values.clear();
+        region.reset();
+        file.reset();
+        data = 0;
+    }
+
+
+
+    /**
+     * Returns the values of the j-th feature for all samples.
+     */
+    const feature_value_type * row(const unsigned int j) const
+    {
+        return data + (std::size_t)j * total_samples;
+    }
+
+    /**
+     * Writable access to the values of the j-th feature. A mapped matrix is read-only, so
+     * asking it for a writable row throws.
+     */
+    feature_value_type * mutableRow(const unsigned int j)
+    {
+        if ( isMapped() )
+        {
+            throw 233;
+        }
+        return &values[0] + (std::size_t)j * total_samples;
+    }
+
+    unsigned int features() const
+    {
+        return total_features;
+    }
+
+    unsigned int samples() const
+    {
+        return total_samples;
+    }
+
+    bool empty() const
+    {
+        return data == 0;
+    }
+
+    bool isMapped() const
+    {
+        return region.get() != 0;
+    }
+
+private:
+
+    static const char * magic()
+    {
+        return "ABPFVM1";
+    }
+
+    static const std::size_t MAGIC_LENGTH = 7;
+
+    /** Rows are written this many bytes at a time */
+    static const std::size_t BLOCK_BYTES = 64 * 1024 * 1024;
+
+    /**
+     * The cache file header. Its size keeps the rows aligned to a cache line.
+     */
+    struct Header
+    {
+        char magic[8];
+        boost::uint32_t features;
+        boost::uint32_t samples;
+        boost::uint32_t fingerprint;
+        char reserved[44];
+    };
+
+
+
+    /**
+     * Maps a cache file, if it exists and matches the expected sizes and fingerprint.
+     */
+    bool map(const std::string & path,
+             const unsigned int features_,
+             const unsigned int samples_,
+             const boost::uint32_t expected_fingerprint)
+    {
+        clear();
+
+        Header header;
+        {
+            std::ifstream in(path.c_str(), std::ios::binary);
+            if ( !in.is_open() || !in.read((char *)&header, sizeof(header)) )
+            {
+                return false;
+            }
+        }
+
+        if ( !std::equal(magic(), magic() + MAGIC_LENGTH, header.magic)
+             || header.features != features_
+             || header.samples != samples_
+             || header.fingerprint != expected_fingerprint )
+        {
+            return false;
+        }
+
+        try
+        {
+            file.reset( new boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only) );
+            region.reset( new boost::interprocess::mapped_region(*file, boost::interprocess::read_only) );
+        }
+        catch (const boost::interprocess::interprocess_exception &)
+        {
+            clear();
+            return false;
+        }
+
+        if ( region->get_size() < sizeof(Header) + (std::size_t)features_ * samples_ * sizeof(feature_value_type) )
+        {
+            clear();
+            return false;
+        }
+
+        //Weak learners walk the rows from first to last feature
+        region->advise(boost::interprocess::mapped_region::advice_sequential);
+
+        total_features = features_;
+        total_samples = samples_;
+        data = (const feature_value_type *)((const char *)region->get_address() + sizeof(Header));
+
+        return true;
+    }
+
+
+
+    /**
+     * Identifies the hypothesis (through their serialized form) and the samples (through their
+     * labels and integral images) a matrix was computed from.
+     */
+    template<typename WeakHypothesisType>
+    static boost::uint32_t fingerprint(const std::vector<WeakHypothesisType> & hypothesis,
+                                       const std::vector<const LabeledExample *> & allSamples)
+    {
+        boost::crc_32_type crc;
+
+        for (typename std::vector<WeakHypothesisType>::const_iterator it = hypothesis.begin(); it != hypothesis.end(); ++it)
+        {
+            std::ostringstream out;
+            it->write(out);
+            const std::string serialized = out.str();
+            crc.process_bytes(serialized.data(), serialized.size());
+        }
+
+        for (std::vector<const LabeledExample *>::const_iterator it = allSamples.begin(); it != allSamples.end(); ++it)
+        {
+            const int label = (*it)->getLabel();
+            crc.process_bytes(&label, sizeof(label));
+
+            const cv::Mat integralSum = (*it)->getIntegralSum();
+            for (int r = 0; r < integralSum.rows; ++r)
+            {
+                crc.process_bytes(integralSum.ptr<unsigned char>(r), integralSum.cols * integralSum.elemSize());
+            }
+        }
+
+        return crc.checksum();
+    }
+
+
+
+    /**
+     * Fills the rows of a range of features. The row of feature j is written at
+     * (j - first_feature) rows from the beginning of matrix.
+     */
+    template<typename WeakHypothesisType>
+    struct Evaluate
+    {
+        feature_value_type                        * const matrix;
+        const unsigned int                          first_feature;
+        const std::vector<WeakHypothesisType>     & hypothesis;
+        const std::vector<const LabeledExample *> & allSamples;
+
+        Evaluate(feature_value_type                        * const matrix_,
+                 const unsigned int                          first_feature_,
+                 const std::vector<WeakHypothesisType>     & hypothesis_,
+                 const std::vector<const LabeledExample *> & allSamples_) : matrix(matrix_),
+                                                                            first_feature(first_feature_),
+                                                                            hypothesis(hypothesis_),
+                                                                            allSamples(allSamples_) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range) const
+        {
+            for (unsigned int j = range.begin(); j < range.end(); ++j)
+            {
+                feature_value_type * const values = matrix + (std::size_t)(j - first_feature) * allSamples.size();
+                for (std::vector<const LabeledExample *>::size_type i = 0; i < allSamples.size(); ++i)
+                {
+                    values[i] = hypothesis[j].featureValue( *(allSamples[i]) );
+                }
+            }
+        }
+    };
+
+    unsigned int total_features;
+    unsigned int total_samples;
+
+    /** In-memory storage. Empty when the matrix is mapped from a file. */
+    std::vector<feature_value_type, tbb::cache_aligned_allocator<feature_value_type> > values;
+
+    /** The cache file and its mapping, when the matrix is mapped from a file. */
+    boost::scoped_ptr<boost::interprocess::file_mapping> file;
+    boost::scoped_ptr<boost::interprocess::mapped_region> region;
+
+    /** Points to either values or the mapped region. */
+    const feature_value_type * data;
+};
+
+#endif // FEATUREVALUEMATRIX_H
@@ -0,0 +1,282 @@
+#ifndef NEGATIVEMINER_H
+#define NEGATIVEMINER_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <tbb/tbb.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "cascade.h"
+
+
+
+/**
+ * Bootstraps hard negatives (Viola and Jones 2004, section 5.2): scans images known to have no
+ * positives with the cascade trained so far, at every position and scale, and collects the
+ * windows the cascade accepts, which are all false positives, as new negative samples.
+ *
+ * Images are read and scanned by a tbb::parallel_pipeline, so only a few of them are in memory
+ * at any time and all cores scan. Windows are collected in the order of the images, and
+ * scanning stops as soon as the quota is reached. Each call starts from the image after the
+ * last one the previous call used and goes through every image at most once, wrapping around
+ * to the first, so that a later stage is bootstrapped from images earlier ones did not need.
+ */
+template<typename WeakHypothesisType>
+class NegativeMiner
+{
+public:
+    /**
+     * @param directory holds the background images. Files that are not images are skipped.
+     * @param windowSize the width and height of the samples.
+     * @param scaleFactor how much larger each scanned scale is than the previous one.
+     * @param step the distance, in pixels of each scale, between scanned windows.
+     * @param maximumPerImage the most windows taken from a single image, so that the new
+     *        negatives come from many images.
+     */
+    NegativeMiner(const std::string & directory,
+                  const int windowSize_ = 20,
+                  const float scaleFactor_ = 1.25f,
+                  const int step_ = 2,
+                  const std::size_t maximumPerImage_ = 100) : images(),
+                                                              windowSize(windowSize_),
+                                                              scaleFactor(scaleFactor_),
+                                                              step(step_),
+                                                              maximumPerImage(maximumPerImage_),
+                                                              nextImage(0),
+                                                              found(0),
+                                                              scanned(0)
+    {
+        namespace fs = boost::filesystem;
+        if ( fs::is_directory(directory) )
+        {
+            for (fs::directory_iterator it(directory); it != fs::directory_iterator(); ++it)
+            {
+                if ( fs::is_regular_file(it->status()) )
+                {
+                    images.push_back(it->path().string());
+                }
+            }
+        }
+        std::sort(images.begin(), images.end());
+    }
+
+
+
+    std::size_t size() const
+    {
+        return images.size();
+    }
+
+
+
+    /**
+     * Appends up to quota windows the cascade accepts to negatives.
+     * @return how many windows were appended.
+     */
+    std::size_t mine(const Cascade<WeakHypothesisType> & cascade,
+                     const std::size_t quota,
+                     std::vector<LabeledExample> & negatives)
+    {
+        if ( images.empty() || quota == 0 )
+        {
+            return 0;
+        }
+        found = 0;
+        scanned = 0;
+        std::size_t read = 0;
+        const std::size_t start = nextImage;
+        const std::size_t first = negatives.size();
+
+        tbb::parallel_pipeline( 2 * tbb::this_task_arena::max_concurrency(),
+                                tbb::make_filter<void, MinedImagePointer>( tbb::filter_mode::serial_in_order, ReadImage(*this, start, read, quota) )
+                              & tbb::make_filter<MinedImagePointer, MinedImagePointer>( tbb::filter_mode::parallel, ScanImage(*this, cascade, quota) )
+                              & tbb::make_filter<MinedImagePointer, void>( tbb::filter_mode::serial_in_order, Collect(*this, quota, negatives) ) );
+
+        return negatives.size() - first;
+    }
+
+
+
+    /**
+     * How many windows the last call to mine() classified, of the images it used.
+     */
+    unsigned long windowsScanned() const
+    {
+        return scanned;
+    }
+
+private:
+    /**
+     * An image on its way through the pipeline and the windows found in it.
+     */
+    struct MinedImage
+    {
+        std::size_t index;
+        cv::Mat image;
+        std::vector<LabeledExample> windows;
+        unsigned long scanned;
+
+        MinedImage(const std::size_t index_) : index(index_),
+                                               image(),
+                                               windows(),
+                                               scanned(0) {}
+    };
+
+    /** Images are shared by the filters, so that those still in flight are released if the pipeline throws */
+    typedef boost::shared_ptr<MinedImage> MinedImagePointer;
+
+
+
+    /**
+     * Reads the next image, unless the quota is reached or every image was read by this call.
+     */
+    struct ReadImage
+    {
+        const NegativeMiner & miner;
+        const std::size_t start;
+        std::size_t & read;
+        const std::size_t quota;
+
+        ReadImage(const NegativeMiner & miner_,
+                  const std::size_t start_,
+                  std::size_t & read_,
+                  const std::size_t quota_) : miner(miner_),
+                                              start(start_),
+                                              read(read_),
+                                              quota(quota_) {}
+
+        MinedImagePointer operator()(tbb::flow_control & control) const
+        {
+            while ( read < miner.images.size() && miner.found < quota )
+            {
+                const std::size_t index = (start + read++) % miner.images.size();
+                const MinedImagePointer mined(new MinedImage(index));
+                mined->image = cv::imread(miner.images[index], cv::DataType<unsigned char>::type);
+                if ( mined->image.data )
+                {
+                    return mined;
+                }
+            }
+
+            control.stop();
+            return MinedImagePointer();
+        }
+    };
+
+
+
+    /**
+     * Classifies every window of every scale of an image. Gives up once the quota is reached
+     * by earlier images, since the windows of this one would not be used then.
+     */
+    struct ScanImage
+    {
+        const NegativeMiner & miner;
+        const Cascade<WeakHypothesisType> & cascade;
+        const std::size_t quota;
+
+        ScanImage(const NegativeMiner & miner_,
+                  const Cascade<WeakHypothesisType> & cascade_,
+                  const std::size_t quota_) : miner(miner_),
+                                              cascade(cascade_),
+                                              quota(quota_) {}
+
+        MinedImagePointer operator()(const MinedImagePointer & mined) const
+        {
+            const int windowSize = miner.windowSize;
+            cv::Mat scaled, integralSum, integralSquare;
+            for (float scale = 1.0f;
+                 mined->image.cols / scale >= windowSize && mined->image.rows / scale >= windowSize;
+                 scale *= miner.scaleFactor)
+            {
+                //Scaling the image down keeps the windows the size of the samples
+                cv::resize(mined->image, scaled, cv::Size((int)(mined->image.cols / scale), (int)(mined->image.rows / scale)), 0, 0, cv::INTER_AREA);
+                WeakHypothesisType::integrals_type::compute(scaled, integralSum, integralSquare, WeakHypothesisType::needs_integral_square);
+
+                for (int y = 0; y + windowSize <= scaled.rows; y += miner.step)
+                {
+                    if ( mined->windows.size() >= miner.maximumPerImage || miner.found >= quota )
+                    {
+                        return mined;
+                    }
+
+                    for (int x = 0; x + windowSize <= scaled.cols; x += miner.step)
+                    {
+                        //Rectangle sums are differences, so the integrals of a window are a region of those of the image
+                        const cv::Rect window(x, y, windowSize + 1, windowSize + 1);
+                        const Example example(integralSum(window), integralSquare.data ? integralSquare(window) : cv::Mat());
+                        ++mined->scanned;
+                        if ( cascade.classify(example) == yes )
+                        {
+                            mined->windows.push_back( LabeledExample(scaled(cv::Rect(x, y, windowSize, windowSize)), no, WeakHypothesisType::needs_integral_square) );
+                            if ( mined->windows.size() >= miner.maximumPerImage )
+                            {
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return mined;
+        }
+    };
+
+
+
+    /**
+     * Appends the windows found, in the order of the images, up to the quota.
+     */
+    struct Collect
+    {
+        NegativeMiner & miner;
+        const std::size_t quota;
+        std::vector<LabeledExample> & negatives;
+
+        Collect(NegativeMiner & miner_,
+                const std::size_t quota_,
+                std::vector<LabeledExample> & negatives_) : miner(miner_),
+                                                            quota(quota_),
+                                                            negatives(negatives_) {}
+
+        void operator()(const MinedImagePointer & mined) const
+        {
+            if ( miner.found < quota )
+            {
+                const std::size_t taken = std::min(mined->windows.size(), quota - miner.found);
+                negatives.insert(negatives.end(), mined->windows.begin(), mined->windows.begin() + taken);
+                miner.scanned += mined->scanned;
+                miner.nextImage = (mined->index + 1) % miner.images.size();
+                miner.found += taken;
+            }
+        }
+    };
+
+
+
+    std::vector<std::string> images;
+    const int windowSize;
+    const float scaleFactor;
+    const int step;
+    const std::size_t maximumPerImage;
+
+    /** The image the next call to mine() starts from */
+    std::size_t nextImage;
+
+    /** Windows collected by the current call to mine(). Read by the scanning threads. */
+    boost::atomic<std::size_t> found;
+    unsigned long scanned;
+};
+
+
+
+#endif // NEGATIVEMINER_H
@@ -42,3 +42,19 @@ void SimpleProgressCallback::classifierSelected (const weight_type alpha,
     std::cout << "\n  Normalization factor: " << normalization_factor << '\n';
     std::cout.flush();
 }
+
+void SimpleProgressCallback::approximateSelection (const weight_type approximate_error,
+                                                   const weight_type exact_error)
+{
+    std::cout << "\rThe weak classifier threshold was searched approximately.";
+    std::cout << "\n  Approximate error   : " << approximate_error;
+    std::cout << "\n  Exact search error  : " << exact_error << '\n';
+    std::cout.flush();
+}
+
+void SimpleProgressCallback::activeSamples (const unsigned int active,
+                                            const unsigned int total)
+{
+    std::cout << "\rWeight trimming kept " << active << " of " << total << " samples.\n";
+    std::cout.flush();
+}
@@ -20,6 +20,19 @@ struct ProgressCallback
                                      const weight_type normalization_factor,
                                      const weight_type lowest_classifier_error,
                                      const unsigned int classifier_idx) =0;
+
+    /**
+     * Reports, for weak learners that search thresholds approximately, the weighted error
+     * of the selected classifier and the error an exact search would reach with the same feature.
+     */
+    virtual void approximateSelection (const weight_type approximate_error,
+                                       const weight_type exact_error) =0;
+
+    /**
+     * Reports, when trimming weights, on how many of the samples the weak learner trains this round.
+     */
+    virtual void activeSamples (const unsigned int active,
+                                const unsigned int total) =0;
 };
 
 
@@ -43,6 +56,12 @@ public:
                                      const weight_type normalization_factor,
                                      const weight_type lowest_classifier_error,
                                      const unsigned int classifier_idx);
+
+    virtual void approximateSelection (const weight_type approximate_error,
+                                       const weight_type exact_error);
+
+    virtual void activeSamples (const unsigned int active,
+                                const unsigned int total);
 };
 
 
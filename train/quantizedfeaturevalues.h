@@ -0,0 +1,176 @@
+#ifndef QUANTIZEDFEATUREVALUES_H
+#define QUANTIZEDFEATUREVALUES_H
+
+#include <vector>
+#include <algorithm>
+#include <tbb/tbb.h>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "featurevaluematrix.h"
+
+
+
+/**
+ * Holds the feature values of every sample quantized into, at most, 256 bins per feature.
+ * Bin b of feature j holds the values in the interval (upperBound(j)[b-1], upperBound(j)[b]].
+ * Bin bounds are quantiles of the feature values, so each bin holds roughly the same amount
+ * of samples, and every bound is an actual feature value: using it as a decision stump
+ * threshold splits the samples exactly as the bins do.
+ */
+class QuantizedFeatureValues
+{
+public:
+    typedef unsigned char bin_type;
+
+    QuantizedFeatureValues() : total_bins(0),
+                               total_samples(0),
+                               bins_used(),
+                               bounds(),
+                               codes() {}
+
+
+
+    /**
+     * Quantizes the values of all features in parallel. If featureValues is empty,
+     * the feature values are evaluated here.
+     */
+    template<typename WeakHypothesisType>
+    void compute(const std::vector<WeakHypothesisType> & hypothesis,
+                 const std::vector<const LabeledExample *> & allSamples,
+                 const FeatureValueMatrix & featureValues,
+                 const unsigned int bins_)
+    {
+        total_bins = bins_;
+        total_samples = allSamples.size();
+        bins_used.resize(hypothesis.size());
+        bounds.resize( (std::size_t)hypothesis.size() * total_bins );
+        codes.resize( (std::size_t)hypothesis.size() * total_samples );
+
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, hypothesis.size()),
+                           Quantize<WeakHypothesisType>(*this, hypothesis, allSamples, featureValues) );
+    }
+
+    void clear()
+    {
+        total_bins = 0;
+        total_samples = 0;
+        bins_used.clear();
+        bounds.clear();
+        codes.clear();
+    }
+
+
+
+    /**
+     * Returns the bin of each sample for the j-th feature.
+     */
+    const bin_type * bin(const unsigned int j) const
+    {
+        return &codes[0] + (std::size_t)j * total_samples;
+    }
+
+    /**
+     * Returns the (inclusive) upper bound of each bin of the j-th feature.
+     */
+    const feature_value_type * upperBound(const unsigned int j) const
+    {
+        return &bounds[0] + (std::size_t)j * total_bins;
+    }
+
+    /**
+     * Returns how many bins the j-th feature actually uses. It is less than bins()
+     * when the feature has few distinct values.
+     */
+    unsigned int binsUsed(const unsigned int j) const
+    {
+        return bins_used[j];
+    }
+
+    unsigned int bins() const
+    {
+        return total_bins;
+    }
+
+    bool empty() const
+    {
+        return codes.empty();
+    }
+
+private:
+
+    template<typename WeakHypothesisType>
+    struct Quantize
+    {
+        QuantizedFeatureValues                    & quantized;
+        const std::vector<WeakHypothesisType>     & hypothesis;
+        const std::vector<const LabeledExample *> & allSamples;
+        const FeatureValueMatrix                  & featureValues;
+
+        Quantize(QuantizedFeatureValues                    & quantized_,
+                 const std::vector<WeakHypothesisType>     & hypothesis_,
+                 const std::vector<const LabeledExample *> & allSamples_,
+                 const FeatureValueMatrix                  & featureValues_) : quantized(quantized_),
+                                                                               hypothesis(hypothesis_),
+                                                                               allSamples(allSamples_),
+                                                                               featureValues(featureValues_) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range) const
+        {
+            const unsigned int samples = quantized.total_samples;
+            const unsigned int bins = quantized.total_bins;
+
+            std::vector<feature_value_type> values(samples);
+            std::vector<feature_value_type> sorted(samples);
+
+            for (unsigned int j = range.begin(); j < range.end(); ++j)
+            {
+                if ( featureValues.empty() )
+                {
+                    for (unsigned int i = 0; i < samples; ++i)
+                    {
+                        values[i] = hypothesis[j].featureValue( *(allSamples[i]) );
+                    }
+                }
+                else
+                {
+                    std::copy(featureValues.row(j), featureValues.row(j) + samples, values.begin());
+                }
+
+                std::copy(values.begin(), values.end(), sorted.begin());
+                std::sort(sorted.begin(), sorted.end());
+
+                //The b-th bound is the (b+1)/bins quantile. Repeated quantiles collapse into a single bin.
+                feature_value_type * const bound = &quantized.bounds[0] + (std::size_t)j * bins;
+                unsigned int used = 0;
+                for (unsigned int b = 0; b < bins; ++b)
+                {
+                    const std::size_t k = std::max<std::size_t>(1, ((std::size_t)(b + 1) * samples) / bins) - 1;
+                    if ( used == 0 || sorted[k] != bound[used - 1] )
+                    {
+                        bound[used++] = sorted[k];
+                    }
+                }
+                bound[used - 1] = sorted[samples - 1];
+                std::fill(bound + used, bound + bins, sorted[samples - 1]);
+                quantized.bins_used[j] = used;
+
+                bin_type * const code = &quantized.codes[0] + (std::size_t)j * samples;
+                for (unsigned int i = 0; i < samples; ++i)
+                {
+                    code[i] = (bin_type)(std::lower_bound(bound, bound + used, values[i]) - bound);
+                }
+            }
+        }
+    };
+
+    unsigned int total_bins;
+    unsigned int total_samples;
+    std::vector<unsigned int> bins_used;
+    std::vector<feature_value_type, tbb::cache_aligned_allocator<feature_value_type> > bounds;
+    std::vector<bin_type, tbb::cache_aligned_allocator<bin_type> > codes;
+};
+
+
+
+#endif // QUANTIZEDFEATUREVALUES_H
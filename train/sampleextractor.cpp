@@ -17,7 +17,8 @@ bool SampleExtractor::extractRandomSample(const unsigned int sample_size,
                                           const std::string &imagePath,
                                           std::vector<LabeledExample> &samples,
                                           Classification c,
-                                          std::vector<unsigned int > *sampleIndexes)
+                                          std::vector<unsigned int > *sampleIndexes,
+                                          const bool withIntegralSquare)
 {
     boost::unordered_set<unsigned int> selectedIndexes;
 
@@ -50,13 +51,13 @@ bool SampleExtractor::extractRandomSample(const unsigned int sample_size,
             return false;
         }
 
-        samples.push_back(LabeledExample(image, c));
+        samples.push_back(LabeledExample(image, c, withIntegralSquare));
     }
 
     return true;
 }
 
-bool SampleExtractor::extractSamplesWithIndex(const std::string &imagePath, const std::string &indexPath, std::vector<LabeledExample> &samples, Classification c)
+bool SampleExtractor::extractSamplesWithIndex(const std::string &imagePath, const std::string &indexPath, std::vector<LabeledExample> &samples, Classification c, const bool withIntegralSquare)
 {
     std::ifstream indexStream(indexPath.c_str());
     if (!indexStream.is_open())
@@ -87,13 +88,48 @@ bool SampleExtractor::extractSamplesWithIndex(const std::string &imagePath, cons
         const cv::Rect sampleRoi(index * 20, 0, 20, 20);
         const cv::Mat sample = full_image(sampleRoi);
 
-        samples.push_back(LabeledExample(sample, c));
+        samples.push_back(LabeledExample(sample, c, withIntegralSquare));
     }
 
     return true;
 }
 
-bool SampleExtractor::fromIndexFile(const std::string & indexPath, std::vector<LabeledExample> &samples, Classification c)
+bool SampleExtractor::extractSamplesWithIndex(const std::string &imagePath, const std::string &indexPath, std::vector<cv::Mat> &samples)
+{
+    std::ifstream indexStream(indexPath.c_str());
+    if (!indexStream.is_open())
+    {
+        return false;
+    }
+
+    const cv::Mat full_image = cv::imread(imagePath, cv::DataType<unsigned char>::type);
+    if (full_image.data == 0)
+    {
+        return false;
+    }
+
+    while(! indexStream.eof() )
+    {
+        std::string line;
+        std::getline(indexStream, line);
+
+        if (line.empty())
+        {
+            break;
+        }
+
+        std::istringstream lineInputStream(line);
+        int index;
+        lineInputStream >> index;
+
+        const cv::Rect sampleRoi(index * 20, 0, 20, 20);
+        samples.push_back(full_image(sampleRoi));
+    }
+
+    return true;
+}
+
+bool SampleExtractor::fromIndexFile(const std::string & indexPath, std::vector<LabeledExample> &samples, Classification c, const bool withIntegralSquare)
 {
     std::ifstream indexStream(indexPath.c_str());
     if (!indexStream.is_open())
@@ -118,7 +154,7 @@ bool SampleExtractor::fromIndexFile(const std::string & indexPath, std::vector<L
             return false;
         }
 
-        samples.push_back(LabeledExample(image, c));
+        samples.push_back(LabeledExample(image, c, withIntegralSquare));
     }
 
     indexStream.close();
@@ -126,7 +162,7 @@ bool SampleExtractor::fromIndexFile(const std::string & indexPath, std::vector<L
     return true;
 }
 
-bool SampleExtractor::fromImageFile(const std::string &imagePath, std::vector<LabeledExample> &samples, Classification c)
+bool SampleExtractor::fromImageFile(const std::string &imagePath, std::vector<LabeledExample> &samples, Classification c, const bool withIntegralSquare)
 {
     const cv::Size roiSize(20 ,20);
     const cv::Mat full_image = cv::imread(imagePath, cv::DataType<unsigned char>::type);
@@ -143,7 +179,7 @@ bool SampleExtractor::fromImageFile(const std::string &imagePath, std::vector<La
             return false;
         }
 
-        samples[i] = LabeledExample(image, c);
+        samples[i] = LabeledExample(image, c, withIntegralSquare);
     }
 
     return true;
@@ -8,6 +8,10 @@
 
 
 
+/**
+ * Loads training samples. Samples only get an integral square if withIntegralSquare is true,
+ * which is only needed by variance normalized weak hypothesis.
+ */
 class SampleExtractor
 {
 private:
@@ -22,19 +26,25 @@ public:
                                     const std::string & filename,
                                     std::vector<LabeledExample> & samples,
                                     Classification c,
-                                    std::vector<unsigned int> *sampleIndexes = 0);
+                                    std::vector<unsigned int> *sampleIndexes = 0,
+                                    const bool withIntegralSquare = true);
 
     /**
      * 'Cuts' samples from an image using an index. The index 'points' to rectangles inside the big image.
      */
-    static bool extractSamplesWithIndex(const std::string &imagePath, const std::string &indexPath, std::vector<LabeledExample> &samples, Classification c);
+    static bool extractSamplesWithIndex(const std::string &imagePath, const std::string &indexPath, std::vector<LabeledExample> &samples, Classification c, const bool withIntegralSquare = true);
+
+    /**
+     * Same as above, but the samples are the 'cut' images themselves, which share the memory of the big image.
+     */
+    static bool extractSamplesWithIndex(const std::string &imagePath, const std::string &indexPath, std::vector<cv::Mat> &samples);
 
     /**
      * The index file contains the paths of images to be loaded.
      */
-    static bool fromIndexFile(const std::string &indexPath, std::vector<LabeledExample> &samples, Classification c);
+    static bool fromIndexFile(const std::string &indexPath, std::vector<LabeledExample> &samples, Classification c, const bool withIntegralSquare = true);
 
-    static bool fromImageFile(const std::string &imagePath, std::vector<LabeledExample> &samples, Classification c);
+    static bool fromImageFile(const std::string &imagePath, std::vector<LabeledExample> &samples, Classification c, const bool withIntegralSquare = true);
 
     static bool fromImageFile(const std::string &imagePath, std::vector<cv::Mat> &samples);
 
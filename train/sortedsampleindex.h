@@ -0,0 +1,108 @@
+#ifndef SORTEDSAMPLEINDEX_H
+#define SORTEDSAMPLEINDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <tbb/tbb.h>
+
+#include "common.h"
+#include "featurevaluematrix.h"
+
+
+
+/**
+ * Holds, for each feature, the indexes of the samples sorted by increasing feature value.
+ * The order depends only on the feature values, never on the weights, so it is built once
+ * and every boosting round just walks it linearly (Viola and Jones 2004, section 3.1).
+ */
+class SortedSampleIndex
+{
+public:
+    SortedSampleIndex() : total_samples(0),
+                          indexes() {}
+
+
+
+    /**
+     * Sorts the samples of each feature in parallel.
+     */
+    void compute(const FeatureValueMatrix & featureValues)
+    {
+        total_samples = featureValues.samples();
+        indexes.resize( (std::size_t)featureValues.features() * total_samples );
+
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, featureValues.features()),
+                           Sort(*this, featureValues) );
+    }
+
+    void clear()
+    {
+        total_samples = 0;
+        indexes.clear();
+    }
+
+
+
+    /**
+     * Returns the sample indexes of the j-th feature, ordered by increasing feature value.
+     */
+    const unsigned int * order(const unsigned int j) const
+    {
+        return &indexes[0] + (std::size_t)j * total_samples;
+    }
+
+    bool empty() const
+    {
+        return indexes.empty();
+    }
+
+private:
+
+    /**
+     * Compares sample indexes through their feature values.
+     */
+    struct ByFeatureValue
+    {
+        const feature_value_type * values;
+
+        ByFeatureValue(const feature_value_type * values_) : values(values_) {}
+
+        bool operator()(const unsigned int a, const unsigned int b) const
+        {
+            return values[a] < values[b];
+        }
+    };
+
+
+
+    struct Sort
+    {
+        SortedSampleIndex        & index;
+        const FeatureValueMatrix & featureValues;
+
+        Sort(SortedSampleIndex & index_, const FeatureValueMatrix & featureValues_) : index(index_),
+                                                                                        featureValues(featureValues_) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range) const
+        {
+            for (unsigned int j = range.begin(); j < range.end(); ++j)
+            {
+                unsigned int * const begin = &index.indexes[0] + (std::size_t)j * index.total_samples;
+                unsigned int * const end = begin + index.total_samples;
+
+                for (unsigned int i = 0; i < index.total_samples; ++i)
+                {
+                    begin[i] = i;
+                }
+                std::sort(begin, end, ByFeatureValue(featureValues.row(j)));
+            }
+        }
+    };
+
+    unsigned int total_samples;
+    std::vector<unsigned int, tbb::cache_aligned_allocator<unsigned int> > indexes;
+};
+
+
+
+#endif // SORTEDSAMPLEINDEX_H
@@ -0,0 +1,276 @@
+#include "stumpscan.h"
+
+#include <limits>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STUMPSCAN_X86
+#include <immintrin.h>
+#endif
+
+
+
+namespace
+{
+
+/**
+ * The best split found by a kernel. An index of -1 means no split beat min(T+, T-).
+ */
+struct ScanResult
+{
+    weight_type error;
+    long index;
+    weight_type prefix;
+
+    ScanResult(const weight_type error_, const long index_, const weight_type prefix_) : error(error_),
+                                                                                         index(index_),
+                                                                                         prefix(prefix_) {}
+};
+
+
+
+/**
+ * Scans samples [first, size), given the prefix sum of the signed weights up to first.
+ * This is Viola and Jones' scan (2004, section 3.1); see also Schapire and Freund's
+ * Boosting book, chapter 3.4.2.
+ */
+void scalarScan(const feature_value_type * values,
+                const weight_type * signed_weights,
+                const std::size_t first,
+                const std::size_t size,
+                const weight_type total_positive,
+                const weight_type total_negative,
+                weight_type prefix,
+                ScanResult & best)
+{
+    for (std::size_t k = first; k < size; ++k)
+    {
+        prefix += signed_weights[k];
+
+        if ( k < size - 1 && values[k] == values[k+1] )
+        {
+            continue;
+        }
+
+        const weight_type error = std::min(total_negative + prefix, total_positive - prefix);
+        if (error < best.error)
+        {
+            best = ScanResult(error, k, prefix);
+        }
+    }
+}
+
+
+
+#ifdef STUMPSCAN_X86
+
+/**
+ * Merges the per lane minimums of a vector kernel into best. Lanes hold increasing indexes,
+ * so ties go to the lowest index, as in the scalar kernel.
+ */
+void mergeLanes(const float * errors, const int * indexes, const float * prefixes, const int lanes, ScanResult & best)
+{
+    int lane = -1;
+    for (int l = 0; l < lanes; ++l)
+    {
+        if ( indexes[l] >= 0
+             && (lane < 0 || errors[l] < errors[lane] || (errors[l] == errors[lane] && indexes[l] < indexes[lane])) )
+        {
+            lane = l;
+        }
+    }
+
+    if (lane >= 0 && errors[lane] < best.error)
+    {
+        best = ScanResult(errors[lane], indexes[lane], prefixes[lane]);
+    }
+}
+
+
+
+__attribute__((target("sse2")))
+ScanResult sseScan(const feature_value_type * values,
+                   const weight_type * signed_weights,
+                   const std::size_t size,
+                   const weight_type total_positive,
+                   const weight_type total_negative)
+{
+    ScanResult best(std::min(total_negative, total_positive), -1, 0);
+
+    const __m128 infinity  = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    const __m128 negatives = _mm_set1_ps(total_negative);
+    const __m128 positives = _mm_set1_ps(total_positive);
+
+    __m128  offset       = _mm_setzero_ps();
+    __m128  best_error   = infinity;
+    __m128  best_prefix  = _mm_setzero_ps();
+    __m128i best_index   = _mm_set1_epi32(-1);
+    __m128i index        = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i stride = _mm_set1_epi32(4);
+
+    std::size_t k = 0;
+    for (; k + 4 < size; k += 4) //values[k + 4] must exist
+    {
+        //In-register inclusive prefix sum
+        __m128 prefix = _mm_loadu_ps(signed_weights + k);
+        prefix = _mm_add_ps(prefix, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(prefix), 4)));
+        prefix = _mm_add_ps(prefix, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(prefix), 8)));
+        prefix = _mm_add_ps(prefix, offset);
+        offset = _mm_shuffle_ps(prefix, prefix, _MM_SHUFFLE(3, 3, 3, 3));
+
+        //Only split between distinct values
+        const __m128 valid = _mm_cmpneq_ps(_mm_loadu_ps(values + k), _mm_loadu_ps(values + k + 1));
+
+        __m128 error = _mm_min_ps(_mm_add_ps(negatives, prefix), _mm_sub_ps(positives, prefix));
+        error = _mm_or_ps(_mm_and_ps(valid, error), _mm_andnot_ps(valid, infinity));
+
+        const __m128 better = _mm_cmplt_ps(error, best_error);
+        best_error  = _mm_or_ps(_mm_and_ps(better, error),  _mm_andnot_ps(better, best_error));
+        best_prefix = _mm_or_ps(_mm_and_ps(better, prefix), _mm_andnot_ps(better, best_prefix));
+        best_index  = _mm_or_si128(_mm_and_si128(_mm_castps_si128(better), index),
+                                   _mm_andnot_si128(_mm_castps_si128(better), best_index));
+
+        index = _mm_add_epi32(index, stride);
+    }
+
+    float errors[4], prefixes[4];
+    int indexes[4];
+    _mm_storeu_ps(errors, best_error);
+    _mm_storeu_ps(prefixes, best_prefix);
+    _mm_storeu_si128((__m128i *)indexes, best_index);
+    mergeLanes(errors, indexes, prefixes, 4, best);
+
+    scalarScan(values, signed_weights, k, size, total_positive, total_negative, _mm_cvtss_f32(offset), best);
+
+    return best;
+}
+
+
+
+__attribute__((target("avx2")))
+ScanResult avx2Scan(const feature_value_type * values,
+                    const weight_type * signed_weights,
+                    const std::size_t size,
+                    const weight_type total_positive,
+                    const weight_type total_negative)
+{
+    ScanResult best(std::min(total_negative, total_positive), -1, 0);
+
+    const __m256 infinity  = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 negatives = _mm256_set1_ps(total_negative);
+    const __m256 positives = _mm256_set1_ps(total_positive);
+    const __m256i last     = _mm256_set1_epi32(7);
+
+    __m256  offset       = _mm256_setzero_ps();
+    __m256  best_error   = infinity;
+    __m256  best_prefix  = _mm256_setzero_ps();
+    __m256i best_index   = _mm256_set1_epi32(-1);
+    __m256i index        = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i stride = _mm256_set1_epi32(8);
+
+    std::size_t k = 0;
+    for (; k + 8 < size; k += 8) //values[k + 8] must exist
+    {
+        //In-register inclusive prefix sum: within each 128 bit lane, then carry the low lane into the high one
+        __m256 prefix = _mm256_loadu_ps(signed_weights + k);
+        prefix = _mm256_add_ps(prefix, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(prefix), 4)));
+        prefix = _mm256_add_ps(prefix, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(prefix), 8)));
+        const __m128 low = _mm256_castps256_ps128(prefix);
+        const __m128 carry = _mm_shuffle_ps(low, low, _MM_SHUFFLE(3, 3, 3, 3));
+        prefix = _mm256_add_ps(prefix, _mm256_insertf128_ps(_mm256_setzero_ps(), carry, 1));
+        prefix = _mm256_add_ps(prefix, offset);
+        offset = _mm256_permutevar8x32_ps(prefix, last);
+
+        //Only split between distinct values
+        const __m256 valid = _mm256_cmp_ps(_mm256_loadu_ps(values + k), _mm256_loadu_ps(values + k + 1), _CMP_NEQ_UQ);
+
+        __m256 error = _mm256_min_ps(_mm256_add_ps(negatives, prefix), _mm256_sub_ps(positives, prefix));
+        error = _mm256_blendv_ps(infinity, error, valid);
+
+        const __m256 better = _mm256_cmp_ps(error, best_error, _CMP_LT_OQ);
+        best_error  = _mm256_blendv_ps(best_error, error, better);
+        best_prefix = _mm256_blendv_ps(best_prefix, prefix, better);
+        best_index  = _mm256_blendv_epi8(best_index, index, _mm256_castps_si256(better));
+
+        index = _mm256_add_epi32(index, stride);
+    }
+
+    float errors[8], prefixes[8];
+    int indexes[8];
+    _mm256_storeu_ps(errors, best_error);
+    _mm256_storeu_ps(prefixes, best_prefix);
+    _mm256_storeu_si256((__m256i *)indexes, best_index);
+    mergeLanes(errors, indexes, prefixes, 8, best);
+
+    scalarScan(values, signed_weights, k, size, total_positive, total_negative, _mm256_cvtss_f32(offset), best);
+
+    return best;
+}
+
+#endif // STUMPSCAN_X86
+
+} //namespace
+
+
+
+bool isStumpScanKernelSupported(const StumpScanKernel kernel)
+{
+    switch (kernel)
+    {
+    case scalarStumpScan:
+        return true;
+#ifdef STUMPSCAN_X86
+    case sseStumpScan:
+        return __builtin_cpu_supports("sse2");
+    case avx2StumpScan:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+
+
+StumpScanKernel bestStumpScanKernel()
+{
+    static const StumpScanKernel best = isStumpScanKernelSupported(avx2StumpScan) ? avx2StumpScan :
+                                        isStumpScanKernelSupported(sseStumpScan)  ? sseStumpScan  :
+                                                                                    scalarStumpScan;
+    return best;
+}
+
+
+
+weight_type scanStumpThreshold(const feature_value_type * values,
+                               const weight_type * signed_weights,
+                               const std::size_t size,
+                               const weight_type total_positive,
+                               const weight_type total_negative,
+                               feature_value_type & threshold,
+                               Classification & polarity,
+                               const StumpScanKernel kernel)
+{
+    ScanResult best(std::min(total_negative, total_positive), -1, 0);
+
+    switch (kernel)
+    {
+#ifdef STUMPSCAN_X86
+    case avx2StumpScan:
+        best = avx2Scan(values, signed_weights, size, total_positive, total_negative);
+        break;
+    case sseStumpScan:
+        best = sseScan(values, signed_weights, size, total_positive, total_negative);
+        break;
+#endif
+    default:
+        scalarScan(values, signed_weights, 0, size, total_positive, total_negative, 0, best);
+        break;
+    }
+
+    //The prefix sum is S+ - S-: classify as positive the samples below the threshold if S- <= S+
+    threshold = size && best.index >= 0 ? values[best.index] : (size ? values[0] : 0);
+    polarity = best.prefix >= 0 ? yes : no;
+
+    return best.error;
+}
@@ -0,0 +1,103 @@
+#ifndef STUMPSCAN_H
+#define STUMPSCAN_H
+
+#include <vector>
+#include <cstddef>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include "common.h"
+
+
+
+/**
+ * The implementations of the decision stump threshold scan.
+ */
+enum StumpScanKernel
+{
+    scalarStumpScan, //portable C++
+    sseStumpScan,    //4 samples at a time, x86 SSE2
+    avx2StumpScan    //8 samples at a time, x86 AVX2
+};
+
+//The SSE2 and AVX2 kernels load feature values and weights as packed single precision floats
+BOOST_STATIC_ASSERT((boost::is_same<weight_type, float>::value));
+BOOST_STATIC_ASSERT((boost::is_same<feature_value_type, float>::value));
+
+
+
+/**
+ * Returns the fastest kernel the running processor supports. It is detected once, at runtime.
+ */
+StumpScanKernel bestStumpScanKernel();
+
+/**
+ * Returns true if the running processor supports the kernel.
+ */
+bool isStumpScanKernelSupported(const StumpScanKernel kernel);
+
+
+
+/**
+ * Finds the decision stump threshold and polarity with the lowest weighted error.
+ *
+ * The samples are given as a structure of arrays sorted by increasing feature value:
+ * their values and their signed weights (+weight for positive samples, -weight for the
+ * negative ones). Thresholds are only evaluated between distinct values. With S the sum
+ * of the signed weights up to a threshold, the error of classifying as positive the
+ * samples below it is T- + S, and the error of the opposite polarity is T+ - S, so
+ * the scan is a prefix sum followed by a min/argmin, without branches on the labels.
+ *
+ * @param values the feature values, sorted.
+ * @param signed_weights the weight of each sample, negated for negative samples.
+ * @param size the amount of samples.
+ * @param total_positive the total weight of the positive samples (Viola and Jones' T+).
+ * @param total_negative the total weight of the negative samples (Viola and Jones' T-).
+ * @param threshold output parameter. The selected threshold.
+ * @param polarity output parameter. The selected polarity.
+ * @param kernel the implementation to use. It must be supported by the processor.
+ * @return the weighted error of the selected threshold and polarity.
+ */
+weight_type scanStumpThreshold(const feature_value_type * values,
+                               const weight_type * signed_weights,
+                               const std::size_t size,
+                               const weight_type total_positive,
+                               const weight_type total_negative,
+                               feature_value_type & threshold,
+                               Classification & polarity,
+                               const StumpScanKernel kernel = bestStumpScanKernel());
+
+
+
+/**
+ * Structure of arrays input of scanStumpThreshold(), reusable across features.
+ */
+struct StumpScanBuffer
+{
+    std::vector<feature_value_type> values;
+    std::vector<weight_type> signed_weights;
+
+    void resize(const std::size_t size)
+    {
+        values.resize(size);
+        signed_weights.resize(size);
+    }
+
+    std::size_t size() const
+    {
+        return values.size();
+    }
+
+    weight_type scan(const weight_type total_positive,
+                     const weight_type total_negative,
+                     feature_value_type & threshold,
+                     Classification & polarity) const
+    {
+        return scanStumpThreshold(&values[0], &signed_weights[0], values.size(),
+                                  total_positive, total_negative, threshold, polarity);
+    }
+};
+
+
+
+#endif // STUMPSCAN_H
@@ -0,0 +1,202 @@
+#ifndef TEMPLATE_CALIBRATETRACE_H
+#define TEMPLATE_CALIBRATETRACE_H
+
+
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include <tbb/tbb.h>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "stronghypothesis.h"
+#include "sampleextractor.h"
+#include "template_trainclassifier.h"
+
+
+
+/**
+ * Computes the sums of the first k + 1 weighted votes of a strong hypothesis for every sample
+ * and k, adding them up in the order StrongHypothesis::classificationValue does.
+ */
+template<typename WeakHypothesisType>
+struct PartialSums
+{
+    const StrongHypothesis<WeakHypothesisType> & strongHypothesis;
+    const std::vector<LabeledExample> & samples;
+    std::vector<float> & sums; //samples.size() rows of strongHypothesis.size() sums
+
+    PartialSums(const StrongHypothesis<WeakHypothesisType> & strongHypothesis_,
+                const std::vector<LabeledExample> & samples_,
+                std::vector<float> & sums_) : strongHypothesis(strongHypothesis_),
+                                              samples(samples_),
+                                              sums(sums_) {}
+
+    void operator()(const tbb::blocked_range< std::size_t > & range) const
+    {
+        const std::size_t T = strongHypothesis.size();
+        for (std::size_t i = range.begin(); i < range.end(); ++i)
+        {
+            float result = .0f;
+            for (std::size_t k = 0; k < T; ++k)
+            {
+                result += strongHypothesis.alpha(k) * strongHypothesis.weakHypothesis(k).classify(samples[i]);
+                sums[i * T + k] = result;
+            }
+        }
+    }
+};
+
+
+
+/**
+ * Calibrates a soft cascade rejection trace by direct backward pruning (Zhang and Viola 2007):
+ * of the validation positives the strong hypothesis accepts with all its votes, the
+ * detectionRate fraction of all positives with the highest final scores is kept, and each
+ * rejection value is the least partial sum among them. Those positives are never rejected
+ * early, so the trace costs at most the positives not kept, while negatives are rejected as
+ * soon as their partial sums fall below every kept positive's.
+ */
+template<typename WeakHypothesisType>
+std::vector<float> calibrateRejectionTrace(const StrongHypothesis<WeakHypothesisType> & strongHypothesis,
+                                           const std::vector<LabeledExample> & positives,
+                                           const float detectionRate)
+{
+    const std::size_t T = strongHypothesis.size();
+    std::vector<float> sums(positives.size() * T);
+    tbb::parallel_for( tbb::blocked_range< std::size_t >(0, positives.size()),
+                       PartialSums<WeakHypothesisType>(strongHypothesis, positives, sums) );
+
+    //The final scores of the positives accepted, paired with their indexes
+    std::vector< std::pair<float, std::size_t> > accepted;
+    for (std::size_t i = 0; i < positives.size(); ++i)
+    {
+        if ( T > 0 && sums[i * T + T - 1] >= strongHypothesis.getThreshold() )
+        {
+            accepted.push_back( std::make_pair(sums[i * T + T - 1], i) );
+        }
+    }
+    std::sort( accepted.begin(), accepted.end(), std::greater< std::pair<float, std::size_t> >() );
+    accepted.resize( std::min(accepted.size(), (std::size_t)(detectionRate * positives.size() + 0.5f)) );
+
+    std::vector<float> trace;
+    if ( accepted.empty() )
+    {
+        return trace;
+    }
+
+    trace.assign(T, std::numeric_limits<float>::max());
+    for (std::size_t j = 0; j < accepted.size(); ++j)
+    {
+        const float * partial = &sums[accepted[j].second * T];
+        for (std::size_t k = 0; k < T; ++k)
+        {
+            trace[k] = std::min(trace[k], partial[k]);
+        }
+    }
+
+    return trace;
+}
+
+
+
+/**
+ * Classifies the samples with a strong hypothesis.
+ * @param accepted set to how many samples the strong hypothesis accepts.
+ * @return the average amount of weak hypothesis evaluated per sample.
+ */
+template<typename WeakHypothesisType>
+double evaluateRejectionTrace(const StrongHypothesis<WeakHypothesisType> & strongHypothesis,
+                              const std::vector<LabeledExample> & samples,
+                              std::size_t & accepted)
+{
+    unsigned long evaluations = 0;
+    accepted = 0;
+    for (std::vector<LabeledExample>::const_iterator it = samples.begin(); it != samples.end(); ++it)
+    {
+        unsigned int evaluated;
+        accepted += strongHypothesis.classificationValue(*it, 1.0f, evaluated) >= strongHypothesis.getThreshold();
+        evaluations += evaluated;
+    }
+
+    return samples.empty() ? 0 : (double)evaluations / samples.size();
+}
+
+
+
+template<typename WeakHypothesisType>
+int ___calibrate_main(const std::string strongHypothesisFile,
+                      const std::string positivesFile,
+                      const std::string rejectionTraceFile,
+                      const std::vector<std::string> & options)
+{
+    StrongHypothesis<WeakHypothesisType> strongHypothesis;
+    {
+        std::ifstream in(strongHypothesisFile.c_str());
+        if ( !in.is_open() )
+        {
+            return 7;
+        }
+        if ( !strongHypothesis.read(in) )
+        {
+            return 11;
+        }
+    }
+    float threshold = 0, detectionRate = 0.99f;
+    std::stringstream(optionValue(options, "--threshold")) >> threshold;
+    std::stringstream(optionValue(options, "--detection-rate")) >> detectionRate;
+    strongHypothesis.setThreshold(threshold);
+    std::cout << "Loaded " << strongHypothesis.size() << " classifiers from " << strongHypothesisFile << " with threshold " << threshold << '.' << std::endl;
+
+    std::vector<LabeledExample> positives, negatives;
+    if ( !SampleExtractor::fromImageFile(positivesFile, positives, yes, WeakHypothesisType::needs_integral_square) )
+    {
+        return 13;
+    }
+    if ( hasOption(options, "--negatives")
+         && !SampleExtractor::extractSamplesWithIndex(optionValue(options, "--negatives"), optionValue(options, "--index"), negatives, no, WeakHypothesisType::needs_integral_square) )
+    {
+        return 17;
+    }
+
+    std::size_t detectedBefore, falsePositivesBefore;
+    evaluateRejectionTrace(strongHypothesis, positives, detectedBefore);
+    evaluateRejectionTrace(strongHypothesis, negatives, falsePositivesBefore);
+
+    strongHypothesis.setRejectionTrace( calibrateRejectionTrace(strongHypothesis, positives, detectionRate) );
+    if ( strongHypothesis.getRejectionTrace().empty() )
+    {
+        std::cout << "No positive sample is accepted with threshold " << threshold << '.' << std::endl;
+        return 19;
+    }
+
+    std::size_t detected, falsePositives;
+    const double positiveEvaluations = evaluateRejectionTrace(strongHypothesis, positives, detected);
+    const double negativeEvaluations = evaluateRejectionTrace(strongHypothesis, negatives, falsePositives);
+    std::cout << "Detected " << detected << " of " << positives.size() << " positives (" << detectedBefore << " without the trace), "
+              << positiveEvaluations << " weak classifiers evaluated per positive." << std::endl;
+    if ( !negatives.empty() )
+    {
+        std::cout << "Accepted " << falsePositives << " of " << negatives.size() << " negatives (" << falsePositivesBefore << " without the trace), "
+                  << negativeEvaluations << " weak classifiers evaluated per negative." << std::endl;
+    }
+
+    std::ofstream out(rejectionTraceFile.c_str());
+    if ( !out.is_open() || !strongHypothesis.writeRejectionTrace(out) )
+    {
+        return 23;
+    }
+
+    return 0;
+}
+
+
+
+#endif // TEMPLATE_CALIBRATETRACE_H
@@ -0,0 +1,126 @@
+#ifndef TEMPLATE_TRAINCASCADE_H
+#define TEMPLATE_TRAINCASCADE_H
+
+
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "common.h"
+#include "cascade.h"
+#include "cascadetrainer.h"
+#include "negativeminer.h"
+#include "template_trainclassifier.h"
+
+
+
+/**
+ * Moves a random fraction of the samples to the validation set.
+ */
+void splitValidation(std::vector<LabeledExample> & samples,
+                     const float fraction,
+                     const boost::uint32_t seed,
+                     std::vector<LabeledExample> & validation)
+{
+    boost::random::mt19937 rng(seed);
+    for (std::size_t i = samples.size(); i > 1; --i)
+    {
+        boost::random::uniform_int_distribution<std::size_t> pick(0, i - 1);
+        std::swap(samples[i - 1], samples[ pick(rng) ]);
+    }
+
+    const std::size_t count = (std::size_t)(fraction * samples.size());
+    validation.assign(samples.end() - count, samples.end());
+    samples.erase(samples.end() - count, samples.end());
+}
+
+
+
+template<typename WeakHypothesisType, typename WeakLearnerType>
+int ___cascade_main(const std::string positivesFile,
+                    const std::string negativesFile,
+                    const std::string negativesIndexFile,
+                    const std::string waveletsFile,
+                    const std::string cascadeFile,
+                    const unsigned int maximumStages,
+                    const unsigned int maximumStageRounds,
+                    const std::vector<std::string> & options)
+{
+    Adaboost<WeakHypothesisType, WeakLearnerType > boosting;
+    if ( !setBoostingOptions(boosting, options) )
+    {
+        return 37;
+    }
+
+    std::vector<LabeledExample> positiveSamples, negativeSamples;
+    std::vector<WeakHypothesisType> hypothesis;
+    const int loaded = loadTrainingData(positivesFile, negativesFile, negativesIndexFile, waveletsFile, positiveSamples, negativeSamples, hypothesis);
+    if (loaded)
+    {
+        return loaded;
+    }
+
+    float detectionRate = 0.995f, falsePositiveRate = 0.5f, target = 0.0f, validation = 0.25f;
+    unsigned int seed = 0;
+    std::stringstream(optionValue(options, "--detection-rate")) >> detectionRate;
+    std::stringstream(optionValue(options, "--false-positive-rate")) >> falsePositiveRate;
+    std::stringstream(optionValue(options, "--target")) >> target;
+    std::stringstream(optionValue(options, "--validation")) >> validation;
+    std::stringstream(optionValue(options, "--seed")) >> seed;
+
+    std::vector<LabeledExample> validationPositives, validationNegatives;
+    splitValidation(positiveSamples, validation, seed, validationPositives);
+    splitValidation(negativeSamples, validation, seed, validationNegatives);
+    std::cout << "Validating on " << validationPositives.size() << " positive and " << validationNegatives.size() << " negative samples." << std::endl;
+
+    Cascade<WeakHypothesisType> cascade;
+    CascadeTrainer<WeakHypothesisType, WeakLearnerType> trainer(boosting, detectionRate, falsePositiveRate, target, maximumStages, maximumStageRounds);
+
+    boost::scoped_ptr< NegativeMiner<WeakHypothesisType> > miner;
+    if ( hasOption(options, "--backgrounds") )
+    {
+        float scale = 1.25f;
+        int step = 2, perImage = 100;
+        std::stringstream(optionValue(options, "--scale")) >> scale;
+        std::stringstream(optionValue(options, "--step")) >> step;
+        std::stringstream(optionValue(options, "--per-image")) >> perImage;
+
+        //The samples SampleExtractor loads are all 20x20
+        miner.reset( new NegativeMiner<WeakHypothesisType>(optionValue(options, "--backgrounds"), 20, scale, step, perImage) );
+        if ( miner->size() == 0 )
+        {
+            std::cout << "No background images in " << optionValue(options, "--backgrounds") << std::endl;
+            return 32;
+        }
+        trainer.setNegativeMiner(miner.get());
+    }
+    try {
+        if ( !trainer.train(positiveSamples,
+                            negativeSamples,
+                            validationPositives,
+                            validationNegatives,
+                            hypothesis,
+                            cascade,
+                            cascadeFile) )
+        {
+            return 31;
+        }
+    } catch (int e) {
+        std::cout << "Erro durante a execução do treinamento. Número do erro: " << e << std::endl;
+        return e;
+    }
+
+    return 0;
+}
+
+
+
+#endif // TEMPLATE_TRAINCASCADE_H
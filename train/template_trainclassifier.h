@@ -4,7 +4,11 @@
 
 
 #include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
 #include <iostream>
+#include <algorithm>
 
 #include <opencv2/core/core.hpp>
 
@@ -12,49 +16,253 @@
 #include "weakhypothesis.h"
 #include "weaklearner.h"
 #include "sampleextractor.h"
+#include "samplestore.h"
 #include "stronghypothesis.h"
 #include "adaboost.h"
+#include "checkpoint.h"
 
 
 
+/**
+ * Returns true if the flag is among the optional command line arguments.
+ */
+bool hasOption(const std::vector<std::string> & options, const std::string & flag)
+{
+    return std::find(options.begin(), options.end(), flag) != options.end();
+}
+
+
+
+/**
+ * Returns the argument that follows the flag among the optional command line arguments,
+ * or an empty string if the flag was not given.
+ */
+std::string optionValue(const std::vector<std::string> & options, const std::string & flag)
+{
+    std::vector<std::string>::const_iterator it = std::find(options.begin(), options.end(), flag);
+    if ( it == options.end() || ++it == options.end() )
+    {
+        return std::string();
+    }
+    return *it;
+}
+
+
+
+/**
+ * Loads the training samples and the weak hypothesis pool.
+ * @return zero, or the exit code of the training tools if the samples could not be loaded.
+ */
+template<typename WeakHypothesisType>
+int loadTrainingData(const std::string & positivesFile,
+                     const std::string & negativesFile,
+                     const std::string & negativesIndexFile,
+                     const std::string & waveletsFile,
+                     std::vector<LabeledExample> & positiveSamples,
+                     std::vector<LabeledExample> & negativeSamples,
+                     std::vector<WeakHypothesisType> & hypothesis)
+{
+    if ( !SampleExtractor::fromImageFile(positivesFile, positiveSamples, yes, WeakHypothesisType::needs_integral_square) )
+    {
+        return 13;
+    }
+    std::cout << "Loaded " << positiveSamples.size() << " positive samples." << std::endl;
+
+    //Viola and Jones state they used "6000 such non-face sub-windows" while building the cascade (2004, section 5.2).
+    //On section 4.2 they show a different "simple experiment".
+    if ( !SampleExtractor::extractSamplesWithIndex(negativesFile, negativesIndexFile, negativeSamples, no, WeakHypothesisType::needs_integral_square) )
+    {
+        return 17;
+    }
+    std::cout << "Loaded " << negativeSamples.size() << " negative samples." << std::endl;
+
+    //A binary pool that fails its checksums is not loaded at all
+    if ( !loadHaarClassifiers(waveletsFile, hypothesis) )
+    {
+        return 19;
+    }
+    std::cout << "Loaded " << hypothesis.size() << " weak classifiers." << std::endl;
+
+    return 0;
+}
+
+
+
+/**
+ * Loads the training samples straight into a SampleStore, positive ones first, so that they
+ * take the memory of the store only, and the weak hypothesis pool.
+ * @return zero, or the exit code of the training tools if the samples could not be loaded.
+ */
+template<typename WeakHypothesisType>
+int loadTrainingData(const std::string & positivesFile,
+                     const std::string & negativesFile,
+                     const std::string & negativesIndexFile,
+                     const std::string & waveletsFile,
+                     SampleStore & samples,
+                     std::vector<WeakHypothesisType> & hypothesis)
+{
+    //The images are regions of the files, which are kept until the integrals are computed
+    std::vector<cv::Mat> images, negativeImages;
+    if ( !SampleExtractor::fromImageFile(positivesFile, images) )
+    {
+        return 13;
+    }
+    std::cout << "Loaded " << images.size() << " positive samples." << std::endl;
+
+    if ( !SampleExtractor::extractSamplesWithIndex(negativesFile, negativesIndexFile, negativeImages) )
+    {
+        return 17;
+    }
+    std::cout << "Loaded " << negativeImages.size() << " negative samples." << std::endl;
+
+    std::vector<Classification> labels(images.size(), yes);
+    labels.resize(images.size() + negativeImages.size(), no);
+    images.insert(images.end(), negativeImages.begin(), negativeImages.end());
+    samples.assign<typename WeakHypothesisType::integrals_type>(images, labels, WeakHypothesisType::needs_integral_square);
+
+    //A binary pool that fails its checksums is not loaded at all
+    if ( !loadHaarClassifiers(waveletsFile, hypothesis) )
+    {
+        return 19;
+    }
+    std::cout << "Loaded " << hypothesis.size() << " weak classifiers." << std::endl;
+
+    return 0;
+}
+
+
+
+/**
+ * Sets the options of Adaboost given on the command line that do not depend on the output file.
+ * @return false if an option asks for feature values or sorted samples the weak learner would not read.
+ */
+template<typename WeakHypothesisType, typename WeakLearnerType>
+bool setBoostingOptions(Adaboost<WeakHypothesisType, WeakLearnerType> & boosting, const std::vector<std::string> & options)
+{
+    if ( (!WeakLearnerType::reads_feature_values && (hasOption(options, "--precompute") || hasOption(options, "--cache")))
+         || (!WeakLearnerType::reads_sorted_samples && hasOption(options, "--presort")) )
+    {
+        std::cout << "This weak learner does not read precomputed feature values or sorted samples: "
+                     "--precompute, --presort and --cache would only cost time and memory." << std::endl;
+        return false;
+    }
+
+    boosting.setPrecomputeFeatureValues( hasOption(options, "--precompute") );
+    boosting.setPresortSamples( hasOption(options, "--presort") );
+    boosting.setFeatureValueCacheFile( optionValue(options, "--cache") );
+    unsigned int seed = 0;
+    std::stringstream(optionValue(options, "--seed")) >> seed;
+    if ( hasOption(options, "--resample") )
+    {
+        unsigned int size = 0;
+        std::stringstream(optionValue(options, "--resample")) >> size;
+        boosting.setResampling(size, seed);
+    }
+    if ( hasOption(options, "--trim") )
+    {
+        weight_type beta = 0;
+        std::stringstream(optionValue(options, "--trim")) >> beta;
+        boosting.setWeightTrimming(beta);
+    }
+    if ( hasOption(options, "--features") )
+    {
+        float fraction = 1.0f;
+        unsigned int keep = 0;
+        std::stringstream(optionValue(options, "--features")) >> fraction;
+        std::stringstream(optionValue(options, "--keep")) >> keep;
+        boosting.setFeatureSampling(fraction, keep, seed);
+    }
+
+    return true;
+}
+
+
+
+/**
+ * Trains a strong hypothesis and writes it to strongHypothesisFile.
+ *
+ * With --continue, boosting goes on from the entries of strongHypothesisFile and of the journal
+ * an interrupted training left next to it. --resume does the same, then takes the boosting state
+ * from the --checkpoint file of that training (see Adaboost::setResume()). Both load the entries
+ * before strongHypothesisFile is rewritten, which starts a new journal: otherwise the rounds the
+ * old journal holds past the last checkpoint would be lost. --resume without a readable
+ * checkpoint stops before anything is written.
+ */
 template<typename WeakHypothesisType, typename WeakLearnerType>
 int ___main(const std::string positivesFile,
            const std::string negativesFile,
            const std::string negativesIndexFile,
            const std::string waveletsFile,
            const std::string strongHypothesisFile,
-           const unsigned int maximum_iterations)
+           const unsigned int maximum_iterations,
+           const std::vector<std::string> & options)
 {
-    StrongHypothesis<WeakHypothesisType> strongHypothesis(strongHypothesisFile);
+    //Options are checked before the strong hypothesis file is touched
+    Adaboost<WeakHypothesisType, WeakLearnerType > boosting;
+    if ( !setBoostingOptions(boosting, options) )
+    {
+        return 37;
+    }
 
-    std::vector<LabeledExample> positiveSamples, negativeSamples;
+    const bool resume = hasOption(options, "--resume");
+    if ( resume )
     {
-        if ( !SampleExtractor::fromImageFile(positivesFile, positiveSamples, yes) )
+        TrainingCheckpoint checkpoint;
+        if ( !checkpoint.read(optionValue(options, "--checkpoint")) )
         {
-            return 13;
+            std::cout << "--resume needs the --checkpoint file of the interrupted training." << std::endl;
+            return 41;
         }
-        std::cout << "Loaded " << positiveSamples.size() << " positive samples." << std::endl;
+    }
 
-        //Viola and Jones state they used "6000 such non-face sub-windows" while building the cascade (2004, section 5.2).
-        //On section 4.2 they show a different "simple experiment".
-        if ( !SampleExtractor::extractSamplesWithIndex(negativesFile, negativesIndexFile, negativeSamples, no) )
+    //Continuing a training: its entries are in the strong hypothesis file, or in the journal an interrupted training left behind
+    StrongHypothesis<WeakHypothesisType> strongHypothesis;
+    if ( resume || hasOption(options, "--continue") )
+    {
+        std::ifstream in(strongHypothesisFile.c_str());
+        if ( !in.is_open() )
+        {
+            return 29;
+        }
+        if ( in.peek() != std::ifstream::traits_type::eof() && !strongHypothesis.read(in) )
+        {
+            return 29;
+        }
+        in.close();
+        if ( !strongHypothesis.recover(strongHypothesisFile) )
         {
-            return 17;
+            std::cout << "Could not recover " << ModelJournal::journalPath(strongHypothesisFile) << '.' << std::endl;
+            return 29;
         }
-        std::cout << "Loaded " << negativeSamples.size() << " negative samples." << std::endl;
+        std::cout << "Loaded " << strongHypothesis.size() << " classifiers from " << strongHypothesisFile << '.' << std::endl;
     }
 
+    //The loaded entries are made durable in the strong hypothesis file before its old journal is replaced
+    try {
+        strongHypothesis.record(strongHypothesisFile);
+    } catch (int) {
+        std::cout << "Could not write " << strongHypothesisFile << '.' << std::endl;
+        return 23;
+    }
+
+    SampleStore samples;
     std::vector<WeakHypothesisType> hypothesis;
+    const int loaded = loadTrainingData(positivesFile, negativesFile, negativesIndexFile, waveletsFile, samples, hypothesis);
+    if (loaded)
     {
-        loadHaarClassifiers(waveletsFile, hypothesis);
-        std::cout << "Loaded " << hypothesis.size() << " weak classifiers." << std::endl;
+        return loaded;
     }
 
-    Adaboost<WeakHypothesisType, WeakLearnerType > boosting;
+    if ( hasOption(options, "--checkpoint") )
+    {
+        unsigned int every = 1;
+        std::stringstream(optionValue(options, "--every")) >> every;
+        boosting.setCheckpoint(optionValue(options, "--checkpoint"), every);
+    }
+    boosting.setResume(resume);
 
     try {
-        boosting.train(positiveSamples,
-                       negativeSamples,
+        boosting.train(samples,
                        strongHypothesis,
                        hypothesis,
                        maximum_iterations);
@@ -62,6 +270,14 @@ int ___main(const std::string positivesFile,
         std::cout << "Erro durante a execução do treinamento. Número do erro: " << e << std::endl;
     }
 
+    //Whatever was trained goes to the strong hypothesis file, even if training failed midway
+    if ( !strongHypothesis.compact() )
+    {
+        std::cout << "Could not write " << strongHypothesisFile << ". The trained classifiers are kept in "
+                  << ModelJournal::journalPath(strongHypothesisFile) << std::endl;
+        return 23;
+    }
+
     return 0;
 }
 
@@ -0,0 +1,251 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <opencv2/core/core.hpp>
+
+#include "common.h"
+#include "modeljournal.h"
+#include "stronghypothesis.h"
+#include "checkpoint.h"
+#include "template_trainclassifier.h"
+
+
+
+namespace
+{
+
+const std::string modelPath = "test_resume.model";
+const std::string checkpointPath = "test_resume.checkpoint";
+
+
+
+/**
+ * A weak hypothesis that is only written and read back, as the journal and checkpoints do.
+ */
+class Stump
+{
+public:
+    Stump() : feature(0),
+              theta(0) {}
+
+    Stump(const unsigned int feature_, const float theta_) : feature(feature_),
+                                                             theta(theta_) {}
+
+    bool read(std::istream & in)
+    {
+        in >> feature >> theta;
+        return !in.fail();
+    }
+
+    bool write(std::ostream & out) const
+    {
+        out << feature << ' ' << theta;
+        return true;
+    }
+
+private:
+    unsigned int feature;
+    float theta;
+};
+
+typedef StrongHypothesis<Stump> Model;
+
+
+
+/**
+ * The entry selected on round t, with more digits than the model file and its journal keep.
+ */
+weight_type alphaOf(const unsigned int t)
+{
+    return 0.1234567f * (t + 1);
+}
+
+Stump stumpOf(const unsigned int t)
+{
+    return Stump(7 * t, 1.0f / (t + 3));
+}
+
+
+
+/**
+ * Boosts rounds [begin, end), as Adaboost does: each entry is journaled as StrongHypothesis::insert()
+ * does, and a checkpoint is written every interval rounds.
+ */
+void train(ModelJournal & journal, TrainingCheckpoint & checkpoint, const unsigned int begin, const unsigned int end, const unsigned int interval)
+{
+    for (unsigned int t = begin; t < end; ++t)
+    {
+        journal.append( Model::entryLine(alphaOf(t), stumpOf(t)) );
+
+        checkpoint.alphas.push_back( alphaOf(t) );
+        checkpoint.weakHypothesis.push_back( TrainingCheckpoint::entry(stumpOf(t)) );
+        if ( (t + 1) % interval == 0 )
+        {
+            checkpoint.round = t + 1;
+            checkpoint.write(checkpointPath);
+        }
+    }
+}
+
+
+
+/**
+ * The entry of round t of a Viola-Jones training, as train_vj_classifier journals it.
+ */
+ViolaJonesClassifier classifierOf(const unsigned int t)
+{
+    std::vector<cv::Rect> rects;
+    std::vector<float> weights;
+    rects.push_back( cv::Rect(t, 0, 4, 8) );     weights.push_back(1);
+    rects.push_back( cv::Rect(t + 4, 0, 4, 8) ); weights.push_back(-1);
+    HaarWavelet wavelet(rects, weights);
+
+    ViolaJonesClassifier classifier(wavelet);
+    classifier.setThreshold(1.0f / (t + 3));
+    return classifier;
+}
+
+
+
+/**
+ * Runs train_vj_classifier on the model file. There are no samples to load, so ___main stops
+ * right after it rewrites the model file for training, which is what is checked here.
+ */
+int trainViolaJones(const std::vector<std::string> & options)
+{
+    return ___main<ViolaJonesClassifier, DecisionStumpWeakLearner<ViolaJonesClassifier> >(
+                "test_resume.positives",
+                "test_resume.negatives",
+                "test_resume.index",
+                "test_resume.wavelets",
+                modelPath,
+                10,
+                options);
+}
+
+
+
+std::string contents(const std::string & path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    return std::string( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+}
+
+
+
+int check(const char * const description, const bool passed)
+{
+    if (!passed)
+    {
+        std::cout << "FAILED " << description << '\n';
+    }
+    return !passed;
+}
+
+}
+
+
+
+/**
+ * Crashes a training between a journal flush and a checkpoint write, and checks which entries
+ * resuming it can take from the checkpoint (see TrainingCheckpoint::follows()), and that the
+ * training tools resume it without losing the rounds journaled past the checkpoint (see
+ * ___main()). Returns 2 if any check fails.
+ */
+int main() {
+    int failures = 0;
+
+    TrainingCheckpoint checkpoint;
+    checkpoint.features = 10;
+    checkpoint.weights.assign(4, .25f);
+
+    //Five rounds are journaled and flushed, but the last checkpoint was written on the third
+    {
+        ModelJournal journal(modelPath, std::string(), 0);
+        train(journal, checkpoint, 0, 5, 3);
+        failures += check("flushing the journal", journal.flush());
+    } //crash: the journal is not compacted into the model file
+
+    Model recovered;
+    TrainingCheckpoint read;
+    failures += check("recovering the journal", recovered.recover(modelPath) && recovered.size() == 5);
+    failures += check("reading the checkpoint", read.read(checkpointPath) && read.round == 3 && read.weakHypothesis.size() == 3);
+    failures += check("a checkpoint behind the journal does not follow it", !read.follows(recovered));
+
+    //Had the checkpoint been written, it would follow the journal, even though the journal is less precise
+    checkpoint.round = 5;
+    checkpoint.write(checkpointPath);
+    failures += check("a checkpoint as long as the journal follows it", read.read(checkpointPath) && read.follows(recovered));
+
+    //The journal lost the batch of its last record, but the checkpoint was written after that record
+    {
+        std::ifstream in(ModelJournal::journalPath(modelPath).c_str(), std::ios::binary);
+        std::string journal( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+        journal.erase( journal.rfind('\n', journal.size() - 2) + 1 );
+        in.close();
+        std::ofstream out(ModelJournal::journalPath(modelPath).c_str(), std::ios::binary | std::ios::trunc);
+        out << journal;
+    }
+    Model behind;
+    failures += check("recovering a journal that lost its last record", behind.recover(modelPath) && behind.size() == 4);
+    failures += check("a checkpoint ahead of the journal follows it", read.follows(behind));
+
+    //A checkpoint of another training
+    checkpoint.alphas[1] *= 2;
+    checkpoint.write(checkpointPath);
+    failures += check("a checkpoint of other entries does not follow them", read.read(checkpointPath) && !read.follows(recovered));
+
+    std::remove(modelPath.c_str());
+    std::remove(ModelJournal::journalPath(modelPath).c_str());
+    std::remove(checkpointPath.c_str());
+
+    //A train_vj_classifier run crashed the same way, checkpointing every three rounds
+    {
+        TrainingCheckpoint violaJones;
+        ModelJournal journal(modelPath, std::string(), 0);
+        for (unsigned int t = 0; t < 5; ++t)
+        {
+            journal.append( StrongHypothesis<ViolaJonesClassifier>::entryLine(alphaOf(t), classifierOf(t)) );
+            violaJones.alphas.push_back( alphaOf(t) );
+            violaJones.weakHypothesis.push_back( TrainingCheckpoint::entry(classifierOf(t)) );
+            if ( t + 1 == 3 )
+            {
+                violaJones.round = 3;
+                violaJones.write(checkpointPath);
+            }
+        }
+        failures += check("flushing the Viola-Jones journal", journal.flush());
+    }
+    const std::string journaled = contents(ModelJournal::journalPath(modelPath));
+
+    //Resuming without the checkpoint leaves the crashed run as it is
+    std::vector<std::string> options(1, "--resume");
+    failures += check("--resume without --checkpoint stops", trainViolaJones(options) == 41
+                                                             && contents(ModelJournal::journalPath(modelPath)) == journaled);
+    options.push_back("--checkpoint");
+    options.push_back("test_resume.missing");
+    failures += check("--resume without a readable checkpoint stops", trainViolaJones(options) == 41
+                                                                      && contents(ModelJournal::journalPath(modelPath)) == journaled);
+
+    //Resuming loads the journal before the model file is rewritten, so the rounds past the checkpoint are kept
+    options.back() = checkpointPath;
+    failures += check("--resume with the checkpoint goes on", trainViolaJones(options) != 41);
+    StrongHypothesis<ViolaJonesClassifier> resumed;
+    {
+        std::ifstream in(modelPath.c_str());
+        failures += check("reading the rewritten model file", in.is_open() && resumed.read(in));
+    }
+    failures += check("the rounds journaled past the checkpoint are kept", resumed.recover(modelPath) && resumed.size() == 5);
+
+    std::remove(modelPath.c_str());
+    std::remove(ModelJournal::journalPath(modelPath).c_str());
+    std::remove(checkpointPath.c_str());
+
+    std::cout << (failures ? "FAILED" : "PASSED") << std::endl;
+
+    return failures ? 2 : 0;
+}
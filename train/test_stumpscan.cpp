@@ -0,0 +1,166 @@
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+
+#include "common.h"
+#include "weaklearner.h"
+#include "stumpscan.h"
+
+
+
+namespace
+{
+
+const StumpScanKernel kernels[] = {scalarStumpScan, sseStumpScan, avx2StumpScan};
+const char * const names[] = {"scalar", "sse2", "avx2"};
+
+
+
+/**
+ * Scans the samples, sorted by feature value, with every supported kernel, and checks each
+ * against selectThreshold(). Vector kernels add the weights in another order, so errors may
+ * differ by rounding, and near ties may go either way: only exact ties must select the same
+ * threshold and polarity.
+ * @return the amount of kernels that disagree.
+ */
+int check(const char * const description, const std::vector<FeatureAndWeight> & samples)
+{
+    weight_type total_p = 0;
+    weight_type total_n = 0;
+    StumpScanBuffer buffer;
+    buffer.resize(samples.size());
+    for (std::size_t k = 0; k < samples.size(); ++k)
+    {
+        (samples[k].label == yes ? total_p : total_n) += samples[k].weight;
+        buffer.values[k] = samples[k].feature;
+        buffer.signed_weights[k] = samples[k].label == yes ? samples[k].weight : -samples[k].weight;
+    }
+
+    feature_value_type expected_threshold;
+    Classification expected_polarity;
+    const weight_type expected_error = selectThreshold(samples, total_p, total_n, expected_threshold, expected_polarity);
+
+    int failures = 0;
+    for (unsigned int kernel = 0; kernel < sizeof(kernels) / sizeof(kernels[0]); ++kernel)
+    {
+        if ( !isStumpScanKernelSupported(kernels[kernel]) )
+        {
+            continue;
+        }
+
+        feature_value_type threshold;
+        Classification polarity;
+        const weight_type error = scanStumpThreshold(&buffer.values[0], &buffer.signed_weights[0], buffer.size(),
+                                                     total_p, total_n, threshold, polarity, kernels[kernel]);
+
+        const bool same_split = threshold == expected_threshold && polarity == expected_polarity;
+        if ( std::fabs(error - expected_error) > 1e-5f || (error == expected_error && !same_split) )
+        {
+            std::cout << "FAILED " << description << ", " << samples.size() << " samples, " << names[kernel]
+                      << ": error " << error << " threshold " << threshold << " polarity " << polarity
+                      << ", expected " << expected_error << ' ' << expected_threshold << ' ' << expected_polarity << '\n';
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+
+
+/**
+ * Samples with rounded feature values, so that thresholds between equal values are exercised
+ * too, positive ones a quarter of them and slightly higher.
+ */
+std::vector<FeatureAndWeight> randomSamples(boost::random::mt19937 & rng, const unsigned int size, const float separation)
+{
+    boost::random::normal_distribution<feature_value_type> normal;
+    boost::random::uniform_01<weight_type> uniform;
+
+    std::vector<FeatureAndWeight> samples(size);
+    for (unsigned int k = 0; k < size; ++k)
+    {
+        samples[k].label = uniform(rng) < .25f ? yes : no;
+        samples[k].feature = std::floor( (normal(rng) + (samples[k].label == yes) * separation) * 8.0f );
+        samples[k].weight = (.5f + uniform(rng)) / size;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+}
+
+
+
+/**
+ * Checks every supported stump scan kernel against selectThreshold(), the reference scan of the
+ * weak learners, on random samples of every size up to a few vector widths, larger ones, and
+ * degenerate ones. Returns 2 if any kernel disagrees. bench_stumpscan times them.
+ */
+int main() {
+    int failures = 0;
+    boost::random::mt19937 rng(137);
+
+    //Every remainder of the vector widths, then sizes where the scan runs mostly vectorized
+    for (unsigned int size = 1; size <= 40; ++size)
+    {
+        for (unsigned int j = 0; j < 20; ++j)
+        {
+            failures += check("random", randomSamples(rng, size, (j % 10) / 10.0f));
+        }
+    }
+    const unsigned int large[] = {255, 256, 257, 4096, 10001};
+    for (unsigned int i = 0; i < sizeof(large) / sizeof(large[0]); ++i)
+    {
+        for (unsigned int j = 0; j < 10; ++j)
+        {
+            failures += check("random", randomSamples(rng, large[i], (j % 10) / 10.0f));
+        }
+    }
+
+    //No threshold between distinct values
+    std::vector<FeatureAndWeight> same = randomSamples(rng, 37, .5f);
+    for (std::size_t k = 0; k < same.size(); ++k)
+    {
+        same[k].feature = 3.0f;
+    }
+    failures += check("equal values", same);
+
+    //A single label: some polarity makes no error
+    std::vector<FeatureAndWeight> positive = randomSamples(rng, 19, .5f);
+    std::vector<FeatureAndWeight> negative = positive;
+    for (std::size_t k = 0; k < positive.size(); ++k)
+    {
+        positive[k].label = yes;
+        negative[k].label = no;
+    }
+    failures += check("positive only", positive);
+    failures += check("negative only", negative);
+
+    //Perfectly separable, with the positive samples below the negative ones and above them
+    std::vector<FeatureAndWeight> separable = randomSamples(rng, 50, .5f);
+    for (std::size_t k = 0; k < separable.size(); ++k)
+    {
+        separable[k].feature = (float)k;
+        separable[k].label = k < 20 ? yes : no;
+    }
+    failures += check("separable, positives below", separable);
+    for (std::size_t k = 0; k < separable.size(); ++k)
+    {
+        separable[k].label = k < 20 ? no : yes;
+    }
+    failures += check("separable, positives above", separable);
+
+    for (unsigned int kernel = 0; kernel < sizeof(kernels) / sizeof(kernels[0]); ++kernel)
+    {
+        std::cout << names[kernel] << (isStumpScanKernelSupported(kernels[kernel]) ? " checked\n" : " not supported\n");
+    }
+    std::cout << (failures ? "FAILED" : "PASSED") << std::endl;
+
+    return failures ? 2 : 0;
+}
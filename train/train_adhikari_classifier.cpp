@@ -9,20 +9,28 @@
  *     waveletsFile
  *     strongHypothesisOutputFile
  *     maximumIterations
+ *     [--resample samplesPerRound]
+ *     [--trim beta]
+ *     [--features fraction [--keep bestFeaturesKept]]
+ *     [--seed seed]
+ *     [--checkpoint checkpointFile [--every rounds] [--resume]]
+ *     [--continue]
  */
-int main(int, char **argv) {
+int main(int argc, char **argv) {
     const std::string positivesFile = argv[1];
     const std::string negativesFile = argv[2];
     const std::string negativesIndexFile = argv[3];
     const std::string waveletsFile = argv[4];
     const std::string strongHypothesisFile = argv[5];
     const unsigned int maximum_iterations = charToInt(argv[6]);
+    const std::vector<std::string> options(argv + 7, argv + argc);
 
-    ___main<AdhikariHaarClassifier, SimpleSelectionWeakLearner<AdhikariHaarClassifier> >(
+    return ___main<AdhikariHaarClassifier, SimpleSelectionWeakLearner<AdhikariHaarClassifier> >(
                 positivesFile,
                 negativesFile,
                 negativesIndexFile,
                 waveletsFile,
                 strongHypothesisFile,
-                maximum_iterations);
+                maximum_iterations,
+                options);
 }
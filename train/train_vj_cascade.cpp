@@ -0,0 +1,47 @@
+#include "template_traincascade.h"
+
+/**
+ * Arguments:
+ *     positivesImageFile
+ *     negativesImageFile
+ *     negativesIndexFile
+ *     waveletsFile
+ *     cascadeOutputFile
+ *     maximumStages
+ *     maximumRoundsPerStage
+ *     [--detection-rate leastStageDetectionRate (default 0.995)]
+ *     [--false-positive-rate mostStageFalsePositiveRate (default 0.5)]
+ *     [--target cascadeFalsePositiveRate (default 0, train all stages)]
+ *     [--validation fractionOfSamplesForValidation (default 0.25)]
+ *     [--backgrounds directoryOfImagesWithoutPositives
+ *         [--scale scaleFactor (default 1.25)]
+ *         [--step windowStep (default 2)]
+ *         [--per-image mostNegativesPerImage (default 100)]]
+ *     [--precompute]
+ *     [--presort]
+ *     [--cache featureValueCacheFile]
+ *     [--resample samplesPerRound]
+ *     [--trim beta]
+ *     [--features fraction [--keep bestFeaturesKept]]
+ *     [--seed seed]
+ */
+int main(int argc, char **argv) {
+    const std::string positivesFile = argv[1];
+    const std::string negativesFile = argv[2];
+    const std::string negativesIndexFile = argv[3];
+    const std::string waveletsFile = argv[4];
+    const std::string cascadeFile = argv[5];
+    const unsigned int maximumStages = charToInt(argv[6]);
+    const unsigned int maximumStageRounds = charToInt(argv[7]);
+    const std::vector<std::string> options(argv + 8, argv + argc);
+
+    return ___cascade_main<ViolaJonesClassifier, DecisionStumpWeakLearner<ViolaJonesClassifier> >(
+                positivesFile,
+                negativesFile,
+                negativesIndexFile,
+                waveletsFile,
+                cascadeFile,
+                maximumStages,
+                maximumStageRounds,
+                options);
+}
@@ -0,0 +1,41 @@
+#include "template_trainclassifier.h"
+
+/**
+ * Trains Viola and Jones' classifier, but searches the decision stump thresholds over
+ * histograms of the feature values (see HistogramStumpWeakLearner).
+ *
+ * Arguments:
+ *     positivesIndexFile
+ *     positivesImageFile
+ *     negativesIndexFile
+ *     negativesImageFile
+ *     waveletsFile
+ *     strongHypothesisOutputFile
+ *     maximumIterations
+ *     [--precompute]
+ *     [--cache featureValueCacheFile]
+ *     [--resample samplesPerRound]
+ *     [--trim beta]
+ *     [--features fraction [--keep bestFeaturesKept]]
+ *     [--seed seed]
+ *     [--checkpoint checkpointFile [--every rounds] [--resume]]
+ *     [--continue]
+ */
+int main(int argc, char **argv) {
+    const std::string positivesFile = argv[1];
+    const std::string negativesFile = argv[2];
+    const std::string negativesIndexFile = argv[3];
+    const std::string waveletsFile = argv[4];
+    const std::string strongHypothesisFile = argv[5];
+    const unsigned int maximum_iterations = charToInt(argv[6]);
+    const std::vector<std::string> options(argv + 7, argv + argc);
+
+    return ___main<ViolaJonesClassifier, HistogramStumpWeakLearner<ViolaJonesClassifier> >(
+                positivesFile,
+                negativesFile,
+                negativesIndexFile,
+                waveletsFile,
+                strongHypothesisFile,
+                maximum_iterations,
+                options);
+}
@@ -0,0 +1,42 @@
+#include "template_trainclassifier.h"
+
+/**
+ * Trains Viola and Jones' classifier over 32 bit integer integral sums instead of doubles
+ * (see Int32Integrals). Its features are evaluated in-tree (see IntegralVarianceNormalizedEvaluator).
+ *
+ * Arguments:
+ *     positivesIndexFile
+ *     positivesImageFile
+ *     negativesIndexFile
+ *     negativesImageFile
+ *     waveletsFile
+ *     strongHypothesisOutputFile
+ *     maximumIterations
+ *     [--precompute]
+ *     [--presort]
+ *     [--cache featureValueCacheFile]
+ *     [--resample samplesPerRound]
+ *     [--trim beta]
+ *     [--features fraction [--keep bestFeaturesKept]]
+ *     [--seed seed]
+ *     [--checkpoint checkpointFile [--every rounds] [--resume]]
+ *     [--continue]
+ */
+int main(int argc, char **argv) {
+    const std::string positivesFile = argv[1];
+    const std::string negativesFile = argv[2];
+    const std::string negativesIndexFile = argv[3];
+    const std::string waveletsFile = argv[4];
+    const std::string strongHypothesisFile = argv[5];
+    const unsigned int maximum_iterations = charToInt(argv[6]);
+    const std::vector<std::string> options(argv + 7, argv + argc);
+
+    return ___main<ViolaJonesInt32Classifier, DecisionStumpWeakLearner<ViolaJonesInt32Classifier> >(
+                positivesFile,
+                negativesFile,
+                negativesIndexFile,
+                waveletsFile,
+                strongHypothesisFile,
+                maximum_iterations,
+                options);
+}
@@ -0,0 +1,83 @@
+#ifndef TRAININGDATA_H
+#define TRAININGDATA_H
+
+#include <vector>
+#include <cmath>
+
+#include "common.h"
+#include "labeledexample.h"
+#include "featurevaluematrix.h"
+#include "sortedsampleindex.h"
+#include "quantizedfeaturevalues.h"
+
+
+
+/**
+ * Everything a weak learner may read about the training set. It does not change
+ * between boosting rounds, except for which features and samples are evaluated:
+ * the weight distribution is passed apart.
+ */
+struct TrainingData
+{
+    /** Pointers to both positive and negative LabeledExamples, in a SampleStore this does not own */
+    std::vector<const LabeledExample *> allSamples;
+
+    /** Precomputed feature values. If empty, weak learners evaluate features on demand. */
+    FeatureValueMatrix featureValues;
+
+    /** Per feature sample order. Weak learners walk it instead of sorting samples again when walkSortedSamples() tells so. */
+    SortedSampleIndex sortedSamples;
+
+    /** Binned feature values, for weak learners that search thresholds over histograms. */
+    QuantizedFeatureValues quantizedValues;
+
+    /** The indexes of the weak hypothesis to evaluate this round, in increasing order. If empty, all of them are. */
+    std::vector<unsigned int> features;
+
+    /**
+     * The indexes of the samples to train the weak learner on this round, in increasing order.
+     * If empty, all of them are. Otherwise, the k-th weight the weak learner is given is the
+     * weight of sample subset[k]. The feature values, the order and the bins of the samples are
+     * still those of all of them: weak learners index them in place, so nothing is copied.
+     */
+    std::vector<unsigned int> subset;
+
+    /** Where each sample is in subset, or -1 if it is not in it. See selectSubset(). */
+    std::vector<int> subsetPosition;
+
+
+
+    /**
+     * Makes the weak learner train on the samples of subset only, which must be in increasing
+     * order and not repeat samples. An empty subset makes it train on all of them again.
+     */
+    void selectSubset(const std::vector<unsigned int> & subset_)
+    {
+        subset = subset_;
+
+        subsetPosition.clear();
+        if ( !subset.empty() && !sortedSamples.empty() )
+        {
+            subsetPosition.resize(allSamples.size(), -1);
+            for (std::vector<unsigned int>::size_type k = 0; k < subset.size(); ++k)
+            {
+                subsetPosition[ subset[k] ] = k;
+            }
+        }
+    }
+
+    /**
+     * Whether the weak learner should walk sortedSamples this round. Skipping the samples out
+     * of the subset still walks the whole order, for every feature: small subsets are sorted
+     * faster by the weak learner.
+     */
+    bool walkSortedSamples() const
+    {
+        return !sortedSamples.empty()
+               && ( subset.empty() || subset.size() * std::log((double)subset.size() + 1) / std::log(2.0) >= allSamples.size() );
+    }
+};
+
+
+
+#endif // TRAININGDATA_H
@@ -2,11 +2,17 @@
 #define DECISIONSTUMPWEAKLEARNER_H
 
 #include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
 #include <tbb/tbb.h>
+#include <boost/static_assert.hpp>
 
 #include "common.h"
 #include "labeledexample.h"
 #include "progresscallback.h"
+#include "trainingdata.h"
+#include "stumpscan.h"
 
 
 
@@ -49,154 +55,657 @@ struct WeakLearner
 
 
 
+/**
+ * Feature value of a sample, with its weight and label.
+ */
+struct FeatureAndWeight
+{
+    float feature;
+    weight_type weight;
+    Classification label;
+
+    bool operator < (const FeatureAndWeight & f) const
+    {
+        return feature < f.feature;
+    }
+};
+
+
+
+/**
+ * Finds the decision stump threshold and polarity with the lowest weighted error.
+ * This is the reference implementation of scanStumpThreshold(), which weak learners should prefer.
+ * @param feature_values the samples, sorted by increasing feature value.
+ * @param total_w_1_p the total weight of the positive samples.
+ * @param total_w_1_n the total weight of the negative samples.
+ * @param v output parameter. The selected threshold.
+ * @param c0 output parameter. The selected polarity.
+ * @return the weighted error of the selected threshold and polarity.
+ */
+inline weight_type selectThreshold(const std::vector<FeatureAndWeight> & feature_values,
+                                   weight_type total_w_1_p,
+                                   weight_type total_w_1_n,
+                                   float & v,
+                                   Classification & c0)
+{
+    weight_type total_w_0_p = 0; //sum of false negatives up to k. This is Viola and Jones' S+.
+    weight_type total_w_0_n = 0; //sum of true negatives up to k.  This is Viola and Jones' S-.
+
+    weight_type best_error = std::min(total_w_1_n, total_w_1_p);
+
+    v = feature_values[0].feature;
+    c0 = total_w_0_n <= total_w_0_p ? yes : no;
+    //Classification c1 = total_w_1_n <= total_w_1_p ? yes : no;
+
+    for(WeightVector::size_type k = 0; k < feature_values.size(); ++k )
+    {
+        total_w_0_p += feature_values[k].weight * (feature_values[k].label == yes);
+        total_w_0_n += feature_values[k].weight * (feature_values[k].label == no);
+
+        total_w_1_p -= feature_values[k].weight * (feature_values[k].label == yes);
+        total_w_1_n -= feature_values[k].weight * (feature_values[k].label == no);
+
+        if ( k < feature_values.size() - 1
+             && feature_values[k].feature == feature_values[k+1].feature )
+        {
+            continue;
+        }
+
+        //const weight_type error_o = std::min(total_w_0_n, total_w_0_p) + std::min(total_w_1_n, total_w_1_p); //Same as Viola and Jones'
+        const weight_type error = std::min(total_w_0_p + total_w_1_n,
+                                           total_w_0_n + total_w_1_p); //Viola and Jones' version.
+
+        if (error < best_error)
+        {
+            best_error = error;
+
+            v = feature_values[k].feature;
+
+            c0 = total_w_0_n <= total_w_0_p ? yes : no;
+            //c1 = total_w_1_n <= total_w_1_p ? yes : no;
+        }
+    }
+    //Ok... That was what's in the book. Give me back the controls now.
+
+    return best_error;
+}
+
+
+
+/**
+ * Base class of the weak learners. Weak learners are tbb::parallel_reduce bodies: each body
+ * evaluates a range of weak hypothesis keeping its own ranking of the best (error, index)
+ * pairs, and bodies are joined afterwards. No lock is taken to select the best weak hypothesis.
+ * Ties are broken by the lowest index, so the selection does not depend on how the range was split.
+ *
+ * The range is over TrainingData::features when it is not empty, and over all weak hypothesis
+ * otherwise: hypothesisIndex() tells which weak hypothesis each position of the range refers to.
+ * Likewise, the weights are those of TrainingData::subset when it is not empty, and of all
+ * samples otherwise: sampleIndex() tells which sample each weight refers to. markCorrect() and
+ * selected() always read the weights and samples of the whole training set.
+ *
+ * The progress counter is shared, so it is updated under the mutex, but only once per range.
+ */
+class WeakLearnerBody
+{
+public:
+    /** How many of the best weak hypothesis are ranked */
+    static const unsigned int RANKED = 16;
+
+    WeakLearnerBody(WeakLearnerMutex & mutex_,
+                   unsigned long & count_,
+                   const TrainingData & trainingData_,
+                   const unsigned long hypothesis_count,
+                   ProgressCallback * const progressCallback_) : mutex(mutex_),
+                                                                 count(count_),
+                                                                 total(trainingData_.features.empty() ? hypothesis_count : trainingData_.features.size()),
+                                                                 progressCallback(progressCallback_),
+                                                                 features(trainingData_.features),
+                                                                 subset(trainingData_.subset),
+                                                                 ranked_count(0) {}
+
+    WeakLearnerBody(WeakLearnerBody & body, tbb::split) : mutex(body.mutex),
+                                                          count(body.count),
+                                                          total(body.total),
+                                                          progressCallback(body.progressCallback),
+                                                          features(body.features),
+                                                          subset(body.subset),
+                                                          ranked_count(0) {}
+
+
+
+    /**
+     * Merges the ranking of a body that evaluated another range.
+     */
+    void join(const WeakLearnerBody & body)
+    {
+        for (unsigned int k = 0; k < body.ranked_count; ++k)
+        {
+            select(body.ranked[k].first, body.ranked[k].second);
+        }
+    }
+
+
+
+    /**
+     * The weighted error of the selected weak hypothesis.
+     */
+    weight_type weightedError() const
+    {
+        return ranked_count ? ranked[0].first : std::numeric_limits<weight_type>::max();
+    }
+
+    /**
+     * The index of the selected weak hypothesis.
+     */
+    unsigned int selectedIndex() const
+    {
+        return ranked_count ? ranked[0].second : 0;
+    }
+
+    /**
+     * The indexes of the, at most, RANKED weak hypothesis with the lowest weighted errors, best first.
+     */
+    void ranking(std::vector<unsigned int> & indexes) const
+    {
+        indexes.resize(ranked_count);
+        for (unsigned int k = 0; k < ranked_count; ++k)
+        {
+            indexes[k] = ranked[k].second;
+        }
+    }
+
+protected:
+
+    /**
+     * The index of the weak hypothesis at a position of the range.
+     */
+    unsigned int hypothesisIndex(const unsigned int position) const
+    {
+        return features.empty() ? position : features[position];
+    }
+
+    /**
+     * The index of the sample the k-th weight refers to.
+     */
+    unsigned int sampleIndex(const unsigned int k) const
+    {
+        return subset.empty() ? k : subset[k];
+    }
+
+    /**
+     * Ranks the j-th weak hypothesis, if it is better than the worst ranked one.
+     */
+    void select(const weight_type error, const unsigned int j)
+    {
+        const std::pair<weight_type, unsigned int> candidate(error, j);
+        if ( ranked_count == RANKED && !(candidate < ranked[RANKED - 1]) )
+        {
+            return;
+        }
+
+        unsigned int k = ranked_count < RANKED ? ranked_count++ : RANKED - 1;
+        for (; k > 0 && candidate < ranked[k - 1]; --k)
+        {
+            ranked[k] = ranked[k - 1];
+        }
+        ranked[k] = candidate;
+    }
+
+    /**
+     * Reports that more weak hypothesis were evaluated.
+     */
+    void tick(const unsigned long evaluated)
+    {
+        if (progressCallback)
+        { //synchronization needed only INSIDE the if
+            WeakLearnerMutex::scoped_lock lock(mutex);
+            count += evaluated;
+            progressCallback->tick(count, total);
+        }
+    }
+
+private:
+    WeakLearnerMutex & mutex;
+    unsigned long    & count;
+    const unsigned long total;
+    ProgressCallback * const progressCallback;
+    const std::vector<unsigned int> & features;
+    const std::vector<unsigned int> & subset;
+
+    /** The best (error, index) pairs so far, in increasing order */
+    std::pair<weight_type, unsigned int> ranked[RANKED];
+    unsigned int ranked_count;
+};
+
+
+
+/**
+ * Marks the samples a weak hypothesis classifies correctly: 1 if so, 0 otherwise.
+ * Filled by the weak learners after each boosting round and used to update the weights.
+ */
+typedef std::vector<unsigned char> CorrectnessVector;
+
+
+
+/**
+ * Fills a CorrectnessVector in parallel for weak hypothesis that classify a feature value
+ * (see ThresholdedWeakClassifier::classifyFeatureValue()), reading the precomputed feature
+ * values if there are any.
+ */
+template <typename WeakHypothesisType>
+struct MarkCorrectByFeatureValue
+{
+    const std::vector<const LabeledExample *> & allSamples;
+    const feature_value_type                  * const precomputed;
+    const WeakHypothesisType                  & weakHypothesis;
+    CorrectnessVector                         & correct;
+
+    MarkCorrectByFeatureValue(const std::vector<const LabeledExample *> & allSamples_,
+                              const feature_value_type                  * const precomputed_,
+                              const WeakHypothesisType                  & weakHypothesis_,
+                              CorrectnessVector                         & correct_) : allSamples(allSamples_),
+                                                                                      precomputed(precomputed_),
+                                                                                      weakHypothesis(weakHypothesis_),
+                                                                                      correct(correct_) {}
+
+    void operator()(const tbb::blocked_range< unsigned int > & range) const
+    {
+        for (unsigned int i = range.begin(); i < range.end(); ++i)
+        {
+            const feature_value_type value = precomputed ? precomputed[i] : weakHypothesis.featureValue( *(allSamples[i]) );
+            correct[i] = weakHypothesis.classifyFeatureValue(value) == allSamples[i]->getLabel();
+        }
+    }
+};
+
+
+
+/**
+ * Fills a CorrectnessVector in parallel through WeakHypothesisType::classify().
+ */
+template <typename WeakHypothesisType>
+struct MarkCorrectByClassification
+{
+    const std::vector<const LabeledExample *> & allSamples;
+    const WeakHypothesisType                  & weakHypothesis;
+    CorrectnessVector                         & correct;
+
+    MarkCorrectByClassification(const std::vector<const LabeledExample *> & allSamples_,
+                                const WeakHypothesisType                  & weakHypothesis_,
+                                CorrectnessVector                         & correct_) : allSamples(allSamples_),
+                                                                                        weakHypothesis(weakHypothesis_),
+                                                                                        correct(correct_) {}
+
+    void operator()(const tbb::blocked_range< unsigned int > & range) const
+    {
+        for (unsigned int i = range.begin(); i < range.end(); ++i)
+        {
+            correct[i] = weakHypothesis.classify( *(allSamples[i]) ) == allSamples[i]->getLabel();
+        }
+    }
+};
+
+
+
 /**
  * Implements a weak learner which weak classifiers are decision stumps.
  */
 template <typename WeakHypothesisType>
-class DecisionStumpWeakLearner// : WeakLearner< tbb::blocked_range<unsigned int> >
+class DecisionStumpWeakLearner : public WeakLearnerBody
 {
 public:
     /**
      * @brief This class constructor.
      * @param mutex_
-     * @param allSamples_
+     * @param trainingData_ the samples and, optionally, their precomputed feature values and order.
      * @param weight_distribution_
      * @param hypothesis_
-     * @param selected_weak_hypothesis_weighted_error_
-     * @param selected_weak_hypothesis_index_
      * @param count_
      * @param progressCallback_
      */
     DecisionStumpWeakLearner(WeakLearnerMutex & mutex_,
-    const std::vector<const LabeledExample *> & allSamples_,
+                           const TrainingData & trainingData_,
                            const WeightVector & weight_distribution_,
               std::vector<WeakHypothesisType> & hypothesis_,
-                                  weight_type & selected_weak_hypothesis_weighted_error_,
-                                 unsigned int & selected_weak_hypothesis_index_,
                                 unsigned long & count_,
-                             ProgressCallback * const progressCallback_) : mutex(mutex_),
-                                                                           allSamples(allSamples_),
+                             ProgressCallback * const progressCallback_) : WeakLearnerBody(mutex_, count_, trainingData_, hypothesis_.size(), progressCallback_),
+                                                                           allSamples(trainingData_.allSamples),
+                                                                           featureValues(trainingData_.featureValues),
+                                                                           sortedSamples(trainingData_.sortedSamples),
+                                                                           subsetPosition(trainingData_.subsetPosition),
+                                                                           walkSorted(trainingData_.walkSortedSamples()),
                                                                            weight_distribution(weight_distribution_),
-                                                                           hypothesis(hypothesis_),
-                                                                           selected_weak_hypothesis_weighted_error(selected_weak_hypothesis_weighted_error_),
-                                                                           selected_weak_hypothesis_index(selected_weak_hypothesis_index_),
-                                                                           count(count_),
-                                                                           progressCallback(progressCallback_) {}
+                                                                           hypothesis(hypothesis_) {}
+
+    /**
+     * Splitting constructor, required by tbb::parallel_reduce.
+     */
+    DecisionStumpWeakLearner(DecisionStumpWeakLearner & learner, tbb::split) : WeakLearnerBody(learner, tbb::split()),
+                                                                               allSamples(learner.allSamples),
+                                                                               featureValues(learner.featureValues),
+                                                                               sortedSamples(learner.sortedSamples),
+                                                                               subsetPosition(learner.subsetPosition),
+                                                                               walkSorted(learner.walkSorted),
+                                                                               weight_distribution(learner.weight_distribution),
+                                                                               hypothesis(learner.hypothesis) {}
+
+
+
+    /** Reads precomputed feature values and the sorted sample index, if Adaboost built them */
+    static const bool reads_feature_values = true;
+    static const bool reads_sorted_samples = true;
+
+    /**
+     * Invoked once, before the first boosting round. This weak learner needs no preparation.
+     */
+    static void prepare(TrainingData &, const std::vector<WeakHypothesisType> &) {}
+
+    /**
+     * Invoked after each boosting round selected a weak hypothesis. This weak learner has nothing to report.
+     */
+    static void selected(const TrainingData &,
+                         const WeightVector &,
+                         const std::vector<WeakHypothesisType> &,
+                         const unsigned int,
+                         const weight_type,
+                         ProgressCallback * const) {}
+
+
+
+    /**
+     * Invoked after each boosting round selected a weak hypothesis. Marks the samples it classifies correctly.
+     */
+    static void markCorrect(const TrainingData & trainingData,
+                            const std::vector<WeakHypothesisType> & hypothesis,
+                            const unsigned int index,
+                            CorrectnessVector & correct)
+    {
+        const feature_value_type * const precomputed =
+                trainingData.featureValues.empty() ? 0 : trainingData.featureValues.row(index);
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, trainingData.allSamples.size()),
+                           MarkCorrectByFeatureValue<WeakHypothesisType>(trainingData.allSamples, precomputed, hypothesis[index], correct) );
+    }
 
 
 
     /**
      * Runs this weak learner
      */
-    void operator()(tbb::blocked_range< unsigned int > & range) const
+    void operator()(const tbb::blocked_range< unsigned int > & range)
     {
-        //Feature values and respective weight and label
-        std::vector<FeatureAndWeight> feature_values(allSamples.size());
+        //Sorted feature values and signed weights, as expected by scanStumpThreshold()
+        StumpScanBuffer buffer;
+        buffer.resize(weight_distribution.size());
+
+        //Feature values and respective weight and label, when samples must be sorted here
+        std::vector<FeatureAndWeight> feature_values(walkSorted ? 0 : weight_distribution.size());
 
         //Calculate the weighted errors of each weak classifier with respect to the weights of each instance
-        for (unsigned int j = range.begin(); j < range.end(); ++j) //j refers to the classifiers
+        for (unsigned int position = range.begin(); position < range.end(); ++position)
         {
-            //========= BEGIN WTF ZONE =========
+            const unsigned int j = hypothesisIndex(position); //j refers to the classifiers
             //For an explanation about what is going on bellow, refer to Schapire and Freund's Boosting book, chapter 3.4.2
-            weight_type total_w_1_p = 0; //remaining true positives for feature_values above k. This is Viola and Jones' (T+ - S+), as seen in section 3.1.
-            weight_type total_w_1_n = 0; //remaining false positives for feature_values above k. This is Viola and Jones' (T- - S-).
-            for(WeightVector::size_type i = 0; i < feature_values.size(); ++i ) //i refers to the samples
+            weight_type total_w_1_p = 0; //Viola and Jones' T+, as seen in section 3.1.
+            weight_type total_w_1_n = 0; //Viola and Jones' T-.
+            const feature_value_type * const precomputed = featureValues.empty() ? 0 : featureValues.row(j);
+            if ( walkSorted )
+            {
+                //The samples order was computed before boosting started: gather them already sorted,
+                //skipping those out of the subset, if there is one.
+                const unsigned int * const order = sortedSamples.order(j);
+                const bool all = subsetPosition.empty();
+                WeightVector::size_type k = 0; //k refers to the sorted samples
+                for(std::vector<const LabeledExample *>::size_type s = 0; s < allSamples.size(); ++s )
+                {
+                    const unsigned int i = order[s];
+                    const int w = all ? (int)i : subsetPosition[i]; //w refers to the weights
+                    if (w < 0)
+                    {
+                        continue;
+                    }
+
+                    const bool positive = allSamples[i]->getLabel() == yes;
+                    buffer.values[k] = precomputed[i];
+                    buffer.signed_weights[k] = positive ? weight_distribution[w] : -weight_distribution[w];
+                    ++k;
+
+                    total_w_1_p += weight_distribution[w] * positive;
+                    total_w_1_n += weight_distribution[w] * !positive;
+                }
+            }
+            else
             {
-                feature_values[i].feature = hypothesis[j].featureValue( *(allSamples[i]) );
-                feature_values[i].label   = allSamples[i]->getLabel();
-                feature_values[i].weight  = weight_distribution[i];
+                for(WeightVector::size_type k = 0; k < feature_values.size(); ++k ) //k refers to the weights
+                {
+                    const unsigned int i = sampleIndex(k); //i refers to the samples
+                    feature_values[k].feature = precomputed ? precomputed[i] : hypothesis[j].featureValue( *(allSamples[i]) );
+                    feature_values[k].label   = allSamples[i]->getLabel();
+                    feature_values[k].weight  = weight_distribution[k];
+
+                    total_w_1_p += feature_values[k].weight * (feature_values[k].label == yes);
+                    total_w_1_n += feature_values[k].weight * (feature_values[k].label == no);
+                }
 
-                total_w_1_p += feature_values[i].weight * (feature_values[i].label == yes);
-                total_w_1_n += feature_values[i].weight * (feature_values[i].label == no);
+                std::sort( feature_values.begin(), feature_values.end() );
+
+                for(WeightVector::size_type k = 0; k < feature_values.size(); ++k ) //k refers to the sorted samples
+                {
+                    buffer.values[k] = feature_values[k].feature;
+                    buffer.signed_weights[k] = feature_values[k].label == yes ? feature_values[k].weight : -feature_values[k].weight;
+                }
             }
 
-            std::sort( feature_values.begin(), feature_values.end() );
+            float v;
+            Classification c0;
+            const weight_type best_error = buffer.scan(total_w_1_p, total_w_1_n, v, c0);
 
-            weight_type total_w_0_p = 0; //sum of false negatives up to k. This is Viola and Jones' S+.
-            weight_type total_w_0_n = 0; //sum of true negatives up to k.  This is Viola and Jones' S-.
+            hypothesis[j].setThreshold(v);
+            hypothesis[j].setPolarity(c0);
 
-            weight_type best_error = std::min(total_w_1_n, total_w_1_p);
+            select(best_error, j);
+        }
 
-            float v = feature_values[0].feature;
-            Classification c0 = total_w_0_n <= total_w_0_p ? yes : no;
-            //Classification c1 = total_w_1_n <= total_w_1_p ? yes : no;
+        tick(range.size());
+    }
 
-            for(WeightVector::size_type k = 0; k < feature_values.size(); ++k )
-            {
-                total_w_0_p += feature_values[k].weight * (feature_values[k].label == yes);
-                total_w_0_n += feature_values[k].weight * (feature_values[k].label == no);
+private:
 
-                total_w_1_p -= feature_values[k].weight * (feature_values[k].label == yes);
-                total_w_1_n -= feature_values[k].weight * (feature_values[k].label == no);
+    const std::vector<const LabeledExample *> & allSamples;
+    const FeatureValueMatrix                  & featureValues;
+    const SortedSampleIndex                   & sortedSamples;
+    const std::vector<int>                    & subsetPosition;
+    const bool                                  walkSorted;
+    const WeightVector                        & weight_distribution;
+    std::vector<WeakHypothesisType>           & hypothesis;
+};
 
-                if ( k < feature_values.size() - 1
-                     && feature_values[k].feature == feature_values[k+1].feature )
-                {
-                    continue;
-                }
 
-                //const weight_type error_o = std::min(total_w_0_n, total_w_0_p) + std::min(total_w_1_n, total_w_1_p); //Same as Viola and Jones'
-                const weight_type error = std::min(total_w_0_p + total_w_1_n,
-                                                   total_w_0_n + total_w_1_p); //Viola and Jones' version.
 
+/**
+ * A decision stump weak learner that searches thresholds over histograms instead of sorted
+ * samples. Before boosting, each feature's values are quantized into at most Bins bins
+ * (see QuantizedFeatureValues). Each round then accumulates the weights of the positive and
+ * negative samples per bin and only evaluates thresholds at the bin bounds, in O(N + Bins)
+ * per feature. The selected threshold is approximate: after each round, the error an exact
+ * search would reach with the selected feature is reported to the ProgressCallback.
+ */
+template <typename WeakHypothesisType, unsigned int Bins = 256>
+class HistogramStumpWeakLearner : public WeakLearnerBody
+{
+public:
+    /**
+     * @brief This class constructor.
+     * @param mutex_
+     * @param trainingData_ the samples. Their quantized feature values must have been computed by prepare().
+     * @param weight_distribution_
+     * @param hypothesis_
+     * @param count_
+     * @param progressCallback_
+     */
+    HistogramStumpWeakLearner(WeakLearnerMutex & mutex_,
+                            const TrainingData & trainingData_,
+                            const WeightVector & weight_distribution_,
+               std::vector<WeakHypothesisType> & hypothesis_,
+                                 unsigned long & count_,
+                              ProgressCallback * const progressCallback_) : WeakLearnerBody(mutex_, count_, trainingData_, hypothesis_.size(), progressCallback_),
+                                                                            allSamples(trainingData_.allSamples),
+                                                                            quantizedValues(trainingData_.quantizedValues),
+                                                                            weight_distribution(weight_distribution_),
+                                                                            hypothesis(hypothesis_) {}
+
+    /**
+     * Splitting constructor, required by tbb::parallel_reduce.
+     */
+    HistogramStumpWeakLearner(HistogramStumpWeakLearner & learner, tbb::split) : WeakLearnerBody(learner, tbb::split()),
+                                                                                 allSamples(learner.allSamples),
+                                                                                 quantizedValues(learner.quantizedValues),
+                                                                                 weight_distribution(learner.weight_distribution),
+                                                                                 hypothesis(learner.hypothesis) {}
+
+
+
+    /** Quantizes precomputed feature values, if Adaboost built them, but never reads the sorted samples */
+    static const bool reads_feature_values = true;
+    static const bool reads_sorted_samples = false;
+
+    /**
+     * Invoked once, before the first boosting round. Quantizes the feature values.
+     */
+    static void prepare(TrainingData & trainingData, const std::vector<WeakHypothesisType> & hypothesis)
+    {
+        BOOST_STATIC_ASSERT(Bins > 1 && Bins <= 256); //QuantizedFeatureValues::bin_type is an unsigned char
+        trainingData.quantizedValues.compute(hypothesis, trainingData.allSamples, trainingData.featureValues, Bins);
+    }
+
+
+
+    /**
+     * Invoked after each boosting round selected a weak hypothesis. Runs the exact threshold
+     * search over the selected feature and reports how far the approximate error is from it.
+     */
+    static void selected(const TrainingData & trainingData,
+                         const WeightVector & weight_distribution,
+                         const std::vector<WeakHypothesisType> & hypothesis,
+                         const unsigned int index,
+                         const weight_type weighted_error,
+                         ProgressCallback * const progressCallback)
+    {
+        if ( !progressCallback )
+        {
+            return;
+        }
+
+        const std::vector<const LabeledExample *> & allSamples = trainingData.allSamples;
+        const feature_value_type * const precomputed =
+                trainingData.featureValues.empty() ? 0 : trainingData.featureValues.row(index);
+
+        std::vector<FeatureAndWeight> feature_values(allSamples.size());
+        weight_type total_w_1_p = 0;
+        weight_type total_w_1_n = 0;
+        for(WeightVector::size_type i = 0; i < feature_values.size(); ++i )
+        {
+            feature_values[i].feature = precomputed ? precomputed[i] : hypothesis[index].featureValue( *(allSamples[i]) );
+            feature_values[i].label   = allSamples[i]->getLabel();
+            feature_values[i].weight  = weight_distribution[i];
+
+            total_w_1_p += feature_values[i].weight * (feature_values[i].label == yes);
+            total_w_1_n += feature_values[i].weight * (feature_values[i].label == no);
+        }
+        std::sort( feature_values.begin(), feature_values.end() );
+
+        float v;
+        Classification c0;
+        progressCallback->approximateSelection(weighted_error,
+                                               selectThreshold(feature_values, total_w_1_p, total_w_1_n, v, c0));
+    }
+
+
+
+    /**
+     * Invoked after each boosting round selected a weak hypothesis. Marks the samples it classifies correctly.
+     */
+    static void markCorrect(const TrainingData & trainingData,
+                            const std::vector<WeakHypothesisType> & hypothesis,
+                            const unsigned int index,
+                            CorrectnessVector & correct)
+    {
+        const feature_value_type * const precomputed =
+                trainingData.featureValues.empty() ? 0 : trainingData.featureValues.row(index);
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, trainingData.allSamples.size()),
+                           MarkCorrectByFeatureValue<WeakHypothesisType>(trainingData.allSamples, precomputed, hypothesis[index], correct) );
+    }
+
+
+
+    /**
+     * Runs this weak learner
+     */
+    void operator()(const tbb::blocked_range< unsigned int > & range)
+    {
+        weight_type histogram_p[Bins]; //weight of the positive samples in each bin
+        weight_type histogram_n[Bins]; //weight of the negative samples in each bin
+
+        for (unsigned int position = range.begin(); position < range.end(); ++position)
+        {
+            const unsigned int j = hypothesisIndex(position); //j refers to the classifiers
+            const unsigned int bins = quantizedValues.binsUsed(j);
+            const QuantizedFeatureValues::bin_type * const bin = quantizedValues.bin(j);
+            const feature_value_type * const upperBound = quantizedValues.upperBound(j);
+
+            std::fill(histogram_p, histogram_p + bins, 0);
+            std::fill(histogram_n, histogram_n + bins, 0);
+            for(WeightVector::size_type k = 0; k < weight_distribution.size(); ++k ) //k refers to the weights
+            {
+                const unsigned int i = sampleIndex(k); //i refers to the samples
+                weight_type * const histogram = allSamples[i]->getLabel() == yes ? histogram_p : histogram_n;
+                histogram[ bin[i] ] += weight_distribution[k];
+            }
+
+            weight_type total_w_1_p = 0; //Viola and Jones' T+
+            weight_type total_w_1_n = 0; //Viola and Jones' T-
+            for (unsigned int b = 0; b < bins; ++b)
+            {
+                total_w_1_p += histogram_p[b];
+                total_w_1_n += histogram_n[b];
+            }
+
+            //Same scan as selectThreshold(), but over bin bounds instead of samples
+            weight_type total_w_0_p = 0; //Viola and Jones' S+
+            weight_type total_w_0_n = 0; //Viola and Jones' S-
+            weight_type best_error = std::numeric_limits<weight_type>::max();
+            float v = upperBound[0];
+            Classification c0 = yes;
+            for (unsigned int b = 0; b < bins; ++b)
+            {
+                total_w_0_p += histogram_p[b];
+                total_w_0_n += histogram_n[b];
+
+                const weight_type error = std::min(total_w_0_p + (total_w_1_n - total_w_0_n),
+                                                   total_w_0_n + (total_w_1_p - total_w_0_p));
                 if (error < best_error)
                 {
                     best_error = error;
-
-                    v = feature_values[k].feature;
-
+                    v = upperBound[b];
                     c0 = total_w_0_n <= total_w_0_p ? yes : no;
-                    //c1 = total_w_1_n <= total_w_1_p ? yes : no;
                 }
             }
-            //Ok... That was what's in the book. Give me back the controls now.
-            //========= END WTF ZONE =========
 
             hypothesis[j].setThreshold(v);
             hypothesis[j].setPolarity(c0);
 
-            { //this must be synchonized
-                tbb::queuing_mutex::scoped_lock lock(mutex);
-                if (best_error < selected_weak_hypothesis_weighted_error)
-                {
-                    selected_weak_hypothesis_weighted_error = best_error;
-                    selected_weak_hypothesis_index = j;
-                }
-                lock.release();
-            }
-
-            if (progressCallback)
-            { //synchronization needed only INSIDE the if
-                tbb::queuing_mutex::scoped_lock lock(mutex);
-                ++count;
-                progressCallback->tick(count, hypothesis.size());
-                lock.release();
-            }
+            select(best_error, j);
         }
+
+        tick(range.size());
     }
 
 private:
 
-    struct FeatureAndWeight
-    {
-        float feature;
-        weight_type weight;
-        Classification label;
-
-        bool operator < (const FeatureAndWeight & f) const
-        {
-            return feature < f.feature;
-        }
-    };
-
-    WeakLearnerMutex                          & mutex;
     const std::vector<const LabeledExample *> & allSamples;
+    const QuantizedFeatureValues              & quantizedValues;
     const WeightVector                        & weight_distribution;
     std::vector<WeakHypothesisType>           & hypothesis;
-    weight_type                               & selected_weak_hypothesis_weighted_error;
-    unsigned int                              & selected_weak_hypothesis_index;
-    unsigned long                             & count;
-    ProgressCallback                          * progressCallback;
 };
 
 
@@ -207,83 +716,102 @@ private:
  * not take aditional parameters during boosting.
  */
 template <typename WeakHypothesisType>
-class SimpleSelectionWeakLearner// : WeakLearner< tbb::blocked_range<unsigned int> >
+class SimpleSelectionWeakLearner : public WeakLearnerBody
 {
 public:
     /**
      * @brief This class constructor.
      * @param mutex_
-     * @param allSamples_
+     * @param trainingData_ the samples. Precomputed feature values are not used: this weak learner
+     *                      relies on WeakHypothesisType::classify().
      * @param weight_distribution_
      * @param hypothesis_
-     * @param selected_weak_hypothesis_weighted_error_
-     * @param selected_weak_hypothesis_index_
      * @param count_
      * @param progressCallback_
      */
     SimpleSelectionWeakLearner(WeakLearnerMutex & mutex_,
-      const std::vector<const LabeledExample *> & allSamples_,
+                             const TrainingData & trainingData_,
                              const WeightVector & weight_distribution_,
                 std::vector<WeakHypothesisType> & hypothesis_,
-                                    weight_type & selected_weak_hypothesis_weighted_error_,
-                                   unsigned int & selected_weak_hypothesis_index_,
                                   unsigned long & count_,
-                               ProgressCallback * const progressCallback_) : mutex(mutex_),
-                                                                             allSamples(allSamples_),
+                               ProgressCallback * const progressCallback_) : WeakLearnerBody(mutex_, count_, trainingData_, hypothesis_.size(), progressCallback_),
+                                                                             allSamples(trainingData_.allSamples),
                                                                              weight_distribution(weight_distribution_),
-                                                                             hypothesis(hypothesis_),
-                                                                             selected_weak_hypothesis_weighted_error(selected_weak_hypothesis_weighted_error_),
-                                                                             selected_weak_hypothesis_index(selected_weak_hypothesis_index_),
-                                                                             count(count_),
-                                                                             progressCallback(progressCallback_) {}
+                                                                             hypothesis(hypothesis_) {}
+
+    /**
+     * Splitting constructor, required by tbb::parallel_reduce.
+     */
+    SimpleSelectionWeakLearner(SimpleSelectionWeakLearner & learner, tbb::split) : WeakLearnerBody(learner, tbb::split()),
+                                                                                   allSamples(learner.allSamples),
+                                                                                   weight_distribution(learner.weight_distribution),
+                                                                                   hypothesis(learner.hypothesis) {}
+
+    /** Classifies the samples itself: precomputed feature values and sorted samples would go unused */
+    static const bool reads_feature_values = false;
+    static const bool reads_sorted_samples = false;
+
+    /**
+     * Invoked once, before the first boosting round. This weak learner needs no preparation.
+     */
+    static void prepare(TrainingData &, const std::vector<WeakHypothesisType> &) {}
+
+    /**
+     * Invoked after each boosting round selected a weak hypothesis. This weak learner has nothing to report.
+     */
+    static void selected(const TrainingData &,
+                         const WeightVector &,
+                         const std::vector<WeakHypothesisType> &,
+                         const unsigned int,
+                         const weight_type,
+                         ProgressCallback * const) {}
+
+
+
+    /**
+     * Invoked after each boosting round selected a weak hypothesis. Marks the samples it classifies correctly.
+     */
+    static void markCorrect(const TrainingData & trainingData,
+                            const std::vector<WeakHypothesisType> & hypothesis,
+                            const unsigned int index,
+                            CorrectnessVector & correct)
+    {
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, trainingData.allSamples.size()),
+                           MarkCorrectByClassification<WeakHypothesisType>(trainingData.allSamples, hypothesis[index], correct) );
+    }
+
+
 
     /**
      * Runs this weak learner
      */
-    void operator()(tbb::blocked_range< unsigned int > & range) const
+    void operator()(const tbb::blocked_range< unsigned int > & range)
     {
         //Calculate the weighted errors of each weak classifier with respect to the weights of each instance
-        for (unsigned int j = range.begin(); j < range.end(); ++j) //j refers to the classifiers
+        for (unsigned int position = range.begin(); position < range.end(); ++position)
         {
+            const unsigned int j = hypothesisIndex(position); //j refers to the classifiers
             weight_type error = .0f;
 
-            for(std::vector<const LabeledExample *>::size_type i = 0; i < allSamples.size(); ++i ) //i refers to the samples
+            for(WeightVector::size_type k = 0; k < weight_distribution.size(); ++k ) //k refers to the weights
             {
+                const unsigned int i = sampleIndex(k); //i refers to the samples
                 const bool isMisclassification =
                     hypothesis[j].classify( *(allSamples[i]) ) != allSamples[i]->getLabel();
-                error += isMisclassification * weight_distribution[i];
-            }
-
-            { //this must be synchonized
-                tbb::queuing_mutex::scoped_lock lock(mutex);
-                if (error < selected_weak_hypothesis_weighted_error)
-                {
-                    selected_weak_hypothesis_weighted_error = error;
-                    selected_weak_hypothesis_index = j;
-                }
-                lock.release();
+                error += isMisclassification * weight_distribution[k];
             }
 
-            if (progressCallback)
-            { //synchronization needed only INSIDE the if
-                tbb::queuing_mutex::scoped_lock lock(mutex);
-                ++count;
-                progressCallback->tick(count, hypothesis.size());
-                lock.release();
-            }
+            select(error, j);
         }
+
+        tick(range.size());
     }
 
 private:
 
-    WeakLearnerMutex                          & mutex;
     const std::vector<const LabeledExample *> & allSamples;
     const WeightVector                        & weight_distribution;
     std::vector<WeakHypothesisType>           & hypothesis;
-    weight_type                               & selected_weak_hypothesis_weighted_error;
-    unsigned int                              & selected_weak_hypothesis_index;
-    unsigned long                             & count;
-    ProgressCallback                          * const progressCallback;
 };
 
 
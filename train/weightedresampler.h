@@ -0,0 +1,216 @@
+#ifndef WEIGHTEDRESAMPLER_H
+#define WEIGHTEDRESAMPLER_H
+
+#include <vector>
+#include <algorithm>
+#include <tbb/tbb.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/seed_seq.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+
+#include "common.h"
+
+
+
+/**
+ * Walker's alias method, as constructed by Vose ("A linear algorithm for generating random
+ * numbers with a given distribution", 1991). After an O(N) construction, each draw from the
+ * weight distribution takes O(1): pick a column uniformly, then either keep it or take its alias.
+ */
+class AliasTable
+{
+public:
+    AliasTable() : probability(),
+                   alias() {}
+
+
+
+    /**
+     * Builds the table for the distribution proportional to weights.
+     */
+    void build(const WeightVector & weights)
+    {
+        const std::size_t n = weights.size();
+        probability.resize(n);
+        alias.resize(n);
+        if (n == 0)
+        {
+            return;
+        }
+
+        double total = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            total += weights[i];
+        }
+
+        //Scaled so the average column is 1
+        std::vector<double> scaled(n);
+        std::vector<unsigned int> small, large;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            scaled[i] = weights[i] * n / total;
+            (scaled[i] < 1.0 ? small : large).push_back(i);
+        }
+
+        while ( !small.empty() && !large.empty() )
+        {
+            const unsigned int s = small.back();
+            const unsigned int l = large.back();
+            small.pop_back();
+
+            probability[s] = scaled[s];
+            alias[s] = l;
+
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            if (scaled[l] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+
+        //What remains is 1 up to rounding errors
+        for (std::vector<unsigned int>::const_iterator it = large.begin(); it != large.end(); ++it)
+        {
+            probability[*it] = 1.0;
+            alias[*it] = *it;
+        }
+        for (std::vector<unsigned int>::const_iterator it = small.begin(); it != small.end(); ++it)
+        {
+            probability[*it] = 1.0;
+            alias[*it] = *it;
+        }
+    }
+
+
+
+    /**
+     * Draws an index with probability proportional to its weight.
+     */
+    template<typename RandomNumberGenerator>
+    unsigned int draw(RandomNumberGenerator & rng) const
+    {
+        boost::random::uniform_int_distribution<unsigned int> column(0, probability.size() - 1);
+        boost::random::uniform_01<double> coin;
+
+        const unsigned int i = column(rng);
+        return coin(rng) < probability[i] ? i : alias[i];
+    }
+
+    std::size_t size() const
+    {
+        return probability.size();
+    }
+
+private:
+    std::vector<double> probability;
+    std::vector<unsigned int> alias;
+};
+
+
+
+/**
+ * Draws weighted subsamples of the training set, with replacement, for boosting by resampling.
+ *
+ * Draws are made in parallel, in fixed size chunks. Each chunk has its own random number
+ * generator, seeded from the seed, the boosting round and the chunk, so a subsample only
+ * depends on those and not on how many threads drew it.
+ */
+class WeightedResampler
+{
+public:
+    WeightedResampler(const boost::uint32_t seed_ = 0) : seed(seed_),
+                                                         table(),
+                                                         draws() {}
+
+
+
+    /**
+     * Draws size samples according to weights.
+     * @param weights the weight distribution of the whole training set.
+     * @param size how many samples to draw.
+     * @param round the boosting round. Different rounds draw different subsamples.
+     * @param indexes output parameter. The distinct samples drawn, in increasing order.
+     * @param subsetWeights output parameter. How many times each of them was drawn, divided by size.
+     */
+    void resample(const WeightVector & weights,
+                  const unsigned int size,
+                  const unsigned int round,
+                  std::vector<unsigned int> & indexes,
+                  WeightVector & subsetWeights)
+    {
+        indexes.clear();
+        subsetWeights.clear();
+        if ( weights.empty() || size == 0 )
+        {
+            return;
+        }
+
+        table.build(weights);
+
+        draws.resize(size);
+        tbb::parallel_for( tbb::blocked_range< unsigned int >(0, (size + CHUNK - 1) / CHUNK),
+                           Draw(table, seed, round, draws) );
+        tbb::parallel_sort(draws.begin(), draws.end());
+
+        //Repeated draws become the weight of a single sample
+        for (std::vector<unsigned int>::size_type k = 0; k < draws.size(); ++k)
+        {
+            if ( indexes.empty() || indexes.back() != draws[k] )
+            {
+                indexes.push_back(draws[k]);
+                subsetWeights.push_back(0);
+            }
+            subsetWeights.back() += 1.0f / size;
+        }
+    }
+
+private:
+
+    /** Draws made with each random number generator */
+    static const unsigned int CHUNK = 4096;
+
+    struct Draw
+    {
+        const AliasTable          & table;
+        const boost::uint32_t       seed;
+        const boost::uint32_t       round;
+        std::vector<unsigned int> & draws;
+
+        Draw(const AliasTable          & table_,
+             const boost::uint32_t       seed_,
+             const boost::uint32_t       round_,
+             std::vector<unsigned int> & draws_) : table(table_),
+                                                   seed(seed_),
+                                                   round(round_),
+                                                   draws(draws_) {}
+
+        void operator()(const tbb::blocked_range< unsigned int > & range) const
+        {
+            for (unsigned int chunk = range.begin(); chunk < range.end(); ++chunk)
+            {
+                const boost::uint32_t key[3] = {seed, round, chunk};
+                boost::random::seed_seq sequence(key, key + 3);
+                boost::random::mt19937 rng(sequence);
+
+                const std::size_t end = std::min<std::size_t>(draws.size(), (std::size_t)(chunk + 1) * CHUNK);
+                for (std::size_t k = (std::size_t)chunk * CHUNK; k < end; ++k)
+                {
+                    draws[k] = table.draw(rng);
+                }
+            }
+        }
+    };
+
+    const boost::uint32_t seed;
+    AliasTable table;
+    std::vector<unsigned int> draws;
+};
+
+
+
+#endif // WEIGHTEDRESAMPLER_H